@@ -0,0 +1,116 @@
+#ifndef QENQEY_BENCH_H
+#define QENQEY_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace qenqey {
+namespace bench {
+
+// Keeps the optimizer from discarding a benchmarked result
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result
+{
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double unitsPerOp;
+};
+
+// Collects timings for one benchmark executable. A human-readable table
+// goes to stderr as cases finish; finish() prints the whole suite as a
+// single JSON document on stdout, which meson keeps in
+// meson-logs/benchmarklog.json for comparing releases.
+//
+// QENQEY_BENCH_MIN_TIME overrides the minimum seconds per case.
+class Suite
+{
+public:
+    explicit Suite(const char *name)
+        : m_name(name)
+        , m_minSeconds(0.2)
+    {
+        if (const char *env = std::getenv("QENQEY_BENCH_MIN_TIME")) {
+            m_minSeconds = std::atof(env);
+        }
+    }
+
+    // Runs op in growing batches until the minimum time has elapsed.
+    // unitsPerOp scales the throughput column (e.g. characters per
+    // password).
+    template <typename Op>
+    double run(const std::string &name, Op op, double unitsPerOp = 1.0)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        uint64_t iterations = 0;
+        uint64_t batch = 1;
+        double elapsed = 0.0;
+        const Clock::time_point start = Clock::now();
+
+        while (elapsed < m_minSeconds) {
+            for (uint64_t i = 0; i < batch; ++i) {
+                op();
+            }
+            iterations += batch;
+            batch *= 2;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        return record(name, iterations, elapsed, unitsPerOp);
+    }
+
+    // Times a single execution of op, for cases that are one big job
+    template <typename Op>
+    double once(const std::string &name, Op op, double unitsPerOp = 1.0)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const Clock::time_point start = Clock::now();
+        op();
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        return record(name, 1, elapsed, unitsPerOp);
+    }
+
+    void finish() const
+    {
+        std::printf("{\n  \"suite\": \"%s\",\n  \"results\": [\n", m_name.c_str());
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            const Result &r = m_results[i];
+            std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, "
+                        "\"ops_per_sec\": %.1f, \"units_per_sec\": %.1f}%s\n",
+                        r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+                        r.nsPerOp, 1e9 / r.nsPerOp, r.unitsPerOp * 1e9 / r.nsPerOp,
+                        i + 1 < m_results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+private:
+    double record(const std::string &name, uint64_t iterations, double elapsed, double unitsPerOp)
+    {
+        const double nsPerOp = elapsed * 1e9 / iterations;
+        std::fprintf(stderr, "%-56s %14.2f ns/op %16.0f units/s\n",
+                     name.c_str(), nsPerOp, unitsPerOp * iterations / elapsed);
+        m_results.push_back({name, iterations, nsPerOp, unitsPerOp});
+        return nsPerOp;
+    }
+
+    std::string m_name;
+    double m_minSeconds;
+    std::vector<Result> m_results;
+};
+
+} // namespace bench
+} // namespace qenqey
+
+#endif // QENQEY_BENCH_H
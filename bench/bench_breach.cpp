@@ -0,0 +1,102 @@
+// Breached-password lookups against a synthetic sorted SHA-1 corpus, with
+// and without the Bloom prefilter. Set QENQEY_BREACH_CORPUS to also time
+// the installed corpus.
+
+#include "bench.h"
+
+#include "core/breach.h"
+#include "core/random.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace qenqey;
+
+namespace {
+
+using Digest = std::array<uint8_t, SHA1_DIGEST_SIZE>;
+
+constexpr size_t CORPUS_SIZE = 4000000;
+constexpr size_t QUERY_COUNT = 1 << 16;
+
+std::vector<Digest> randomDigests(RandomStream &random, size_t count)
+{
+    std::vector<Digest> digests(count);
+    for (Digest &digest : digests) {
+        random.fill(digest.data(), digest.size());
+    }
+    return digests;
+}
+
+void benchLookups(bench::Suite &suite, const std::string &prefix, const BreachCorpus &corpus,
+                  const std::vector<Digest> &hits, const std::vector<Digest> &misses)
+{
+    size_t i = 0;
+    suite.run(prefix + "/hit", [&] {
+        bench::doNotOptimize(corpus.contains(hits[i++ % hits.size()].data()));
+    });
+    i = 0;
+    suite.run(prefix + "/miss", [&] {
+        bench::doNotOptimize(corpus.contains(misses[i++ % misses.size()].data()));
+    });
+}
+
+} // namespace
+
+int main()
+{
+    bench::Suite suite("breach");
+    RandomStream &random = RandomStream::forThread();
+
+    char password[16] = "Tr0ub4dor&3xyz";
+    suite.run("sha1/len=14", [&] {
+        uint8_t digest[SHA1_DIGEST_SIZE];
+        sha1(password, 14, digest);
+        bench::doNotOptimize(digest[0]);
+    }, 14);
+
+    std::vector<Digest> corpusDigests = randomDigests(random, CORPUS_SIZE);
+    std::sort(corpusDigests.begin(), corpusDigests.end());
+
+    char path[] = "/tmp/qenqey-bench-breach-XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        std::perror("mkstemp");
+        return 1;
+    }
+    FILE *out = fdopen(fd, "wb");
+    std::fwrite(corpusDigests.data(), SHA1_DIGEST_SIZE, corpusDigests.size(), out);
+    std::fclose(out);
+
+    std::vector<Digest> hits(QUERY_COUNT);
+    for (Digest &digest : hits) {
+        digest = corpusDigests[random.next32() % corpusDigests.size()];
+    }
+    const std::vector<Digest> misses = randomDigests(random, QUERY_COUNT);
+    corpusDigests = std::vector<Digest>();
+
+    BreachCorpus corpus;
+    corpus.open(path);
+    benchLookups(suite, "synthetic/interpolation", corpus, hits, misses);
+
+    const std::string bloomPath = std::string(path) + ".bloom";
+    writeBreachBloomFilter(path, bloomPath, 10);
+    corpus.open(path);
+    benchLookups(suite, "synthetic/bloom", corpus, hits, misses);
+
+    std::remove(bloomPath.c_str());
+    std::remove(path);
+
+    if (const BreachCorpus *installed = BreachCorpus::shared()) {
+        size_t i = 0;
+        suite.run("installed/miss", [&] {
+            bench::doNotOptimize(installed->contains(misses[i++ % misses.size()].data()));
+        });
+    }
+
+    suite.finish();
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Generator daemon over a Unix socket: one-request round trips, pipelined
+// small requests and large batches. The server runs in a thread of this
+// process on a temporary socket.
+
+#include "bench.h"
+
+#include "core/daemon.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace qenqey;
+
+namespace {
+
+constexpr int PIPELINE_DEPTH = 256;
+
+int connectTo(const std::string &path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads until lines complete lines have arrived; the buffer keeps any
+// bytes past them for the next call
+class LineReader
+{
+public:
+    explicit LineReader(int fd)
+        : m_fd(fd)
+    {
+    }
+
+    bool skipLines(uint64_t lines)
+    {
+        while (lines > 0) {
+            while (m_pos < m_size && lines > 0) {
+                const void *newline = std::memchr(m_buffer + m_pos, '\n', m_size - m_pos);
+                if (!newline) {
+                    m_pos = m_size;
+                    break;
+                }
+                m_pos = static_cast<size_t>(static_cast<const char *>(newline) - m_buffer) + 1;
+                --lines;
+            }
+            if (lines == 0) {
+                break;
+            }
+            const ssize_t received = recv(m_fd, m_buffer, sizeof(m_buffer), 0);
+            if (received <= 0) {
+                return false;
+            }
+            m_pos = 0;
+            m_size = static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+private:
+    int m_fd;
+    char m_buffer[256 * 1024];
+    size_t m_pos = 0;
+    size_t m_size = 0;
+};
+
+bool sendText(int fd, const std::string &text)
+{
+    return send(fd, text.data(), text.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+}
+
+} // namespace
+
+int main()
+{
+    bench::Suite suite("daemon");
+
+    DaemonOptions options;
+    options.socketPath = "/tmp/qenqey-bench-" + std::to_string(getpid()) + ".sock";
+    DaemonServer server(options);
+    std::string error;
+    if (!server.listen(&error)) {
+        std::fprintf(stderr, "bench-daemon: %s\n", error.c_str());
+        return 1;
+    }
+    std::thread serverThread([&] { server.run(); });
+
+    const int fd = connectTo(options.socketPath);
+    if (fd < 0) {
+        std::perror("connect");
+        server.stop();
+        serverThread.join();
+        return 1;
+    }
+    LineReader reader(fd);
+
+    suite.run("roundtrip/ping", [&] {
+        sendText(fd, "PING\n");
+        reader.skipLines(1);
+    });
+
+    suite.run("roundtrip/gen1", [&] {
+        sendText(fd, "GEN 1 len=20 classes=ulds\n");
+        reader.skipLines(2);
+    });
+
+    std::string pipelined;
+    for (int i = 0; i < PIPELINE_DEPTH; ++i) {
+        pipelined += "GEN 1 len=20 classes=ulds\n";
+    }
+    suite.run("pipelined/gen1/depth=" + std::to_string(PIPELINE_DEPTH), [&] {
+        sendText(fd, pipelined);
+        reader.skipLines(2 * PIPELINE_DEPTH);
+    }, PIPELINE_DEPTH);
+
+    suite.run("batch/gen10000/len=20", [&] {
+        sendText(fd, "GEN 10000 len=20\n");
+        reader.skipLines(10001);
+    }, 10000);
+
+    suite.run("batch/gen10000/passphrase", [&] {
+        sendText(fd, "GEN 10000 words=6\n");
+        reader.skipLines(10001);
+    }, 10000);
+
+    close(fd);
+    server.stop();
+    serverThread.join();
+
+    suite.finish();
+    return 0;
+}
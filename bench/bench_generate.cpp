@@ -0,0 +1,200 @@
+// Password generation across lengths and every character class
+// combination and under character rules, pronounceable passwords and
+// tokens, plus bulk export throughput in each file format and with
+// de-duplication
+
+#include "bench.h"
+
+#include "core/bulk.h"
+#include "core/charsetplan.h"
+#include "core/constrained.h"
+#include "core/generator.h"
+#include "core/markov.h"
+#include "core/passphrase.h"
+#include "core/pronounceable.h"
+#include "core/random.h"
+#include "core/template.h"
+#include "core/token.h"
+#include "core/wordlist.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace qenqey;
+
+namespace {
+
+const int LENGTHS[] = {4, 8, 16, 32, 64, 128};
+
+constexpr uint64_t EXPORT_COUNT = 2000000;
+
+std::string classesName(unsigned classes)
+{
+    std::string name;
+    if (classes & Uppercase) name += 'u';
+    if (classes & Lowercase) name += 'l';
+    if (classes & Numbers) name += 'd';
+    if (classes & Symbols) name += 's';
+    return name;
+}
+
+} // namespace
+
+int main()
+{
+    bench::Suite suite("generate");
+    RandomStream &random = RandomStream::forThread();
+    char password[MAX_PASSWORD_LENGTH];
+
+    for (int length : LENGTHS) {
+        for (unsigned classes = 1; classes <= ALL_CLASSES; ++classes) {
+            const CharsetPlan plan(GeneratorSettings{length, classes, false});
+            suite.run("generate/len=" + std::to_string(length) + "/classes=" + classesName(classes), [&] {
+                generatePassword(plan, random, password);
+                bench::doNotOptimize(password[0]);
+            }, length);
+        }
+    }
+
+    for (int length : LENGTHS) {
+        const CharsetPlan plan(GeneratorSettings{length, ALL_CLASSES, true});
+        suite.run("generate/len=" + std::to_string(length) + "/classes=ulds/exclude_similar", [&] {
+            generatePassword(plan, random, password);
+            bench::doNotOptimize(password[0]);
+        }, length);
+    }
+
+    // Settings change: what the window pays when a checkbox is toggled
+    suite.run("plan/compile", [&] {
+        const CharsetPlan plan(GeneratorSettings{16, ALL_CLASSES, true});
+        bench::doNotOptimize(plan.alphabet().size);
+    });
+
+    // Character rules: one walk down the count table per password, and
+    // the table build a rules change costs
+    const CharacterRules strictRules = [] {
+        CharacterRules rules;
+        std::fill(std::begin(rules.minimum), std::end(rules.minimum), 2);
+        rules.maxRepeat = 2;
+        rules.maxSequence = 2;
+        rules.bannedFirst = "0!";
+        return rules;
+    }();
+    for (int length : {16, 32}) {
+        const ConstrainedPlan plan(GeneratorSettings{length, ALL_CLASSES, false}, strictRules);
+        suite.run("rules/len=" + std::to_string(length) + "/strict", [&] {
+            bench::doNotOptimize(plan.generate(random, password));
+        }, length);
+    }
+    suite.run("rules/compile/len=16", [&] {
+        const ConstrainedPlan plan(GeneratorSettings{16, ALL_CLASSES, false}, strictRules);
+        bench::doNotOptimize(plan.entropyBits());
+    });
+
+    // Passphrases from the installed wordlist, when the build produced one
+    if (const Wordlist *wordlist = Wordlist::shared()) {
+        char phrase[MAX_OUTPUT_BYTES];
+        for (int words : {4, 6, 8, 12}) {
+            const PassphrasePlan plan(wordlist, PassphraseSettings{words, '-', false});
+            suite.run("passphrase/words=" + std::to_string(words), [&] {
+                bench::doNotOptimize(plan.generate(random, phrase));
+            });
+        }
+    }
+
+    // Pronounceable passwords, one alias draw per letter, when the build
+    // produced a letter model
+    if (const MarkovModel *model = MarkovModel::shared()) {
+        char letters[MAX_OUTPUT_BYTES];
+        for (int length : {12, 20, 32}) {
+            const PronounceablePlan plan(model, PronounceableSettings{length});
+            suite.run("pronounceable/len=" + std::to_string(length), [&] {
+                bench::doNotOptimize(plan.generate(random, letters));
+            }, plan.maxLength());
+        }
+    }
+
+    // Templates: a compiled program against a plain password of the same
+    // length, and the cost of compiling one per keystroke
+    char templated[MAX_OUTPUT_BYTES];
+    for (const char *pattern : {DEFAULT_TEMPLATE, "[0-9a-f]{32}", "x{4}-x{4}-x{4}-x{4}"}) {
+        const TemplatePlan plan(pattern, nullptr);
+        suite.run(std::string("template/") + pattern, [&] {
+            bench::doNotOptimize(plan.generate(random, templated));
+        }, plan.maxLength());
+    }
+    suite.run("template/compile", [&] {
+        const TemplatePlan plan(DEFAULT_TEMPLATE, nullptr);
+        bench::doNotOptimize(plan.maxLength());
+    });
+    if (const Wordlist *wordlist = Wordlist::shared()) {
+        const TemplatePlan plan("W-w-9999s", wordlist);
+        suite.run("template/W-w-9999s", [&] {
+            bench::doNotOptimize(plan.generate(random, templated));
+        });
+    }
+
+    // Tokens: one piece of keystream and a vector encoder per token, then
+    // the encoders alone over a large buffer. Units are output bytes.
+    char token[MAX_OUTPUT_BYTES];
+    for (TokenEncoding encoding : {TokenEncoding::Hex, TokenEncoding::Base64Url, TokenEncoding::Base32,
+                                   TokenEncoding::Crockford, TokenEncoding::Uuid}) {
+        const TokenPlan plan(TokenSettings{encoding, 32});
+        suite.run(std::string("token/") + tokenEncodingName(encoding), [&] {
+            bench::doNotOptimize(plan.generate(random, token));
+        }, plan.maxLength());
+    }
+    {
+        const TokenPlan plan(TokenSettings{TokenEncoding::Hex, MAX_TOKEN_BYTES});
+        suite.run("token/hex/bytes=" + std::to_string(MAX_TOKEN_BYTES), [&] {
+            bench::doNotOptimize(plan.generate(random, token));
+        }, plan.maxLength());
+    }
+    std::vector<uint8_t> raw(1 << 16);
+    random.fill(raw.data(), raw.size());
+    std::vector<char> encoded(2 * raw.size());
+    const std::pair<const char *, size_t (*)(const uint8_t *, size_t, char *)> encoders[] = {
+        {"hex", encodeHex}, {"base64url", encodeBase64Url}, {"base32", encodeBase32}, {"crockford", encodeCrockford},
+    };
+    for (const auto &[name, encode] : encoders) {
+        suite.run(std::string("encode/") + name + "/64k", [&] {
+            bench::doNotOptimize(encode(raw.data(), raw.size(), encoded.data()));
+        }, static_cast<double>(encode(raw.data(), raw.size(), encoded.data())));
+    }
+
+    // Whole-file exports to /dev/null, so only encoding and the write
+    // path are measured
+    const int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    const CharsetPlan exportPlan(GeneratorSettings{20, ALL_CLASSES, false});
+    for (ExportFormat format : {ExportFormat::Plain, ExportFormat::Csv, ExportFormat::Jsonl,
+                                ExportFormat::Binary}) {
+        BulkOptions options;
+        options.count = EXPORT_COUNT;
+        options.format = format;
+        suite.once(std::string("export/len=20/") + exportFormatName(format), [&] {
+            BulkEngine engine(exportPlan, options);
+            bench::doNotOptimize(engine.run(devNull));
+        }, EXPORT_COUNT);
+    }
+
+    // Unique batches: fingerprint table in memory, then forced to a file
+    const CharsetPlan shortPlan(GeneratorSettings{8, Uppercase | Lowercase | Numbers, false});
+    for (size_t budget : {DEFAULT_UNIQUE_MEMORY, size_t(1) << 20}) {
+        BulkOptions options;
+        options.count = EXPORT_COUNT;
+        options.unique = true;
+        options.uniqueMemoryBudget = budget;
+        suite.once(std::string("export/len=8/unique/") + (budget > (1 << 20) ? "memory" : "file"), [&] {
+            BulkEngine engine(shortPlan, options);
+            bench::doNotOptimize(engine.run(devNull));
+        }, EXPORT_COUNT);
+    }
+    close(devNull);
+
+    suite.finish();
+    return 0;
+}
@@ -0,0 +1,80 @@
+// History appends the way generatePassword() does them, at growing
+// history sizes. Needs a QApplication; meson runs it with the offscreen
+// platform plugin.
+
+#include "bench.h"
+
+#include "historymodel.h"
+
+#include <QApplication>
+#include <QListView>
+
+using namespace qenqey;
+
+namespace {
+
+const int SIZES[] = {10000, 100000};
+constexpr int TAIL_APPENDS = 1000;
+
+QString passwordFor(int index)
+{
+    return QStringLiteral("Pa55w0rd%1xyzXYZ").arg(index, 8, 10, QLatin1Char('0'));
+}
+
+// Model plus a shown view, with the event loop run after every append as
+// it would be between two key presses
+void benchView(bench::Suite &suite, int size, int limit, const std::string &prefix)
+{
+    HistoryModel model(limit);
+    QListView view;
+    view.setModel(&model);
+    view.setUniformItemSizes(true);
+    view.resize(400, 120);
+    view.show();
+
+    suite.once(prefix + "/fill", [&] {
+        for (int i = 0; i < size; ++i) {
+            model.append(passwordFor(i));
+            view.scrollToBottom();
+            QApplication::processEvents();
+        }
+    }, size);
+
+    // Cost of one more append once the history is already this long
+    suite.once(prefix + "/append_tail", [&] {
+        for (int i = 0; i < TAIL_APPENDS; ++i) {
+            model.append(passwordFor(size + i));
+            view.scrollToBottom();
+            QApplication::processEvents();
+        }
+    }, TAIL_APPENDS);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    bench::Suite suite("history");
+
+    for (int size : SIZES) {
+        const std::string name = std::to_string(size / 1000) + "k";
+
+        // Default limit: the ring buffer wraps long before the end
+        benchView(suite, size, HistoryModel::DEFAULT_LIMIT, "history/" + name + "/default_limit");
+
+        // Limit large enough to keep every entry
+        benchView(suite, size, size, "history/" + name + "/unbounded");
+
+        // Model alone, without any view attached
+        HistoryModel model(HistoryModel::DEFAULT_LIMIT);
+        suite.once("history/" + name + "/model_only", [&] {
+            for (int i = 0; i < size; ++i) {
+                model.append(passwordFor(i));
+            }
+        }, size);
+    }
+
+    suite.finish();
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Compares the buffered ChaCha20 stream against the QRandomGenerator
+// path the window used before the generator core existed.
+
+#include "bench.h"
+
+#include "core/charsetplan.h"
+#include "core/generator.h"
+#include "core/random.h"
+
+#include <QRandomGenerator>
+#include <QString>
+
+#include <vector>
+
+using namespace qenqey;
+
+namespace {
+
+// Verbatim shape of the original QenQeyMainWindow::generateRandomPassword()
+// with uppercase, lowercase and digits selected
+QString legacyPassword(int length)
+{
+    const QString upper = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const QString lower = "abcdefghijklmnopqrstuvwxyz";
+    const QString digits = "0123456789";
+
+    QString charset;
+    charset += upper;
+    charset += lower;
+    charset += digits;
+
+    QStringList requiredSets;
+    requiredSets.append(upper);
+    requiredSets.append(lower);
+    requiredSets.append(digits);
+
+    QString password;
+    for (const QString &set : requiredSets) {
+        if (!set.isEmpty() && password.length() < length) {
+            int index = QRandomGenerator::global()->bounded(set.length());
+            password.append(set.at(index));
+        }
+    }
+
+    for (int i = password.length(); i < length; ++i) {
+        int index = QRandomGenerator::global()->bounded(charset.length());
+        password.append(charset.at(index));
+    }
+
+    for (int i = password.length() - 1; i > 0; --i) {
+        int j = QRandomGenerator::global()->bounded(i + 1);
+        QChar temp = password[i];
+        password[i] = password[j];
+        password[j] = temp;
+    }
+
+    return password;
+}
+
+} // namespace
+
+int main()
+{
+    bench::Suite suite("random");
+    RandomStream &stream = RandomStream::forThread();
+    QRandomGenerator *global = QRandomGenerator::global();
+
+    suite.run("index/qrandomgenerator_bounded", [&] {
+        bench::doNotOptimize(global->bounded(62));
+    });
+    suite.run("index/stream_bounded", [&] {
+        bench::doNotOptimize(stream.bounded(62));
+    });
+
+    const CharsetPlan plan(GeneratorSettings{16, Uppercase | Lowercase | Numbers, false});
+    const AlphabetTable &alphabet = plan.alphabet();
+    char batch[4096];
+    suite.run("index/stream_sample_bytes_4096", [&] {
+        stream.sampleBytes(alphabet.byteLimit, alphabet.byteMap, batch, sizeof(batch));
+        bench::doNotOptimize(batch[0]);
+    }, sizeof(batch));
+
+    std::vector<quint32> words(1 << 18);
+    suite.run("bytes/qrandomgenerator_fill_1m", [&] {
+        global->fillRange(words.data(), words.size());
+        bench::doNotOptimize(words[0]);
+    }, words.size() * sizeof(quint32));
+    suite.run("bytes/stream_fill_1m", [&] {
+        stream.fill(words.data(), words.size() * sizeof(quint32));
+        bench::doNotOptimize(words[0]);
+    }, words.size() * sizeof(quint32));
+
+    suite.run("password16/legacy_qstring_qrandomgenerator", [&] {
+        bench::doNotOptimize(legacyPassword(16));
+    });
+    char password[MAX_PASSWORD_LENGTH];
+    suite.run("password16/charset_plan_stream", [&] {
+        generatePassword(plan, stream, password);
+        bench::doNotOptimize(password[0]);
+    });
+
+    suite.finish();
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Strength scoring over large corpora of generated and human-style
+// passwords, through QString and through the UTF-8 path the file audit
+// uses
+
+#include "bench.h"
+
+#include "core/charsetplan.h"
+#include "core/generator.h"
+#include "core/random.h"
+#include "strength.h"
+
+#include <QStringList>
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace qenqey;
+
+namespace {
+
+constexpr int CORPUS_SIZE = 1000000;
+
+QStringList generatedCorpus()
+{
+    RandomStream &random = RandomStream::forThread();
+    char buffer[MAX_PASSWORD_LENGTH];
+
+    QStringList corpus;
+    corpus.reserve(CORPUS_SIZE);
+    for (int i = 0; i < CORPUS_SIZE; ++i) {
+        const int length = MIN_PASSWORD_LENGTH + random.bounded(MAX_PASSWORD_LENGTH - MIN_PASSWORD_LENGTH + 1);
+        const unsigned classes = 1 + random.bounded(ALL_CLASSES);
+        const CharsetPlan plan(GeneratorSettings{length, classes, false});
+        generatePassword(plan, random, buffer);
+        corpus.append(QString::fromLatin1(buffer, length));
+    }
+    return corpus;
+}
+
+// Word + number + optional symbol, the shape most pasted passwords have
+QStringList humanCorpus()
+{
+    const char *const words[] = {
+        "password", "qwerty", "dragon", "monkey", "letmein", "Sunshine", "princess",
+        "football", "Welcome", "shadow", "master", "пароль", "Привет", "admin",
+    };
+    const char *const symbols[] = {"", "!", "@", "#", "?", "$"};
+    RandomStream &random = RandomStream::forThread();
+
+    QStringList corpus;
+    corpus.reserve(CORPUS_SIZE);
+    for (int i = 0; i < CORPUS_SIZE; ++i) {
+        QString entry = QString::fromUtf8(words[random.bounded(std::size(words))]);
+        entry += QString::number(random.bounded(10000));
+        entry += QLatin1String(symbols[random.bounded(std::size(symbols))]);
+        corpus.append(entry);
+    }
+    return corpus;
+}
+
+void scoreCorpus(bench::Suite &suite, const char *name, const QStringList &corpus)
+{
+    suite.run(name, [&] {
+        int total = 0;
+        for (const QString &password : corpus) {
+            total += calculatePasswordStrength(password);
+        }
+        bench::doNotOptimize(total);
+    }, corpus.size());
+}
+
+// Same corpus as UTF-8 bytes, with character classes found by the
+// vectorised scan instead of per character
+void scoreUtf8(bench::Suite &suite, const char *name, const QStringList &corpus)
+{
+    std::vector<std::string> utf8;
+    utf8.reserve(corpus.size());
+    for (const QString &password : corpus) {
+        utf8.push_back(password.toStdString());
+    }
+
+    suite.run(name, [&] {
+        int total = 0;
+        for (const std::string &password : utf8) {
+            total += estimateStrength(password).score;
+        }
+        bench::doNotOptimize(total);
+    }, utf8.size());
+}
+
+} // namespace
+
+int main()
+{
+    bench::Suite suite("strength");
+
+    const QStringList generated = generatedCorpus();
+    const QStringList human = humanCorpus();
+    scoreCorpus(suite, "strength/generated_1m", generated);
+    scoreCorpus(suite, "strength/human_1m", human);
+    scoreUtf8(suite, "strength/generated_1m_utf8", generated);
+    scoreUtf8(suite, "strength/human_1m_utf8", human);
+
+    suite.finish();
+    return 0;
+}
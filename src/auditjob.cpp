@@ -0,0 +1,81 @@
+#include "auditjob.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QThread>
+
+#include <algorithm>
+
+AuditJob::AuditJob(QObject *parent)
+    : QObject(parent)
+    , m_done(0)
+    , m_cancel(false)
+    , m_total(0)
+    , m_running(false)
+{
+    m_timer.setInterval(PROGRESS_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, [this] {
+        emit progress(m_done.load(std::memory_order_relaxed), m_total);
+    });
+}
+
+AuditJob::~AuditJob()
+{
+    m_cancel = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool AuditJob::start(const QString &path, size_t weakest)
+{
+    if (m_running) {
+        return false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    qenqey::AuditOptions options;
+    // Leave a core for the window
+    options.threads = static_cast<unsigned>(std::max(1, QThread::idealThreadCount() - 1));
+    options.weakest = weakest;
+    options.progress = &m_done;
+    options.cancel = &m_cancel;
+
+    m_engine = std::make_unique<qenqey::AuditEngine>(options);
+    m_total = static_cast<quint64>(QFileInfo(path).size());
+    m_error.clear();
+    m_done = 0;
+    m_cancel = false;
+    m_running = true;
+
+    const std::string file = QFile::encodeName(path).toStdString();
+    m_thread = std::thread([this, file] {
+        const bool ok = m_engine->run(file);
+        const bool cancelled = m_engine->wasCancelled();
+        const QString error = QString::fromStdString(m_engine->errorString());
+        QMetaObject::invokeMethod(this, [this, ok, cancelled, error] {
+            m_error = error;
+            finish(ok, cancelled);
+        }, Qt::QueuedConnection);
+    });
+    m_timer.start();
+    return true;
+}
+
+void AuditJob::cancel()
+{
+    m_cancel = true;
+}
+
+void AuditJob::finish(bool ok, bool cancelled)
+{
+    m_timer.stop();
+    m_thread.join();
+    m_running = false;
+
+    emit progress(m_done.load(std::memory_order_relaxed), m_total);
+    emit finished(ok, cancelled);
+}
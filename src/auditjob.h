@@ -0,0 +1,59 @@
+#ifndef QENQEY_AUDITJOB_H
+#define QENQEY_AUDITJOB_H
+
+#include "core/audit.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Audits a password file on a background thread, so scoring tens of
+// millions of lines never blocks the window. Progress is polled a few
+// times a second, in bytes of the file.
+class AuditJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int PROGRESS_INTERVAL_MS = 100;
+
+    explicit AuditJob(QObject *parent = nullptr);
+
+    // Cancels a running audit and waits for it
+    ~AuditJob() override;
+
+    bool isRunning() const { return m_running; }
+
+    // False when an audit is already running
+    bool start(const QString &path, size_t weakest);
+
+    // Valid after a successful finished()
+    const qenqey::AuditReport &report() const { return m_engine->report(); }
+
+    // Why the last audit failed, when it was not cancelled
+    QString errorString() const { return m_error; }
+
+    void cancel();
+
+signals:
+    void progress(quint64 done, quint64 total);
+    void finished(bool ok, bool cancelled);
+
+private:
+    void finish(bool ok, bool cancelled);
+
+    std::unique_ptr<qenqey::AuditEngine> m_engine;
+    std::thread m_thread;
+    std::atomic<uint64_t> m_done;
+    std::atomic<bool> m_cancel;
+    QTimer m_timer;
+    QString m_error;
+    quint64 m_total;
+    bool m_running;
+};
+
+#endif // QENQEY_AUDITJOB_H
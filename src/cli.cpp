@@ -0,0 +1,688 @@
+#include "cli.h"
+
+#include "core/audit.h"
+#include "core/breach.h"
+#include "core/bulk.h"
+#include "core/charsetplan.h"
+#include "core/constrained.h"
+#include "core/daemon.h"
+#include "core/markov.h"
+#include "core/metrics.h"
+#include "core/passphrase.h"
+#include "core/pronounceable.h"
+#include "core/template.h"
+#include "core/token.h"
+#include "core/wordlist.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace qenqey {
+namespace cli {
+
+namespace {
+
+struct Options
+{
+    GeneratorSettings settings;
+    CharacterRules rules;
+    PassphraseSettings passphrase;
+    bool passphraseMode = false;
+    const char *templatePattern = nullptr;
+    const char *wordlist = nullptr;
+    PronounceableSettings pronounceable;
+    bool pronounceableMode = false;
+    const char *markovModel = nullptr;
+    TokenSettings token;
+    bool tokenMode = false;
+    BulkOptions bulk{1};
+    bool entropy = false;
+    bool threadStats = false;
+    bool stats = false;
+    bool rejectBreached = false;
+    bool daemon = false;
+    const char *socketPath = nullptr;
+    const char *outputPath = nullptr;
+    const char *auditPath = nullptr;
+    size_t auditWeakest = DEFAULT_AUDIT_WEAKEST;
+    bool help = false;
+    bool version = false;
+};
+
+// Options that switch the binary into headless mode
+const char *const CLI_OPTIONS[] = {
+    "--count", "--length", "--classes", "--exclude-similar",
+    "--min", "--max-repeat", "--max-sequence", "--no-first",
+    "--words", "--separator", "--capitalize", "--wordlist", "--template",
+    "--pronounceable", "--markov", "--token", "--bytes", "--entropy",
+    "--threads", "--unordered", "--thread-stats", "--stats", "--reject-breached",
+    "--unique", "--unique-memory", "--unique-dir", "--daemon", "--socket", "--format", "--output",
+    "--audit", "--top", "--help", "--version",
+};
+
+bool matchesOption(const char *arg, const char *option)
+{
+    size_t len = std::strlen(option);
+    return std::strncmp(arg, option, len) == 0 && (arg[len] == '\0' || arg[len] == '=');
+}
+
+// Accepts both "--name value" and "--name=value"
+const char *optionValue(int argc, char *argv[], int &i)
+{
+    const char *eq = std::strchr(argv[i], '=');
+    if (eq) {
+        return eq + 1;
+    }
+    if (i + 1 < argc) {
+        return argv[++i];
+    }
+    return nullptr;
+}
+
+bool parseNumber(const char *text, unsigned long long &value)
+{
+    if (!text || !*text) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    return errno == 0 && *end == '\0' && text[0] != '-';
+}
+
+// Class letters: u - uppercase, l - lowercase, d - digits, s - symbols
+bool parseClasses(const char *text, unsigned &classes)
+{
+    if (!text || !*text) {
+        return false;
+    }
+    classes = 0;
+    for (const char *c = text; *c; ++c) {
+        switch (*c) {
+        case 'u': classes |= Uppercase; break;
+        case 'l': classes |= Lowercase; break;
+        case 'd': classes |= Numbers; break;
+        case 's': classes |= Symbols; break;
+        case ',': break;
+        default: return false;
+        }
+    }
+    return classes != 0;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        unsigned long long number = 0;
+
+        if (matchesOption(arg, "--count")) {
+            if (!parseNumber(optionValue(argc, argv, i), number)) {
+                std::fprintf(stderr, "qenqey: неверное значение --count\n");
+                return false;
+            }
+            options.bulk.count = number;
+        } else if (matchesOption(arg, "--length")) {
+            if (!parseNumber(optionValue(argc, argv, i), number)
+                || number < MIN_PASSWORD_LENGTH || number > MAX_PASSWORD_LENGTH) {
+                std::fprintf(stderr, "qenqey: длина должна быть от %d до %d\n",
+                             MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+                return false;
+            }
+            options.settings.length = static_cast<int>(number);
+            options.pronounceable.length = static_cast<int>(number);
+        } else if (matchesOption(arg, "--classes")) {
+            if (!parseClasses(optionValue(argc, argv, i), options.settings.classes)) {
+                std::fprintf(stderr, "qenqey: --classes принимает буквы u, l, d, s\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--exclude-similar")) {
+            options.settings.excludeSimilar = true;
+        } else if (matchesOption(arg, "--min")) {
+            const char *value = optionValue(argc, argv, i);
+            if (!value || !parseClassMinimums(value, options.rules)) {
+                std::fprintf(stderr, "qenqey: --min принимает список вида u2,d3\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--max-repeat") || matchesOption(arg, "--max-sequence")) {
+            const bool repeat = matchesOption(arg, "--max-repeat");
+            if (!parseNumber(optionValue(argc, argv, i), number) || number < 1 || number > MAX_RULE_RUN) {
+                std::fprintf(stderr, "qenqey: %s должно быть от 1 до %d\n",
+                             repeat ? "--max-repeat" : "--max-sequence", MAX_RULE_RUN);
+                return false;
+            }
+            (repeat ? options.rules.maxRepeat : options.rules.maxSequence) = static_cast<int>(number);
+        } else if (matchesOption(arg, "--no-first")) {
+            const char *value = optionValue(argc, argv, i);
+            if (!value || !*value) {
+                std::fprintf(stderr, "qenqey: не указаны символы --no-first\n");
+                return false;
+            }
+            options.rules.bannedFirst = value;
+        } else if (matchesOption(arg, "--words")) {
+            if (!parseNumber(optionValue(argc, argv, i), number)
+                || number < MIN_PASSPHRASE_WORDS || number > MAX_PASSPHRASE_WORDS) {
+                std::fprintf(stderr, "qenqey: число слов должно быть от %d до %d\n",
+                             MIN_PASSPHRASE_WORDS, MAX_PASSPHRASE_WORDS);
+                return false;
+            }
+            options.passphrase.words = static_cast<int>(number);
+            options.passphraseMode = true;
+        } else if (matchesOption(arg, "--separator")) {
+            const char *value = optionValue(argc, argv, i);
+            if (!value || std::strlen(value) != 1 || !std::strchr(PASSPHRASE_SEPARATORS, value[0])) {
+                std::fprintf(stderr, "qenqey: разделитель должен быть одним из символов \"%s\"\n",
+                             PASSPHRASE_SEPARATORS);
+                return false;
+            }
+            options.passphrase.separator = value[0];
+            options.passphraseMode = true;
+        } else if (matchesOption(arg, "--capitalize")) {
+            options.passphrase.capitalize = true;
+            options.passphraseMode = true;
+        } else if (matchesOption(arg, "--wordlist")) {
+            options.wordlist = optionValue(argc, argv, i);
+            if (!options.wordlist) {
+                std::fprintf(stderr, "qenqey: не указан файл --wordlist\n");
+                return false;
+            }
+            options.passphraseMode = true;
+        } else if (matchesOption(arg, "--template")) {
+            options.templatePattern = optionValue(argc, argv, i);
+            if (!options.templatePattern) {
+                std::fprintf(stderr, "qenqey: не указан шаблон --template\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--pronounceable")) {
+            options.pronounceableMode = true;
+        } else if (matchesOption(arg, "--markov")) {
+            options.markovModel = optionValue(argc, argv, i);
+            if (!options.markovModel) {
+                std::fprintf(stderr, "qenqey: не указан файл --markov\n");
+                return false;
+            }
+            options.pronounceableMode = true;
+        } else if (matchesOption(arg, "--token")) {
+            const char *value = optionValue(argc, argv, i);
+            if (!value || !parseTokenEncoding(value, options.token.encoding)) {
+                std::fprintf(stderr, "qenqey: --token принимает hex, base64url, base32, crockford или uuid\n");
+                return false;
+            }
+            options.tokenMode = true;
+        } else if (matchesOption(arg, "--bytes")) {
+            if (!parseNumber(optionValue(argc, argv, i), number)
+                || number < MIN_TOKEN_BYTES || number > MAX_TOKEN_BYTES) {
+                std::fprintf(stderr, "qenqey: число байт должно быть от %d до %d\n",
+                             MIN_TOKEN_BYTES, MAX_TOKEN_BYTES);
+                return false;
+            }
+            options.token.bytes = static_cast<int>(number);
+            options.tokenMode = true;
+        } else if (matchesOption(arg, "--entropy")) {
+            options.entropy = true;
+        } else if (matchesOption(arg, "--threads")) {
+            if (!parseNumber(optionValue(argc, argv, i), number) || number > 4096) {
+                std::fprintf(stderr, "qenqey: неверное значение --threads\n");
+                return false;
+            }
+            options.bulk.threads = static_cast<unsigned>(number);
+        } else if (matchesOption(arg, "--unordered")) {
+            options.bulk.ordered = false;
+        } else if (matchesOption(arg, "--thread-stats")) {
+            options.threadStats = true;
+        } else if (matchesOption(arg, "--stats")) {
+            options.stats = true;
+        } else if (matchesOption(arg, "--reject-breached")) {
+            options.rejectBreached = true;
+        } else if (matchesOption(arg, "--unique-memory")) {
+            if (!parseNumber(optionValue(argc, argv, i), number) || number == 0 || number > (1ull << 24)) {
+                std::fprintf(stderr, "qenqey: неверное значение --unique-memory\n");
+                return false;
+            }
+            options.bulk.uniqueMemoryBudget = static_cast<size_t>(number) << 20;
+        } else if (matchesOption(arg, "--unique-dir")) {
+            const char *directory = optionValue(argc, argv, i);
+            if (!directory || !*directory) {
+                std::fprintf(stderr, "qenqey: не указан каталог --unique-dir\n");
+                return false;
+            }
+            options.bulk.uniqueSpillDirectory = directory;
+        } else if (matchesOption(arg, "--unique")) {
+            options.bulk.unique = true;
+        } else if (matchesOption(arg, "--daemon")) {
+            options.daemon = true;
+        } else if (matchesOption(arg, "--socket")) {
+            options.socketPath = optionValue(argc, argv, i);
+            if (!options.socketPath) {
+                std::fprintf(stderr, "qenqey: не указан путь --socket\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--format")) {
+            const char *value = optionValue(argc, argv, i);
+            if (!value || !parseExportFormat(value, options.bulk.format)) {
+                std::fprintf(stderr, "qenqey: --format принимает plain, csv, jsonl или binary\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--output")) {
+            options.outputPath = optionValue(argc, argv, i);
+            if (!options.outputPath) {
+                std::fprintf(stderr, "qenqey: не указан файл --output\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--audit")) {
+            options.auditPath = optionValue(argc, argv, i);
+            if (!options.auditPath) {
+                std::fprintf(stderr, "qenqey: не указан файл --audit\n");
+                return false;
+            }
+        } else if (matchesOption(arg, "--top")) {
+            if (!parseNumber(optionValue(argc, argv, i), number) || number > 1000000) {
+                std::fprintf(stderr, "qenqey: неверное значение --top\n");
+                return false;
+            }
+            options.auditWeakest = static_cast<size_t>(number);
+        } else if (matchesOption(arg, "--help")) {
+            options.help = true;
+        } else if (matchesOption(arg, "--version")) {
+            options.version = true;
+        } else {
+            std::fprintf(stderr, "qenqey: неизвестный параметр %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+void printHelp()
+{
+    std::printf(
+        "Использование: qenqey [параметры]\n"
+        "Без параметров запускается графический интерфейс.\n"
+        "\n"
+        "  --count N            количество паролей (по умолчанию 1)\n"
+        "  --length L           длина пароля, %d-%d (по умолчанию 16)\n"
+        "  --classes CLASSES    типы символов: u - заглавные, l - строчные,\n"
+        "                       d - цифры, s - символы (по умолчанию uld)\n"
+        "  --exclude-similar    исключить похожие символы (il1Lo0O)\n"
+        "  --min SPEC           минимум символов каждого типа, например u2,d3\n"
+        "                       (по умолчанию по одному каждого выбранного)\n"
+        "  --max-repeat K       не больше K одинаковых символов подряд, 1-%d\n"
+        "  --max-sequence S     не больше S символов по возрастанию подряд\n"
+        "                       (abc, 123), 1-%d\n"
+        "  --no-first CHARS     не начинать пароль с этих символов\n"
+        "  --words N            парольная фраза из N слов, %d-%d\n"
+        "  --separator C        разделитель слов: пробел, -, . или _ (по умолчанию -)\n"
+        "  --capitalize         начинать слова с заглавной буквы\n"
+        "  --wordlist FILE      список слов (.qqw, см. qenqey-index words)\n"
+        "  --template PATTERN   пароль по шаблону: A, a, 9, s, x, *, [набор], w, W, {n},\n"
+        "                       например Aaaa-9999-ssss или W.w.99s\n"
+        "  --pronounceable      произносимый пароль из строчных букв, длина задаётся\n"
+        "                       --length (по умолчанию %d)\n"
+        "  --markov FILE        модель букв для произносимых паролей\n"
+        "                       (.qqm, см. qenqey-index markov)\n"
+        "  --token ENCODING     токен из случайных байт: hex, base64url, base32,\n"
+        "                       crockford или uuid\n"
+        "  --bytes N            случайных байт в токене, %d-%d (по умолчанию %d)\n"
+        "  --entropy            вывести в stderr энтропию одного пароля\n"
+        "  --threads N          число потоков (по умолчанию по числу ядер)\n"
+        "  --unordered          выводить блоки по мере готовности, без сохранения порядка\n"
+        "  --thread-stats       вывести в stderr производительность каждого потока\n"
+        "  --stats              вывести в stderr счётчики и задержки в формате JSON\n"
+        "  --reject-breached    перегенерировать пароли, найденные в базе утечек\n"
+        "  --unique             гарантировать, что пароли в пакете не повторяются\n"
+        "  --unique-memory MB   память под таблицу повторов, сверх неё - временный файл\n"
+        "                       (по умолчанию 512)\n"
+        "  --unique-dir DIR     каталог для этого файла (по умолчанию ~/.cache/qenqey)\n"
+        "  --format FORMAT      формат вывода: plain, csv, jsonl или binary\n"
+        "                       (binary: длина в 2 байтах, затем пароль)\n"
+        "  --output FILE        записать пароли в файл (права 0600) вместо stdout\n"
+        "  --daemon             работать как служба на Unix-сокете (см. qenqey-client)\n"
+        "  --socket PATH        путь к сокету службы\n"
+        "                       (по умолчанию $XDG_RUNTIME_DIR/qenqey.sock)\n"
+        "  --audit FILE         оценить стойкость паролей из файла (по одному в строке)\n"
+        "  --top N              сколько самых слабых паролей показать при аудите\n"
+        "                       (по умолчанию %zu)\n"
+        "  --help               показать эту справку\n"
+        "  --version            показать версию\n",
+        MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH, MAX_RULE_RUN, MAX_RULE_RUN,
+        MIN_PASSPHRASE_WORDS, MAX_PASSPHRASE_WORDS, PronounceableSettings().length,
+        MIN_TOKEN_BYTES, MAX_TOKEN_BYTES, TokenSettings().bytes, DEFAULT_AUDIT_WEAKEST);
+}
+
+void printThreadStats(const BulkEngine &engine)
+{
+    const std::vector<ThreadStats> &stats = engine.threadStats();
+    uint64_t total = 0;
+    uint64_t rejected = 0;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const ThreadStats &s = stats[i];
+        const double rate = s.generateSeconds > 0 ? s.passwords / s.generateSeconds : 0.0;
+        std::fprintf(stderr,
+                     "поток %3zu: %12llu паролей, %8.2f млн/с "
+                     "(генерация %.3f с, ожидание %.3f с, запись %.3f с)\n",
+                     i, static_cast<unsigned long long>(s.passwords), rate / 1e6,
+                     s.generateSeconds, s.waitSeconds, s.writeSeconds);
+        total += s.passwords;
+        rejected += s.breachedRejected;
+    }
+
+    const double elapsed = engine.elapsedSeconds();
+    std::fprintf(stderr, "всего: %llu паролей за %.3f с, %.2f млн/с, потоков: %u, блок: %llu\n",
+                 static_cast<unsigned long long>(total), elapsed,
+                 elapsed > 0 ? total / elapsed / 1e6 : 0.0, engine.threadCount(),
+                 static_cast<unsigned long long>(engine.chunkSize()));
+    if (rejected > 0) {
+        std::fprintf(stderr, "отклонено как найденные в утечках: %llu\n",
+                     static_cast<unsigned long long>(rejected));
+    }
+}
+
+// Observed collision rate of a unique batch
+void printDuplicateStats(const BulkEngine &engine)
+{
+    uint64_t accepted = 0;
+    uint64_t duplicates = 0;
+    for (const ThreadStats &s : engine.threadStats()) {
+        accepted += s.passwords;
+        duplicates += s.duplicatesRejected;
+    }
+    const uint64_t generated = accepted + duplicates;
+    std::fprintf(stderr, "повторов отброшено: %llu из %llu (%.6f%%)%s\n",
+                 static_cast<unsigned long long>(duplicates),
+                 static_cast<unsigned long long>(generated),
+                 generated > 0 ? 100.0 * duplicates / generated : 0.0,
+                 engine.uniqueSetFileBacked() ? ", таблица во временном файле" : "");
+}
+
+const char *templateErrorMessage(TemplateError error)
+{
+    switch (error) {
+    case TemplateError::None: break;
+    case TemplateError::Empty: return "пустой шаблон";
+    case TemplateError::UnclosedSet: return "не закрыта скобка [";
+    case TemplateError::BadSet: return "неверный набор символов в [ ]";
+    case TemplateError::BadRepeat: return "неверное число повторов в { }";
+    case TemplateError::TooLong: return "слишком длинный результат";
+    case TemplateError::NoWordlist: return "список слов не найден (--wordlist, QENQEY_WORDLIST)";
+    case TemplateError::BadLiteral: return "допустимы только печатные символы ASCII";
+    }
+    return "неверный шаблон";
+}
+
+const char *ruleErrorMessage(RuleError error)
+{
+    switch (error) {
+    case RuleError::None: break;
+    case RuleError::NoClasses: return "не выбрано ни одного типа символов";
+    case RuleError::UnselectedMinimum: return "--min задаёт минимум для невыбранного типа символов";
+    case RuleError::BadLimit: return "ограничение вне допустимого диапазона";
+    case RuleError::Impossible: return "ни один пароль не удовлетворяет правилам";
+    case RuleError::TooComplex: return "слишком сложные правила для такой длины";
+    }
+    return "неверные правила";
+}
+
+const char *patternName(WeakestPattern pattern)
+{
+    switch (pattern) {
+    case WeakestPattern::Dictionary: return "словарное слово";
+    case WeakestPattern::Spatial: return "клавиатурная последовательность";
+    case WeakestPattern::Repeat: return "повторы";
+    case WeakestPattern::Sequence: return "последовательность символов";
+    case WeakestPattern::Year: return "год";
+    case WeakestPattern::None: break;
+    }
+    return "перебор";
+}
+
+void printAuditReport(const AuditReport &report)
+{
+    constexpr int BAR_WIDTH = 40;
+    std::printf("записей: %llu, пустых строк: %llu, %.1f МБ за %.3f с (%.0f тыс./с), потоков: %u\n",
+                static_cast<unsigned long long>(report.entries),
+                static_cast<unsigned long long>(report.emptyLines), report.bytes / 1e6, report.seconds,
+                report.seconds > 0 ? report.entries / report.seconds / 1e3 : 0.0, report.threads);
+
+    uint64_t largest = 1;
+    for (uint64_t count : report.bands) {
+        largest = std::max(largest, count);
+    }
+    std::printf("\nоценка      записей\n");
+    for (int b = 0; b < AUDIT_BANDS; ++b) {
+        const uint64_t count = report.bands[b];
+        const int bar = static_cast<int>((count * BAR_WIDTH + largest - 1) / largest);
+        std::printf("%3d-%-3d %12llu %6.2f%%%s%.*s\n", b * 10, b == AUDIT_BANDS - 1 ? 100 : b * 10 + 9,
+                    static_cast<unsigned long long>(count),
+                    report.entries > 0 ? 100.0 * count / report.entries : 0.0, bar > 0 ? " " : "", bar,
+                    "########################################");
+    }
+
+    if (!report.weakest.empty()) {
+        std::printf("\nсамые слабые:\n");
+    }
+    for (const AuditFinding &finding : report.weakest) {
+        std::printf("строка %llu: оценка %d, %.1f бит, %s: %s\n",
+                    static_cast<unsigned long long>(finding.line), finding.estimate.score,
+                    finding.estimate.bits, patternName(finding.estimate.weakest), finding.password.c_str());
+    }
+}
+
+int runAudit(const Options &options)
+{
+    AuditOptions auditOptions;
+    auditOptions.threads = options.bulk.threads;
+    auditOptions.weakest = options.auditWeakest;
+
+    AuditEngine engine(auditOptions);
+    if (!engine.run(options.auditPath)) {
+        std::fprintf(stderr, "qenqey: %s: %s\n", options.auditPath, engine.errorString().c_str());
+        return 1;
+    }
+    printAuditReport(engine.report());
+    return 0;
+}
+
+int runDaemon(const Options &options)
+{
+    DaemonOptions daemonOptions;
+    if (options.socketPath) {
+        daemonOptions.socketPath = options.socketPath;
+    }
+    daemonOptions.rejectBreached = options.bulk.rejectBreached;
+    daemonOptions.handleSignals = true;
+
+    Wordlist customWordlist;
+    if (options.wordlist) {
+        if (!customWordlist.open(options.wordlist)) {
+            std::fprintf(stderr, "qenqey: список слов не найден: %s\n", options.wordlist);
+            return 2;
+        }
+        daemonOptions.wordlist = &customWordlist;
+    }
+
+    DaemonServer server(daemonOptions);
+    std::string error;
+    if (!server.listen(&error)) {
+        std::fprintf(stderr, "qenqey: %s\n", error.c_str());
+        return 1;
+    }
+    return server.run() ? 0 : 1;
+}
+
+int generatePasswords(Options &options)
+{
+    const CharsetPlan plan(options.settings);
+    Wordlist customWordlist;
+    PassphrasePlan passphrase;
+    TemplatePlan templatePlan;
+    ConstrainedPlan constrained;
+    MarkovModel customModel;
+    PronounceablePlan pronounceable;
+    TokenPlan token;
+    const PasswordSource *source = &plan;
+
+    if (options.templatePattern) {
+        const Wordlist *wordlist = Wordlist::shared();
+        if (options.wordlist) {
+            wordlist = customWordlist.open(options.wordlist) ? &customWordlist : nullptr;
+        }
+        templatePlan = TemplatePlan(options.templatePattern, wordlist);
+        if (!templatePlan.isValid()) {
+            std::fprintf(stderr, "qenqey: шаблон, позиция %zu: %s\n", templatePlan.errorPosition() + 1,
+                         templateErrorMessage(templatePlan.error()));
+            return 2;
+        }
+        source = &templatePlan;
+    } else if (options.pronounceableMode) {
+        const MarkovModel *model = MarkovModel::shared();
+        if (options.markovModel) {
+            model = customModel.open(options.markovModel) ? &customModel : nullptr;
+        }
+        if (!model) {
+            std::fprintf(stderr, "qenqey: модель букв не найдена (--markov, QENQEY_MARKOV)\n");
+            return 2;
+        }
+        pronounceable = PronounceablePlan(model, options.pronounceable);
+        source = &pronounceable;
+    } else if (options.tokenMode) {
+        token = TokenPlan(options.token);
+        source = &token;
+    } else if (options.passphraseMode) {
+        const Wordlist *wordlist = Wordlist::shared();
+        if (options.wordlist) {
+            wordlist = customWordlist.open(options.wordlist) ? &customWordlist : nullptr;
+        }
+        if (!wordlist) {
+            std::fprintf(stderr, "qenqey: список слов не найден (--wordlist, QENQEY_WORDLIST)\n");
+            return 2;
+        }
+        passphrase = PassphrasePlan(wordlist, options.passphrase);
+        source = &passphrase;
+    } else if (!plan.isValid()) {
+        std::fprintf(stderr, "qenqey: не выбрано ни одного типа символов\n");
+        return 2;
+    } else if (!options.rules.isDefault()) {
+        constrained = ConstrainedPlan(options.settings, options.rules);
+        if (!constrained.isValid()) {
+            std::fprintf(stderr, "qenqey: %s\n", ruleErrorMessage(constrained.error()));
+            return 2;
+        }
+        source = &constrained;
+    }
+
+    if (options.entropy) {
+        // Words without a separator between them can coincide
+        const bool upperBound = source == &templatePlan && !templatePlan.isEntropyExact();
+        std::fprintf(stderr, "энтропия: %s%.2f бит\n", upperBound ? "не более " : "", source->entropyBits());
+    }
+
+    if (options.rejectBreached) {
+        options.bulk.rejectBreached = BreachCorpus::shared();
+        if (!options.bulk.rejectBreached) {
+            std::fprintf(stderr, "qenqey: база утечек не найдена (QENQEY_BREACH_CORPUS)\n");
+            return 2;
+        }
+    }
+
+    if (options.daemon) {
+        return runDaemon(options);
+    }
+
+    if (options.bulk.unique && std::log2(static_cast<double>(options.bulk.count)) > source->entropyBits()) {
+        std::fprintf(stderr, "qenqey: при таких настройках различных паролей меньше, чем --count\n");
+        return 2;
+    }
+
+    int fd = 1;
+    if (options.outputPath) {
+        fd = open(options.outputPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            std::fprintf(stderr, "qenqey: %s: %s\n", options.outputPath, std::strerror(errno));
+            return 1;
+        }
+    }
+
+    BulkEngine engine(*source, options.bulk);
+    bool ok = engine.run(fd);
+    if (fd != 1 && close(fd) < 0) {
+        ok = false;
+    }
+
+    if (options.threadStats) {
+        printThreadStats(engine);
+    }
+    if (options.bulk.unique) {
+        printDuplicateStats(engine);
+    }
+
+    if (!ok && engine.breachExhausted()) {
+        std::fprintf(stderr, "qenqey: почти все пароли с такими настройками есть в базе утечек, "
+                             "генерация прервана: %s\n", engine.errorString().c_str());
+        return 1;
+    }
+    if (!ok && engine.uniqueExhausted()) {
+        std::fprintf(stderr, "qenqey: генерация без повторов прервана: %s\n", engine.errorString().c_str());
+        return 1;
+    }
+    if (!ok && !engine.errorString().empty()) {
+        std::fprintf(stderr, "qenqey: %s\n", engine.errorString().c_str());
+        return 1;
+    }
+    if (!ok) {
+        std::fprintf(stderr, "qenqey: ошибка записи в %s\n",
+                     options.outputPath ? options.outputPath : "стандартный вывод");
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+bool isCliInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *option : CLI_OPTIONS) {
+            if (matchesOption(argv[i], option)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int run(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+    if (options.help) {
+        printHelp();
+        return 0;
+    }
+    if (options.version) {
+        std::printf("qenqey 1.0.0\n");
+        return 0;
+    }
+
+    // Printed however the run ends, including daemon shutdown
+    if (options.stats) {
+        Metrics::enable();
+    }
+    const int status = options.auditPath ? runAudit(options) : generatePasswords(options);
+    if (options.stats) {
+        std::fputs(Metrics::toJson(Metrics::snapshot()).c_str(), stderr);
+    }
+    return status;
+}
+
+} // namespace cli
+} // namespace qenqey
@@ -0,0 +1,16 @@
+#ifndef QENQEY_CLI_H
+#define QENQEY_CLI_H
+
+namespace qenqey {
+namespace cli {
+
+// True when the arguments ask for headless mode, so main() can skip
+// QApplication construction entirely
+bool isCliInvocation(int argc, char *argv[]);
+
+int run(int argc, char *argv[]);
+
+} // namespace cli
+} // namespace qenqey
+
+#endif // QENQEY_CLI_H
@@ -0,0 +1,247 @@
+#include "audit.h"
+#include "dictionary.h"
+#include "mappedfile.h"
+#include "metrics.h"
+#include "securememory.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#include <sys/stat.h>
+
+namespace qenqey {
+
+namespace {
+
+// Large enough that claiming a chunk is noise, small enough that a few
+// hundred megabytes still spread evenly over the workers
+constexpr uint64_t CHUNK_BYTES = 1024 * 1024;
+
+// A scored line that may end up among the weakest. Only its place in the
+// mapping is kept until the final list is known.
+struct Candidate
+{
+    StrengthEstimate estimate;
+    uint64_t chunk;
+    uint64_t lineInChunk;
+    uint64_t offset;
+    size_t length;
+};
+
+// Lower bits first, then file order
+bool weaker(const Candidate &a, const Candidate &b)
+{
+    if (a.estimate.bits != b.estimate.bits) {
+        return a.estimate.bits < b.estimate.bits;
+    }
+    return a.chunk != b.chunk ? a.chunk < b.chunk : a.lineInChunk < b.lineInChunk;
+}
+
+struct WorkerState
+{
+    uint64_t entries = 0;
+    uint64_t emptyLines = 0;
+    uint64_t bands[AUDIT_BANDS] = {};
+
+    // Max-heap under weaker(): the strongest of the kept candidates is
+    // on top, ready to be displaced
+    std::vector<Candidate> weakest;
+};
+
+// Chunks start just after the first newline at or past their nominal
+// offset, so every worker finds the same boundaries on its own
+uint64_t chunkStart(const unsigned char *data, uint64_t size, uint64_t chunk)
+{
+    if (chunk == 0) {
+        return 0;
+    }
+    const uint64_t nominal = chunk * CHUNK_BYTES;
+    if (nominal >= size) {
+        return size;
+    }
+    const void *newline = std::memchr(data + nominal - 1, '\n', size - nominal + 1);
+    return newline ? static_cast<uint64_t>(static_cast<const unsigned char *>(newline) - data) + 1 : size;
+}
+
+} // namespace
+
+AuditReport::~AuditReport()
+{
+    for (AuditFinding &finding : weakest) {
+        secureZero(&finding.password[0], finding.password.size());
+    }
+}
+
+AuditEngine::AuditEngine(const AuditOptions &options)
+    : m_options(options)
+    , m_cancelled(false)
+{
+}
+
+bool AuditEngine::run(const std::string &path)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (AuditFinding &finding : m_report.weakest) {
+        secureZero(&finding.password[0], finding.password.size());
+    }
+    m_report.weakest.clear();
+    m_report.entries = 0;
+    m_report.emptyLines = 0;
+    m_report.bytes = 0;
+    std::fill(std::begin(m_report.bands), std::end(m_report.bands), 0);
+    m_report.threads = 0;
+    m_report.seconds = 0.0;
+    m_cancelled = false;
+    m_error.clear();
+
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        m_error = std::strerror(errno);
+        return false;
+    }
+    if (info.st_size == 0) {
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.open(path, MappedFile::Sequential)) {
+        m_error = "cannot map the file";
+        return false;
+    }
+    const unsigned char *const data = file.data();
+    const uint64_t size = file.size();
+    const uint64_t chunks = (size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+
+    unsigned threads = m_options.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<uint64_t>(threads, chunks));
+
+    const Dictionary *const dictionary = Dictionary::shared();
+    const size_t keep = m_options.weakest;
+    std::vector<WorkerState> states(threads);
+    // Lines per chunk, for turning a line within a chunk into a file line
+    std::vector<uint64_t> chunkLines(chunks, 0);
+    std::atomic<uint64_t> nextChunk(0);
+    std::atomic<bool> cancelled(false);
+
+    auto worker = [&](unsigned index) {
+        WorkerState &state = states[index];
+        state.weakest.reserve(keep);
+
+        for (;;) {
+            const uint64_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunks) {
+                break;
+            }
+            if (m_options.cancel && m_options.cancel->load(std::memory_order_relaxed)) {
+                cancelled = true;
+                break;
+            }
+
+            const uint64_t begin = chunkStart(data, size, chunk);
+            const uint64_t end = chunkStart(data, size, chunk + 1);
+            const unsigned char *p = data + begin;
+            const unsigned char *const stop = data + end;
+            uint64_t line = 0;
+
+            for (; p < stop; ++line) {
+                const void *newline = std::memchr(p, '\n', static_cast<size_t>(stop - p));
+                const unsigned char *const lineEnd =
+                    newline ? static_cast<const unsigned char *>(newline) : stop;
+                size_t length = static_cast<size_t>(lineEnd - p);
+                if (length > 0 && p[length - 1] == '\r') {
+                    --length;
+                }
+
+                if (length == 0) {
+                    ++state.emptyLines;
+                } else {
+                    const uint64_t started =
+                        state.entries % Metrics::SAMPLE_INTERVAL == 0 ? Metrics::start() : 0;
+                    const StrengthEstimate estimate = estimateStrength(
+                        std::string_view(reinterpret_cast<const char *>(p), length), dictionary);
+                    Metrics::stop(Metrics::StrengthScoring, started);
+
+                    ++state.entries;
+                    ++state.bands[std::min(estimate.score / 10, AUDIT_BANDS - 1)];
+
+                    const Candidate candidate{estimate, chunk, line, static_cast<uint64_t>(p - data), length};
+                    if (state.weakest.size() < keep) {
+                        state.weakest.push_back(candidate);
+                        std::push_heap(state.weakest.begin(), state.weakest.end(), weaker);
+                    } else if (keep > 0 && weaker(candidate, state.weakest.front())) {
+                        std::pop_heap(state.weakest.begin(), state.weakest.end(), weaker);
+                        state.weakest.back() = candidate;
+                        std::push_heap(state.weakest.begin(), state.weakest.end(), weaker);
+                    }
+                }
+                p = lineEnd + 1;
+            }
+
+            chunkLines[chunk] = line;
+            if (m_options.progress) {
+                m_options.progress->fetch_add(end - begin, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            pool.emplace_back(worker, i);
+        }
+        for (std::thread &thread : pool) {
+            thread.join();
+        }
+    }
+
+    m_report.threads = threads;
+    m_report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (cancelled) {
+        m_cancelled = true;
+        return false;
+    }
+
+    std::vector<Candidate> weakest;
+    for (const WorkerState &state : states) {
+        m_report.entries += state.entries;
+        m_report.emptyLines += state.emptyLines;
+        for (int b = 0; b < AUDIT_BANDS; ++b) {
+            m_report.bands[b] += state.bands[b];
+        }
+        weakest.insert(weakest.end(), state.weakest.begin(), state.weakest.end());
+    }
+    std::sort(weakest.begin(), weakest.end(), weaker);
+    if (weakest.size() > keep) {
+        weakest.resize(keep);
+    }
+
+    // Lines before each chunk
+    std::vector<uint64_t> firstLine(chunks, 0);
+    for (uint64_t c = 1; c < chunks; ++c) {
+        firstLine[c] = firstLine[c - 1] + chunkLines[c - 1];
+    }
+
+    m_report.weakest.reserve(weakest.size());
+    for (const Candidate &candidate : weakest) {
+        // Built in place: a moved-from string could leave a copy behind
+        m_report.weakest.emplace_back();
+        AuditFinding &finding = m_report.weakest.back();
+        finding.line = firstLine[candidate.chunk] + candidate.lineInChunk + 1;
+        finding.estimate = candidate.estimate;
+        finding.password.assign(reinterpret_cast<const char *>(data + candidate.offset), candidate.length);
+    }
+    m_report.bytes = size;
+    return true;
+}
+
+} // namespace qenqey
@@ -0,0 +1,91 @@
+#ifndef QENQEY_CORE_AUDIT_H
+#define QENQEY_CORE_AUDIT_H
+
+#include "estimator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace qenqey {
+
+// Histogram bands of ten score points; 100 falls into the last one
+constexpr int AUDIT_BANDS = 10;
+
+constexpr size_t DEFAULT_AUDIT_WEAKEST = 20;
+
+struct AuditOptions
+{
+    // 0 picks std::thread::hardware_concurrency()
+    unsigned threads = 0;
+
+    // How many of the weakest entries to report
+    size_t weakest = DEFAULT_AUDIT_WEAKEST;
+
+    // Bytes of the file scanned so far, bumped after every chunk
+    std::atomic<uint64_t> *progress = nullptr;
+
+    // Polled between chunks; once set, run() stops and returns false
+    const std::atomic<bool> *cancel = nullptr;
+};
+
+struct AuditFinding
+{
+    // 1-based line in the input file
+    uint64_t line = 0;
+    StrengthEstimate estimate;
+    std::string password;
+};
+
+struct AuditReport
+{
+    AuditReport() = default;
+    // Wipes the copied passwords
+    ~AuditReport();
+
+    AuditReport(const AuditReport &) = delete;
+    AuditReport &operator=(const AuditReport &) = delete;
+
+    uint64_t entries = 0;
+    uint64_t emptyLines = 0;
+    uint64_t bytes = 0;
+    uint64_t bands[AUDIT_BANDS] = {};
+
+    // Weakest first; ties keep file order
+    std::vector<AuditFinding> weakest;
+
+    unsigned threads = 0;
+    double seconds = 0.0;
+};
+
+// Scores every line of a password file with the strength estimator. The
+// file is memory-mapped and cut into chunks on line boundaries, which a
+// pool of workers claims one at a time. Lines are scored straight from
+// the mapping; only the weakest ones are ever copied out.
+class AuditEngine
+{
+public:
+    explicit AuditEngine(const AuditOptions &options);
+
+    // Audits the file at path, one password per line ("\n" or "\r\n").
+    // False when the file cannot be read or the run was cancelled.
+    bool run(const std::string &path);
+
+    const AuditReport &report() const { return m_report; }
+
+    bool wasCancelled() const { return m_cancelled; }
+
+    // Why the last run() failed, when it was not cancelled
+    const std::string &errorString() const { return m_error; }
+
+private:
+    AuditOptions m_options;
+    AuditReport m_report;
+    bool m_cancelled;
+    std::string m_error;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_AUDIT_H
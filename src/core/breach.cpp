@@ -0,0 +1,347 @@
+#include "breach.h"
+#include "siphash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <sys/stat.h>
+
+namespace qenqey {
+
+namespace {
+
+constexpr char BLOOM_MAGIC[4] = {'Q', 'Q', 'B', '2'};
+
+// The filter records which corpus it was built from. A stale one would
+// answer "not breached" for every hash added since, so it is only used
+// when the corpus still has the same count, modification time and
+// sampled digests.
+struct BloomHeader
+{
+    char magic[4];
+    uint32_t hashCount;
+    uint64_t bitCount;
+    uint64_t corpusCount;
+    int64_t corpusModifiedNs;
+    uint64_t corpusSample;
+};
+
+// Digests hashed into BloomHeader::corpusSample, the first and last
+// among them; few enough to cost a handful of page faults at open
+constexpr uint64_t CORPUS_SAMPLES = 64;
+
+// Interpolation probes before falling back to plain bisection, which
+// bounds the worst case on skewed or adversarial files
+constexpr int MAX_INTERPOLATION_PROBES = 8;
+
+uint64_t loadBigEndian64(const uint8_t *bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+// Double hashing (Kirsch-Mitzenmacher). SHA-1 output is already uniform,
+// so the two halves of the digest tail serve as independent hashes.
+void bloomHashes(const uint8_t *digest, uint64_t &h1, uint64_t &h2)
+{
+    std::memcpy(&h1, digest + 4, sizeof(h1));
+    std::memcpy(&h2, digest + 12, sizeof(h2));
+    h2 |= 1;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+int64_t modifiedNs(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        return -1;
+    }
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+uint64_t corpusSample(const uint8_t *records, uint64_t count)
+{
+    static const uint64_t key[2] = {0, 0};
+    uint8_t sample[CORPUS_SAMPLES * SHA1_DIGEST_SIZE];
+    const uint64_t samples = std::min(count, CORPUS_SAMPLES);
+    for (uint64_t i = 0; i < samples; ++i) {
+        const uint64_t index = samples > 1 ? i * (count - 1) / (samples - 1) : 0;
+        std::memcpy(sample + i * SHA1_DIGEST_SIZE, records + index * SHA1_DIGEST_SIZE, SHA1_DIGEST_SIZE);
+    }
+    return sipHash24(key, reinterpret_cast<const char *>(sample), samples * SHA1_DIGEST_SIZE);
+}
+
+bool parseHexDigest(const char *text, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    for (size_t i = 0; i < SHA1_DIGEST_SIZE; ++i) {
+        const int high = hexValue(text[2 * i]);
+        const int low = hexValue(text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        digest[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+} // namespace
+
+const BreachCorpus *BreachCorpus::shared()
+{
+    static BreachCorpus corpus;
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        const std::string path = findDataFile("QENQEY_BREACH_CORPUS", "breached-sha1.bin");
+        if (!path.empty()) {
+            corpus.open(path);
+        }
+    });
+
+    return corpus.isOpen() ? &corpus : nullptr;
+}
+
+bool BreachCorpus::open(const std::string &path)
+{
+    m_count = 0;
+    m_bloom.close();
+    m_bloomBits = nullptr;
+
+    if (!m_corpus.open(path, MappedFile::Random)) {
+        return false;
+    }
+    if (m_corpus.size() == 0 || m_corpus.size() % SHA1_DIGEST_SIZE != 0) {
+        m_corpus.close();
+        return false;
+    }
+    m_count = m_corpus.size() / SHA1_DIGEST_SIZE;
+
+    // The filter is optional; a missing or inconsistent one is ignored
+    if (m_bloom.open(path + ".bloom", MappedFile::Random) && m_bloom.size() >= sizeof(BloomHeader)) {
+        BloomHeader header;
+        std::memcpy(&header, m_bloom.data(), sizeof(header));
+        if (std::memcmp(header.magic, BLOOM_MAGIC, sizeof(BLOOM_MAGIC)) == 0 && header.hashCount > 0
+            && header.bitCount > 0 && (m_bloom.size() - sizeof(header)) * 8 >= header.bitCount
+            && header.corpusCount == m_count && header.corpusModifiedNs == modifiedNs(path)
+            && header.corpusSample == corpusSample(m_corpus.data(), m_count)) {
+            m_bloomBits = m_bloom.data() + sizeof(header);
+            m_bloomBitCount = header.bitCount;
+            m_bloomHashes = header.hashCount;
+        }
+    }
+    if (!m_bloomBits) {
+        m_bloom.close();
+    }
+    return true;
+}
+
+bool BreachCorpus::bloomMayContain(const uint8_t digest[SHA1_DIGEST_SIZE]) const
+{
+    uint64_t h1;
+    uint64_t h2;
+    bloomHashes(digest, h1, h2);
+    for (uint32_t i = 0; i < m_bloomHashes; ++i) {
+        const uint64_t bit = (h1 + i * h2) % m_bloomBitCount;
+        if (!(m_bloomBits[bit >> 3] & (1u << (bit & 7)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BreachCorpus::contains(const uint8_t digest[SHA1_DIGEST_SIZE]) const
+{
+    if (m_count == 0 || (m_bloomBits && !bloomMayContain(digest))) {
+        return false;
+    }
+
+    const uint64_t key = loadBigEndian64(digest);
+    uint64_t low = 0;
+    uint64_t high = m_count; // exclusive
+
+    for (int probe = 0; probe < MAX_INTERPOLATION_PROBES && low < high; ++probe) {
+        const uint64_t lowKey = loadBigEndian64(record(low));
+        const uint64_t highKey = loadBigEndian64(record(high - 1));
+        if (key < lowKey || key > highKey) {
+            return false;
+        }
+        if (highKey == lowKey) {
+            break;
+        }
+
+        const uint64_t offset = static_cast<uint64_t>(
+            static_cast<unsigned __int128>(key - lowKey) * (high - 1 - low) / (highKey - lowKey));
+        const uint64_t middle = low + offset;
+        const int order = std::memcmp(digest, record(middle), SHA1_DIGEST_SIZE);
+        if (order == 0) {
+            return true;
+        }
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    while (low < high) {
+        const uint64_t middle = low + (high - low) / 2;
+        const int order = std::memcmp(digest, record(middle), SHA1_DIGEST_SIZE);
+        if (order == 0) {
+            return true;
+        }
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return false;
+}
+
+bool BreachCorpus::containsPassword(std::string_view utf8) const
+{
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    sha1(utf8.data(), utf8.size(), digest);
+    return contains(digest);
+}
+
+bool writeBreachCorpus(const std::string &textPath, const std::string &outputPath,
+                       std::string *error)
+{
+    auto fail = [error](const std::string &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    FILE *in = std::fopen(textPath.c_str(), "r");
+    if (!in) {
+        return fail("cannot open " + textPath);
+    }
+    FILE *out = std::fopen(outputPath.c_str(), "wb");
+    if (!out) {
+        std::fclose(in);
+        return fail("cannot open " + outputPath + " for writing");
+    }
+
+    char line[256];
+    uint8_t previous[SHA1_DIGEST_SIZE] = {};
+    uint64_t lineNumber = 0;
+    uint64_t written = 0;
+    bool ok = true;
+    std::string message;
+
+    while (ok && std::fgets(line, sizeof(line), in)) {
+        ++lineNumber;
+        const size_t length = std::strcspn(line, ":\r\n");
+        if (length == 0) {
+            continue;
+        }
+
+        uint8_t digest[SHA1_DIGEST_SIZE];
+        if (length != 2 * SHA1_DIGEST_SIZE || !parseHexDigest(line, digest)) {
+            message = textPath + ":" + std::to_string(lineNumber) + ": not a SHA-1 hex digest";
+            ok = false;
+            break;
+        }
+
+        const int order = written > 0 ? std::memcmp(previous, digest, SHA1_DIGEST_SIZE) : -1;
+        if (order > 0) {
+            message = textPath + ":" + std::to_string(lineNumber) + ": input is not sorted by hash";
+            ok = false;
+            break;
+        }
+        if (order == 0) {
+            continue;
+        }
+
+        ok = std::fwrite(digest, SHA1_DIGEST_SIZE, 1, out) == 1;
+        if (!ok) {
+            message = "write to " + outputPath + " failed";
+        }
+        std::memcpy(previous, digest, SHA1_DIGEST_SIZE);
+        ++written;
+    }
+
+    std::fclose(in);
+    if (std::fclose(out) != 0 && ok) {
+        ok = false;
+        message = "write to " + outputPath + " failed";
+    }
+    if (ok && written == 0) {
+        ok = false;
+        message = textPath + ": no hashes found";
+    }
+    return ok || fail(message);
+}
+
+bool writeBreachBloomFilter(const std::string &corpusPath, const std::string &outputPath,
+                            unsigned bitsPerEntry, std::string *error)
+{
+    auto fail = [error](const std::string &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    MappedFile corpus;
+    if (!corpus.open(corpusPath, MappedFile::Sequential) || corpus.size() == 0
+        || corpus.size() % SHA1_DIGEST_SIZE != 0) {
+        return fail(corpusPath + ": not a breach corpus");
+    }
+
+    bitsPerEntry = std::clamp(bitsPerEntry, 1u, 64u);
+    const uint64_t count = corpus.size() / SHA1_DIGEST_SIZE;
+
+    BloomHeader header;
+    std::memcpy(header.magic, BLOOM_MAGIC, sizeof(BLOOM_MAGIC));
+    // k = ln 2 * m/n minimises the false positive rate
+    header.hashCount = std::clamp<uint32_t>(static_cast<uint32_t>(std::lround(bitsPerEntry * 0.693)), 1, 16);
+    header.bitCount = std::max<uint64_t>(count * bitsPerEntry, 64) / 64 * 64;
+    header.corpusCount = count;
+    header.corpusModifiedNs = modifiedNs(corpusPath);
+    header.corpusSample = corpusSample(corpus.data(), count);
+
+    std::vector<uint8_t> bits(header.bitCount / 8);
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t h1;
+        uint64_t h2;
+        bloomHashes(corpus.data() + i * SHA1_DIGEST_SIZE, h1, h2);
+        for (uint32_t k = 0; k < header.hashCount; ++k) {
+            const uint64_t bit = (h1 + k * h2) % header.bitCount;
+            bits[bit >> 3] |= static_cast<uint8_t>(1u << (bit & 7));
+        }
+    }
+
+    FILE *out = std::fopen(outputPath.c_str(), "wb");
+    if (!out) {
+        return fail("cannot open " + outputPath + " for writing");
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+        && std::fwrite(bits.data(), 1, bits.size(), out) == bits.size();
+    ok = std::fclose(out) == 0 && ok;
+    return ok || fail("write to " + outputPath + " failed");
+}
+
+} // namespace qenqey
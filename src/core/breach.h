@@ -0,0 +1,72 @@
+#ifndef QENQEY_CORE_BREACH_H
+#define QENQEY_CORE_BREACH_H
+
+#include "mappedfile.h"
+#include "sha1.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qenqey {
+
+// Offline "has this password been breached" check against a local copy
+// of an HIBP-style SHA-1 corpus.
+//
+// The corpus is a flat file of sorted 20-byte SHA-1 digests (no header,
+// ~20 GB for a billion entries), memory-mapped and searched by
+// interpolation on the leading 64 bits. Uniformly distributed hashes make
+// that converge in a handful of probes, i.e. a handful of page faults,
+// and nothing is read into RAM up front.
+//
+// An optional Bloom filter next to it (same path + ".bloom") answers most
+// misses without touching the corpus at all. It is ignored unless it was
+// built from the corpus as it is now, so a filter left over from before a
+// rebuild cannot hide new entries.
+class BreachCorpus
+{
+public:
+    BreachCorpus() = default;
+
+    // Process-wide corpus, mapped on first call from $QENQEY_BREACH_CORPUS
+    // or the data directories. nullptr when none is installed.
+    static const BreachCorpus *shared();
+
+    bool open(const std::string &path);
+    bool isOpen() const { return m_corpus.isOpen(); }
+    uint64_t size() const { return m_count; }
+    bool hasBloomFilter() const { return m_bloomBits != nullptr; }
+
+    bool contains(const uint8_t digest[SHA1_DIGEST_SIZE]) const;
+    bool containsPassword(std::string_view utf8) const;
+
+private:
+    bool bloomMayContain(const uint8_t digest[SHA1_DIGEST_SIZE]) const;
+    const uint8_t *record(uint64_t index) const { return m_corpus.data() + index * SHA1_DIGEST_SIZE; }
+
+    MappedFile m_corpus;
+    uint64_t m_count = 0;
+
+    MappedFile m_bloom;
+    const uint8_t *m_bloomBits = nullptr;
+    uint64_t m_bloomBitCount = 0;
+    uint32_t m_bloomHashes = 0;
+};
+
+// Breached candidates in a row after which a caller fails instead of
+// handing one out; only tiny charsets (e.g. 4 digits) can reach it
+constexpr int MAX_BREACH_RETRIES = 64;
+
+// Converts "HEXDIGEST[:count]" lines (the HIBP download format, sorted by
+// hash) into the binary corpus. Fails on malformed or unsorted input.
+bool writeBreachCorpus(const std::string &textPath, const std::string &outputPath,
+                       std::string *error = nullptr);
+
+// Builds a Bloom filter for a binary corpus with the given bits per entry
+bool writeBreachBloomFilter(const std::string &corpusPath, const std::string &outputPath,
+                            unsigned bitsPerEntry, std::string *error = nullptr);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_BREACH_H
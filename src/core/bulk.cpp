@@ -0,0 +1,304 @@
+#include "bulk.h"
+#include "breach.h"
+#include "metrics.h"
+#include "output.h"
+#include "random.h"
+#include "securememory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace qenqey {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Roughly how much output a chunk should hold: large enough to amortise
+// the shared-state traffic, small enough to keep all workers busy
+constexpr size_t CHUNK_BYTES = 256 * 1024;
+
+// Unique batches hash each password this many passwords before inserting
+// it, so the prefetched table slot is in cache by then
+constexpr size_t UNIQUE_PIPELINE = 8;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct SharedState
+{
+    std::atomic<uint64_t> nextChunk{0};
+    std::mutex mutex;
+    std::condition_variable turn;
+    uint64_t nextToWrite = 0;
+    bool failed = false;
+    bool cancelled = false;
+    bool exhausted = false;
+    bool breached = false;
+};
+
+} // namespace
+
+BulkEngine::BulkEngine(const PasswordSource &source, const BulkOptions &options)
+    : m_source(source)
+    , m_options(options)
+    , m_threads(options.threads)
+    , m_elapsed(0.0)
+    , m_cancelled(false)
+    , m_breachExhausted(false)
+    , m_uniqueExhausted(false)
+    , m_uniqueFileBacked(false)
+{
+    if (m_threads == 0) {
+        m_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const size_t recordSize = maxRecordSize(options.format, source.maxLength());
+    m_chunkSize = std::max<uint64_t>(1, CHUNK_BYTES / recordSize);
+
+    // No point in workers that would never get a chunk
+    const uint64_t chunks = (options.count + m_chunkSize - 1) / m_chunkSize;
+    m_threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(m_threads, chunks)));
+}
+
+bool BulkEngine::generateChecked(RandomStream &random, char *password, size_t &length, ThreadStats &stats) const
+{
+    length = m_source.generate(random, password);
+    if (!m_options.rejectBreached) {
+        return true;
+    }
+    for (int attempt = 0; m_options.rejectBreached->containsPassword(std::string_view(password, length));
+         ++attempt) {
+        ++stats.breachedRejected;
+        if (attempt + 1 == MAX_BREACH_RETRIES) {
+            return false;
+        }
+        length = m_source.generate(random, password);
+    }
+    return true;
+}
+
+BulkEngine::ChunkError BulkEngine::generateUnique(RandomStream &random, FingerprintSet &seen, char *scratch,
+                                uint64_t count, char *&out, ThreadStats &stats) const
+{
+    const size_t slotSize = m_source.maxLength() + 1;
+    size_t lengths[UNIQUE_PIPELINE];
+    uint64_t fingerprints[UNIQUE_PIPELINE];
+
+    // Inserts the password in slot, regenerating it while it is a
+    // duplicate, then encodes it
+    auto commit = [&](size_t slot) {
+        char *const password = scratch + slot * slotSize;
+        size_t length = lengths[slot];
+        uint64_t fingerprint = fingerprints[slot];
+        for (int attempt = 0; !seen.insertFingerprint(fingerprint); ++attempt) {
+            ++stats.duplicatesRejected;
+            if (attempt + 1 == MAX_UNIQUE_RETRIES) {
+                return ChunkError::Duplicates;
+            }
+            if (!generateChecked(random, password, length, stats)) {
+                return ChunkError::Breached;
+            }
+            fingerprint = seen.fingerprint(std::string_view(password, length));
+        }
+        out += encodeRecord(m_options.format, password, length, out);
+        return ChunkError::None;
+    };
+
+    for (uint64_t i = 0; i < count; ++i) {
+        const size_t slot = i % UNIQUE_PIPELINE;
+        if (i >= UNIQUE_PIPELINE) {
+            const ChunkError error = commit(slot);
+            if (error != ChunkError::None) {
+                return error;
+            }
+        }
+        char *const password = scratch + slot * slotSize;
+        const uint64_t started = i % Metrics::SAMPLE_INTERVAL == 0 ? Metrics::start() : 0;
+        const bool ok = generateChecked(random, password, lengths[slot], stats);
+        Metrics::stop(Metrics::Generation, started);
+        if (!ok) {
+            return ChunkError::Breached;
+        }
+        fingerprints[slot] = seen.fingerprint(std::string_view(password, lengths[slot]));
+        seen.prefetch(fingerprints[slot]);
+    }
+    for (uint64_t i = count > UNIQUE_PIPELINE ? count - UNIQUE_PIPELINE : 0; i < count; ++i) {
+        const ChunkError error = commit(i % UNIQUE_PIPELINE);
+        if (error != ChunkError::None) {
+            return error;
+        }
+    }
+    return ChunkError::None;
+}
+
+bool BulkEngine::run(int fd)
+{
+    const Clock::time_point start = Clock::now();
+    // Records are at most this long; variable-length sources leave the
+    // tail of a chunk buffer unused
+    const size_t recordSize = maxRecordSize(m_options.format, m_source.maxLength());
+    const uint64_t count = m_options.count;
+    const uint64_t chunks = (count + m_chunkSize - 1) / m_chunkSize;
+    // Plain records are generated in place; other formats go through a
+    // scratch password that is then encoded into the chunk
+    const bool plain = m_options.format == ExportFormat::Plain;
+
+    SharedState shared;
+    m_stats.assign(m_threads, ThreadStats());
+    m_cancelled = false;
+    m_breachExhausted = false;
+    m_uniqueExhausted = false;
+    m_error.clear();
+
+    FingerprintSet seen;
+    if (m_options.unique) {
+        // Fewer possible passwords than requested can never be unique
+        if (std::log2(static_cast<double>(count)) > m_source.entropyBits()) {
+            m_error = "the settings allow fewer distinct passwords than requested";
+            return false;
+        }
+        if (!seen.reserve(count, m_options.uniqueMemoryBudget, m_options.uniqueSpillDirectory, &m_error)) {
+            return false;
+        }
+        m_uniqueFileBacked = seen.isFileBacked();
+    }
+
+    const std::string_view header = exportHeader(m_options.format);
+    if (!header.empty() && !writeAll(fd, header.data(), header.size())) {
+        m_elapsed = secondsSince(start);
+        return false;
+    }
+
+    auto worker = [&](unsigned index) {
+        ThreadStats &stats = m_stats[index];
+        RandomStream &random = RandomStream::forThread();
+        // Passwords are generated straight into locked memory, which the
+        // arena wipes when the worker finishes
+        const size_t slotSize = m_source.maxLength() + 1;
+        const size_t scratchSlots = m_options.unique ? UNIQUE_PIPELINE : plain ? 0 : 1;
+        SecureArena arena(m_chunkSize * recordSize + scratchSlots * slotSize);
+        char *const buffer = arena.allocate(m_chunkSize * recordSize);
+        char *const scratch = scratchSlots ? arena.allocate(scratchSlots * slotSize) : nullptr;
+        if (!buffer || (scratchSlots && !scratch)) {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.failed = true;
+            shared.turn.notify_all();
+            return;
+        }
+
+        for (;;) {
+            const uint64_t chunk = shared.nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunks) {
+                break;
+            }
+            if (m_options.cancel && m_options.cancel->load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                shared.failed = true;
+                shared.cancelled = true;
+                shared.turn.notify_all();
+                break;
+            }
+
+            Clock::time_point phase = Clock::now();
+            const uint64_t first = chunk * m_chunkSize;
+            const uint64_t n = std::min(m_chunkSize, count - first);
+            char *out = buffer;
+            ChunkError error = ChunkError::None;
+            if (!m_options.unique) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    char *const password = plain ? out : scratch;
+                    const uint64_t started = i % Metrics::SAMPLE_INTERVAL == 0 ? Metrics::start() : 0;
+                    size_t length = 0;
+                    const bool ok = generateChecked(random, password, length, stats);
+                    Metrics::stop(Metrics::Generation, started);
+                    if (!ok) {
+                        error = ChunkError::Breached;
+                        break;
+                    }
+                    if (plain) {
+                        out[length] = '\n';
+                        out += length + 1;
+                    } else {
+                        out += encodeRecord(m_options.format, password, length, out);
+                    }
+                }
+            } else {
+                error = generateUnique(random, seen, scratch, n, out, stats);
+            }
+            if (error != ChunkError::None) {
+                // The chunk is never written, so the breached candidate
+                // left in the buffer goes nowhere
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                shared.failed = true;
+                shared.exhausted = shared.exhausted || error == ChunkError::Duplicates;
+                shared.breached = shared.breached || error == ChunkError::Breached;
+                shared.turn.notify_all();
+            }
+            const size_t size = static_cast<size_t>(out - buffer);
+            stats.generateSeconds += secondsSince(phase);
+
+            phase = Clock::now();
+            std::unique_lock<std::mutex> lock(shared.mutex);
+            if (m_options.ordered) {
+                shared.turn.wait(lock, [&] { return shared.failed || shared.nextToWrite == chunk; });
+            }
+            stats.waitSeconds += secondsSince(phase);
+            if (shared.failed) {
+                break;
+            }
+
+            phase = Clock::now();
+            if (!writeAll(fd, buffer, size)) {
+                shared.failed = true;
+            }
+            ++shared.nextToWrite;
+            lock.unlock();
+            if (m_options.ordered) {
+                shared.turn.notify_all();
+            }
+            stats.writeSeconds += secondsSince(phase);
+            if (m_options.progress) {
+                m_options.progress->fetch_add(n, std::memory_order_relaxed);
+            }
+
+            stats.passwords += n;
+            stats.bytes += size;
+            Metrics::add(Metrics::Passwords, n);
+        }
+    };
+
+    if (m_threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(m_threads);
+        for (unsigned i = 0; i < m_threads; ++i) {
+            pool.emplace_back(worker, i);
+        }
+        for (std::thread &thread : pool) {
+            thread.join();
+        }
+    }
+
+    m_elapsed = secondsSince(start);
+    m_cancelled = shared.cancelled;
+    m_breachExhausted = shared.breached;
+    m_uniqueExhausted = shared.exhausted && !shared.breached;
+    if (shared.breached) {
+        m_error = "policy space exhausted by breach corpus; use longer passwords or more character classes";
+    } else if (shared.exhausted) {
+        m_error = "ran out of unique passwords; use longer passwords or more character classes";
+    }
+    return !shared.failed;
+}
+
+} // namespace qenqey
@@ -0,0 +1,121 @@
+#ifndef QENQEY_CORE_BULK_H
+#define QENQEY_CORE_BULK_H
+
+#include "exportformat.h"
+#include "source.h"
+#include "uniqueset.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace qenqey {
+
+class BreachCorpus;
+class RandomStream;
+
+struct BulkOptions
+{
+    uint64_t count = 0;
+
+    // 0 picks std::thread::hardware_concurrency()
+    unsigned threads = 0;
+
+    // Keep chunks in generation order. Unordered output lets a finished
+    // chunk go out immediately instead of waiting for its predecessors.
+    bool ordered = true;
+
+    // When set, passwords found in the corpus are regenerated. After
+    // MAX_BREACH_RETRIES breached candidates in a row run() fails rather
+    // than write one.
+    const BreachCorpus *rejectBreached = nullptr;
+
+    ExportFormat format = ExportFormat::Plain;
+
+    // No password repeats within the batch; duplicates are regenerated.
+    // The fingerprint table moves to a temporary file in uniqueSpillDirectory
+    // (defaultUniqueSpillDirectory() when empty) past the budget.
+    bool unique = false;
+    size_t uniqueMemoryBudget = DEFAULT_UNIQUE_MEMORY;
+    std::string uniqueSpillDirectory = {};
+
+    // Passwords written so far, bumped after every chunk, for progress bars
+    std::atomic<uint64_t> *progress = nullptr;
+
+    // Polled between chunks; once set, run() stops and returns false
+    const std::atomic<bool> *cancel = nullptr;
+};
+
+struct ThreadStats
+{
+    uint64_t passwords = 0;
+    uint64_t bytes = 0;
+    uint64_t breachedRejected = 0;
+    uint64_t duplicatesRejected = 0;
+    double generateSeconds = 0.0;
+    double writeSeconds = 0.0;
+    double waitSeconds = 0.0;
+};
+
+// Splits an N-password job into chunks handed out to a pool of worker
+// threads. Every worker has its own RandomStream and output buffer, and
+// only touches shared state to claim a chunk and to write it out.
+class BulkEngine
+{
+public:
+    // The source must stay alive and unchanged until run() returns
+    BulkEngine(const PasswordSource &source, const BulkOptions &options);
+
+    // Writes the passwords to fd in the chosen format. False on write
+    // error or cancellation.
+    bool run(int fd);
+
+    // True when the last run() stopped because of BulkOptions::cancel
+    bool wasCancelled() const { return m_cancelled; }
+
+    // True when the last run() failed because nearly every candidate was
+    // in BulkOptions::rejectBreached
+    bool breachExhausted() const { return m_breachExhausted; }
+
+    // True when the last run() failed because a unique batch kept drawing
+    // passwords it had already written
+    bool uniqueExhausted() const { return m_uniqueExhausted; }
+
+    // Why the last run() failed, when it was not a write error
+    const std::string &errorString() const { return m_error; }
+
+    // Valid after a unique run()
+    bool uniqueSetFileBacked() const { return m_uniqueFileBacked; }
+
+    unsigned threadCount() const { return m_threads; }
+    uint64_t chunkSize() const { return m_chunkSize; }
+
+    // Valid after run(); one entry per worker
+    const std::vector<ThreadStats> &threadStats() const { return m_stats; }
+    double elapsedSeconds() const { return m_elapsed; }
+
+private:
+    enum class ChunkError { None, Duplicates, Breached };
+
+    // False when every attempt was in the breach corpus
+    bool generateChecked(RandomStream &random, char *password, size_t &length, ThreadStats &stats) const;
+    ChunkError generateUnique(RandomStream &random, FingerprintSet &seen, char *scratch, uint64_t count,
+                              char *&out, ThreadStats &stats) const;
+
+    const PasswordSource &m_source;
+    BulkOptions m_options;
+    unsigned m_threads;
+    uint64_t m_chunkSize;
+    std::vector<ThreadStats> m_stats;
+    double m_elapsed;
+    bool m_cancelled;
+    bool m_breachExhausted;
+    bool m_uniqueExhausted;
+    bool m_uniqueFileBacked;
+    std::string m_error;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_BULK_H
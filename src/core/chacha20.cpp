@@ -0,0 +1,376 @@
+#include "chacha20.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The AVX2 and AVX-512 kernels are compiled for their own targets and
+// picked at run time, so the rest of the build keeps the baseline
+// instruction set
+#if defined(__x86_64__) && defined(__GNUC__)
+#define QENQEY_CHACHA20_WIDE 1
+#include <immintrin.h>
+#endif
+
+namespace qenqey {
+
+namespace {
+
+inline uint32_t load32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+inline void store32(uint8_t *p, uint32_t v)
+{
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+inline uint32_t rotl(uint32_t v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+#define QUARTERROUND(a, b, c, d) \
+    a += b; d = rotl(d ^ a, 16);  \
+    c += d; b = rotl(b ^ c, 12);  \
+    a += b; d = rotl(d ^ a, 8);   \
+    c += d; b = rotl(b ^ c, 7)
+
+void initState(uint32_t state[16], const uint8_t *key, uint64_t nonce, uint64_t counter)
+{
+    // "expand 32-byte k"
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        state[4 + i] = load32(key + 4 * i);
+    }
+    state[12] = uint32_t(counter);
+    state[13] = uint32_t(counter >> 32);
+    state[14] = uint32_t(nonce);
+    state[15] = uint32_t(nonce >> 32);
+}
+
+void blockScalar(const uint32_t state[16], uint8_t *out)
+{
+    uint32_t x[16];
+    std::memcpy(x, state, sizeof(x));
+
+    for (int round = 0; round < 10; ++round) {
+        QUARTERROUND(x[0], x[4], x[8], x[12]);
+        QUARTERROUND(x[1], x[5], x[9], x[13]);
+        QUARTERROUND(x[2], x[6], x[10], x[14]);
+        QUARTERROUND(x[3], x[7], x[11], x[15]);
+        QUARTERROUND(x[0], x[5], x[10], x[15]);
+        QUARTERROUND(x[1], x[6], x[11], x[12]);
+        QUARTERROUND(x[2], x[7], x[8], x[13]);
+        QUARTERROUND(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        store32(out + 4 * i, x[i] + state[i]);
+    }
+}
+
+#if defined(__SSE2__)
+
+inline __m128i rotlv(__m128i v, int n)
+{
+    return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n));
+}
+
+#define QUARTERROUND4(a, b, c, d)                                          \
+    a = _mm_add_epi32(a, b); d = rotlv(_mm_xor_si128(d, a), 16);           \
+    c = _mm_add_epi32(c, d); b = rotlv(_mm_xor_si128(b, c), 12);           \
+    a = _mm_add_epi32(a, b); d = rotlv(_mm_xor_si128(d, a), 8);            \
+    c = _mm_add_epi32(c, d); b = rotlv(_mm_xor_si128(b, c), 7)
+
+// Four consecutive blocks at once, one block per 32-bit lane
+void blocks4(uint32_t state[16], uint8_t *out)
+{
+    __m128i input[16];
+    for (int i = 0; i < 16; ++i) {
+        input[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+    }
+
+    // Per-lane 64-bit counters: low word plus carry into the high word
+    const __m128i offsets = _mm_set_epi32(3, 2, 1, 0);
+    const __m128i low = _mm_add_epi32(input[12], offsets);
+    const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i carry = _mm_cmplt_epi32(_mm_xor_si128(low, bias), _mm_xor_si128(input[12], bias));
+    input[12] = low;
+    input[13] = _mm_sub_epi32(input[13], carry);
+
+    __m128i x[16];
+    for (int i = 0; i < 16; ++i) {
+        x[i] = input[i];
+    }
+
+    for (int round = 0; round < 10; ++round) {
+        QUARTERROUND4(x[0], x[4], x[8], x[12]);
+        QUARTERROUND4(x[1], x[5], x[9], x[13]);
+        QUARTERROUND4(x[2], x[6], x[10], x[14]);
+        QUARTERROUND4(x[3], x[7], x[11], x[15]);
+        QUARTERROUND4(x[0], x[5], x[10], x[15]);
+        QUARTERROUND4(x[1], x[6], x[11], x[12]);
+        QUARTERROUND4(x[2], x[7], x[8], x[13]);
+        QUARTERROUND4(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] = _mm_add_epi32(x[i], input[i]);
+    }
+
+    // Transpose each group of four words so every block lands contiguously
+    for (int group = 0; group < 4; ++group) {
+        __m128i a = x[4 * group + 0];
+        __m128i b = x[4 * group + 1];
+        __m128i c = x[4 * group + 2];
+        __m128i d = x[4 * group + 3];
+
+        __m128i ab0 = _mm_unpacklo_epi32(a, b);
+        __m128i ab1 = _mm_unpackhi_epi32(a, b);
+        __m128i cd0 = _mm_unpacklo_epi32(c, d);
+        __m128i cd1 = _mm_unpackhi_epi32(c, d);
+
+        __m128i lane0 = _mm_unpacklo_epi64(ab0, cd0);
+        __m128i lane1 = _mm_unpackhi_epi64(ab0, cd0);
+        __m128i lane2 = _mm_unpacklo_epi64(ab1, cd1);
+        __m128i lane3 = _mm_unpackhi_epi64(ab1, cd1);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 0 * 64 + 16 * group), lane0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 1 * 64 + 16 * group), lane1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * 64 + 16 * group), lane2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 3 * 64 + 16 * group), lane3);
+    }
+}
+
+#endif
+
+#if defined(QENQEY_CHACHA20_WIDE)
+
+#define QENQEY_AVX2 __attribute__((target("avx2")))
+
+QENQEY_AVX2 inline __m256i rotl8(__m256i v, int n)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - n));
+}
+
+// Rotations by whole bytes are one shuffle
+QENQEY_AVX2 inline __m256i rotlBytes(__m256i v, __m256i shuffle)
+{
+    return _mm256_shuffle_epi8(v, shuffle);
+}
+
+#define QUARTERROUND8(a, b, c, d)                                                    \
+    a = _mm256_add_epi32(a, b); d = rotlBytes(_mm256_xor_si256(d, a), rot16);        \
+    c = _mm256_add_epi32(c, d); b = rotl8(_mm256_xor_si256(b, c), 12);               \
+    a = _mm256_add_epi32(a, b); d = rotlBytes(_mm256_xor_si256(d, a), rot8);         \
+    c = _mm256_add_epi32(c, d); b = rotl8(_mm256_xor_si256(b, c), 7)
+
+// Eight consecutive blocks at once, as blocks4() with twice the lanes
+QENQEY_AVX2 void blocks8(uint32_t state[16], uint8_t *out)
+{
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+    __m256i input[16];
+    for (int i = 0; i < 16; ++i) {
+        input[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+    }
+
+    const __m256i offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i low = _mm256_add_epi32(input[12], offsets);
+    const __m256i bias = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(input[12], bias), _mm256_xor_si256(low, bias));
+    input[12] = low;
+    input[13] = _mm256_sub_epi32(input[13], carry);
+
+    __m256i x[16];
+    for (int i = 0; i < 16; ++i) {
+        x[i] = input[i];
+    }
+
+    for (int round = 0; round < 10; ++round) {
+        QUARTERROUND8(x[0], x[4], x[8], x[12]);
+        QUARTERROUND8(x[1], x[5], x[9], x[13]);
+        QUARTERROUND8(x[2], x[6], x[10], x[14]);
+        QUARTERROUND8(x[3], x[7], x[11], x[15]);
+        QUARTERROUND8(x[0], x[5], x[10], x[15]);
+        QUARTERROUND8(x[1], x[6], x[11], x[12]);
+        QUARTERROUND8(x[2], x[7], x[8], x[13]);
+        QUARTERROUND8(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] = _mm256_add_epi32(x[i], input[i]);
+    }
+
+    // Unpacks work within 128-bit halves, so the same transpose as
+    // blocks4() leaves blocks 0-3 in the low halves and 4-7 in the high
+    for (int group = 0; group < 4; ++group) {
+        const __m256i ab0 = _mm256_unpacklo_epi32(x[4 * group + 0], x[4 * group + 1]);
+        const __m256i ab1 = _mm256_unpackhi_epi32(x[4 * group + 0], x[4 * group + 1]);
+        const __m256i cd0 = _mm256_unpacklo_epi32(x[4 * group + 2], x[4 * group + 3]);
+        const __m256i cd1 = _mm256_unpackhi_epi32(x[4 * group + 2], x[4 * group + 3]);
+
+        const __m256i lanes[4] = {
+            _mm256_unpacklo_epi64(ab0, cd0),
+            _mm256_unpackhi_epi64(ab0, cd0),
+            _mm256_unpacklo_epi64(ab1, cd1),
+            _mm256_unpackhi_epi64(ab1, cd1),
+        };
+        for (int block = 0; block < 4; ++block) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + block * 64 + 16 * group),
+                             _mm256_castsi256_si128(lanes[block]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (block + 4) * 64 + 16 * group),
+                             _mm256_extracti128_si256(lanes[block], 1));
+        }
+    }
+}
+
+#define QENQEY_AVX512 __attribute__((target("avx512f")))
+
+#define QUARTERROUND16(a, b, c, d)                                                   \
+    a = _mm512_add_epi32(a, b); d = _mm512_rol_epi32(_mm512_xor_si512(d, a), 16);   \
+    c = _mm512_add_epi32(c, d); b = _mm512_rol_epi32(_mm512_xor_si512(b, c), 12);   \
+    a = _mm512_add_epi32(a, b); d = _mm512_rol_epi32(_mm512_xor_si512(d, a), 8);    \
+    c = _mm512_add_epi32(c, d); b = _mm512_rol_epi32(_mm512_xor_si512(b, c), 7)
+
+// GCC's AVX-512 intrinsics start from a deliberately undefined vector,
+// which it reports as uninitialized once inlined into a target function
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+
+// Sixteen consecutive blocks at once; rotates are single instructions
+QENQEY_AVX512 void blocks16(uint32_t state[16], uint8_t *out)
+{
+    __m512i input[16];
+    for (int i = 0; i < 16; ++i) {
+        input[i] = _mm512_set1_epi32(static_cast<int>(state[i]));
+    }
+
+    const __m512i offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i low = _mm512_add_epi32(input[12], offsets);
+    const __mmask16 carry = _mm512_cmplt_epu32_mask(low, input[12]);
+    input[12] = low;
+    input[13] = _mm512_mask_add_epi32(input[13], carry, input[13], _mm512_set1_epi32(1));
+
+    __m512i x[16];
+    for (int i = 0; i < 16; ++i) {
+        x[i] = input[i];
+    }
+
+    for (int round = 0; round < 10; ++round) {
+        QUARTERROUND16(x[0], x[4], x[8], x[12]);
+        QUARTERROUND16(x[1], x[5], x[9], x[13]);
+        QUARTERROUND16(x[2], x[6], x[10], x[14]);
+        QUARTERROUND16(x[3], x[7], x[11], x[15]);
+        QUARTERROUND16(x[0], x[5], x[10], x[15]);
+        QUARTERROUND16(x[1], x[6], x[11], x[12]);
+        QUARTERROUND16(x[2], x[7], x[8], x[13]);
+        QUARTERROUND16(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] = _mm512_add_epi32(x[i], input[i]);
+    }
+
+    // As in blocks8(): quarter q of each vector holds blocks 4q to 4q+3
+    for (int group = 0; group < 4; ++group) {
+        const __m512i ab0 = _mm512_unpacklo_epi32(x[4 * group + 0], x[4 * group + 1]);
+        const __m512i ab1 = _mm512_unpackhi_epi32(x[4 * group + 0], x[4 * group + 1]);
+        const __m512i cd0 = _mm512_unpacklo_epi32(x[4 * group + 2], x[4 * group + 3]);
+        const __m512i cd1 = _mm512_unpackhi_epi32(x[4 * group + 2], x[4 * group + 3]);
+
+        const __m512i lanes[4] = {
+            _mm512_unpacklo_epi64(ab0, cd0),
+            _mm512_unpackhi_epi64(ab0, cd0),
+            _mm512_unpacklo_epi64(ab1, cd1),
+            _mm512_unpackhi_epi64(ab1, cd1),
+        };
+        for (int block = 0; block < 4; ++block) {
+            uint8_t *const base = out + block * 64 + 16 * group;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(base), _mm512_extracti32x4_epi32(lanes[block], 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(base + 4 * 64), _mm512_extracti32x4_epi32(lanes[block], 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(base + 8 * 64), _mm512_extracti32x4_epi32(lanes[block], 2));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(base + 12 * 64), _mm512_extracti32x4_epi32(lanes[block], 3));
+        }
+    }
+}
+
+#pragma GCC diagnostic pop
+
+bool hasAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+bool hasAvx512()
+{
+    static const bool supported = __builtin_cpu_supports("avx512f");
+    return supported;
+}
+
+#endif
+
+inline void advance(uint32_t state[16], uint64_t blocks)
+{
+    uint64_t counter = (uint64_t(state[13]) << 32 | state[12]) + blocks;
+    state[12] = uint32_t(counter);
+    state[13] = uint32_t(counter >> 32);
+}
+
+} // namespace
+
+void chacha20Keystream(const uint8_t key[CHACHA20_KEY_SIZE], uint64_t nonce,
+                       uint64_t counter, uint8_t *out, size_t blocks)
+{
+    uint32_t state[16];
+    initState(state, key, nonce, counter);
+
+#if defined(QENQEY_CHACHA20_WIDE)
+    if (hasAvx512()) {
+        for (; blocks >= 16; blocks -= 16) {
+            blocks16(state, out);
+            advance(state, 16);
+            out += 16 * CHACHA20_BLOCK_SIZE;
+        }
+    }
+    if (hasAvx2()) {
+        for (; blocks >= 8; blocks -= 8) {
+            blocks8(state, out);
+            advance(state, 8);
+            out += 8 * CHACHA20_BLOCK_SIZE;
+        }
+    }
+#endif
+
+#if defined(__SSE2__)
+    for (; blocks >= 4; blocks -= 4) {
+        blocks4(state, out);
+        advance(state, 4);
+        out += 4 * CHACHA20_BLOCK_SIZE;
+    }
+#endif
+
+    for (; blocks > 0; --blocks) {
+        blockScalar(state, out);
+        advance(state, 1);
+        out += CHACHA20_BLOCK_SIZE;
+    }
+
+    explicit_bzero(state, sizeof(state));
+}
+
+} // namespace qenqey
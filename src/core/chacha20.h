@@ -0,0 +1,21 @@
+#ifndef QENQEY_CORE_CHACHA20_H
+#define QENQEY_CORE_CHACHA20_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace qenqey {
+
+constexpr size_t CHACHA20_KEY_SIZE = 32;
+constexpr size_t CHACHA20_BLOCK_SIZE = 64;
+
+// ChaCha20 keystream (original layout: 64-bit block counter in words
+// 12-13, 64-bit nonce in words 14-15). Writes blocks * 64 bytes to out
+// starting at the given counter. Uses 16-way AVX-512 or 8-way AVX2
+// kernels on CPUs that have them and a 4-way SSE2 kernel where available.
+void chacha20Keystream(const uint8_t key[CHACHA20_KEY_SIZE], uint64_t nonce,
+                       uint64_t counter, uint8_t *out, size_t blocks);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_CHACHA20_H
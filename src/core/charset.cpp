@@ -0,0 +1,29 @@
+#include "charset.h"
+
+#include <cstring>
+
+namespace qenqey {
+
+const char UPPERCASE_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const char LOWERCASE_CHARS[] = "abcdefghijklmnopqrstuvwxyz";
+const char NUMBER_CHARS[] = "0123456789";
+const char SYMBOL_CHARS[] = "!@#$%^&*()_+-=[]{}|;:,.<>?";
+const char SIMILAR_CHARS[] = "il1Lo0O";
+
+const char *classCharacters(int classIndex)
+{
+    switch (classIndex) {
+    case 0: return UPPERCASE_CHARS;
+    case 1: return LOWERCASE_CHARS;
+    case 2: return NUMBER_CHARS;
+    case 3: return SYMBOL_CHARS;
+    }
+    return "";
+}
+
+bool isSimilarCharacter(char c)
+{
+    return c != '\0' && std::strchr(SIMILAR_CHARS, c) != nullptr;
+}
+
+} // namespace qenqey
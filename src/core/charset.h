@@ -0,0 +1,30 @@
+#ifndef QENQEY_CORE_CHARSET_H
+#define QENQEY_CORE_CHARSET_H
+
+namespace qenqey {
+
+// Character classes selectable in the generator settings
+enum CharacterClass : unsigned {
+    Uppercase = 1u << 0,
+    Lowercase = 1u << 1,
+    Numbers   = 1u << 2,
+    Symbols   = 1u << 3,
+};
+
+constexpr unsigned ALL_CLASSES = Uppercase | Lowercase | Numbers | Symbols;
+constexpr int CLASS_COUNT = 4;
+
+extern const char UPPERCASE_CHARS[];
+extern const char LOWERCASE_CHARS[];
+extern const char NUMBER_CHARS[];
+extern const char SYMBOL_CHARS[];
+extern const char SIMILAR_CHARS[];
+
+// Characters of a single class, in generator order (index 0..CLASS_COUNT-1)
+const char *classCharacters(int classIndex);
+
+bool isSimilarCharacter(char c);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_CHARSET_H
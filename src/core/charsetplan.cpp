@@ -0,0 +1,76 @@
+#include "charsetplan.h"
+#include "generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace qenqey {
+
+CharsetPlan::CharsetPlan()
+    : CharsetPlan(GeneratorSettings{MIN_PASSWORD_LENGTH, 0, false})
+{
+}
+
+CharsetPlan::CharsetPlan(const GeneratorSettings &settings)
+    : m_settings(settings)
+    , m_requiredCount(0)
+{
+    m_settings.length = std::clamp(settings.length, MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+
+    for (int cls = 0; cls < CLASS_COUNT; ++cls) {
+        if (!(settings.classes & (1u << cls))) {
+            continue;
+        }
+
+        AlphabetTable &set = m_required[m_requiredCount];
+        set.size = 0;
+        for (const char *c = classCharacters(cls); *c; ++c) {
+            if (settings.excludeSimilar && isSimilarCharacter(*c)) {
+                continue;
+            }
+            set.characters[set.size++] = *c;
+            m_alphabet.characters[m_alphabet.size++] = *c;
+        }
+
+        if (set.size > 0) {
+            finalizeAlphabet(set);
+            ++m_requiredCount;
+        }
+    }
+
+    finalizeAlphabet(m_alphabet);
+
+    m_shuffleThresholds[0] = 0;
+    for (uint32_t bound = 1; bound <= MAX_PASSWORD_LENGTH; ++bound) {
+        m_shuffleThresholds[bound] = -bound % bound;
+    }
+}
+
+size_t CharsetPlan::generate(RandomStream &random, char *out) const
+{
+    generatePassword(*this, random, out);
+    return static_cast<size_t>(m_settings.length);
+}
+
+double CharsetPlan::entropyBits() const
+{
+    return isValid() ? m_settings.length * std::log2(static_cast<double>(m_alphabet.size)) : 0.0;
+}
+
+void finalizeAlphabet(AlphabetTable &table)
+{
+    std::memset(table.byteMap, 0, sizeof(table.byteMap));
+    if (table.size == 0) {
+        table.byteLimit = 0;
+        return;
+    }
+
+    // Largest multiple of size that fits in a byte
+    table.byteLimit = 256 - 256 % table.size;
+    for (uint32_t b = 0; b < table.byteLimit; ++b) {
+        table.byteMap[b] = table.characters[b % table.size];
+    }
+}
+
+} // namespace qenqey
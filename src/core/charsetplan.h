@@ -0,0 +1,67 @@
+#ifndef QENQEY_CORE_CHARSETPLAN_H
+#define QENQEY_CORE_CHARSETPLAN_H
+
+#include "settings.h"
+#include "source.h"
+
+#include <cstdint>
+
+namespace qenqey {
+
+// Flat byte alphabet with everything needed to sample from it without
+// bias: a random byte b is accepted when b < byteLimit and then maps
+// straight to byteMap[b], so a draw is one compare and one load.
+struct AlphabetTable
+{
+    static constexpr int MAX_SIZE = 128;
+
+    char characters[MAX_SIZE];
+    uint32_t size = 0;
+    uint32_t byteLimit = 0;
+    char byteMap[256];
+};
+
+// Fills byteLimit and byteMap from characters[0, size)
+void finalizeAlphabet(AlphabetTable &table);
+
+// Settings compiled into ready-to-use tables. Building one does all the
+// string work up front; generation from it allocates nothing.
+class CharsetPlan : public PasswordSource
+{
+public:
+    CharsetPlan();
+    explicit CharsetPlan(const GeneratorSettings &settings);
+
+    // False when no character class is selected
+    bool isValid() const override { return m_alphabet.size > 0; }
+    size_t maxLength() const override { return static_cast<size_t>(m_settings.length); }
+    size_t generate(RandomStream &random, char *out) const override;
+
+    // length * log2(alphabet size). The one-of-each-class requirement
+    // makes the true figure slightly lower.
+    double entropyBits() const override;
+    int length() const { return m_settings.length; }
+    const GeneratorSettings &settings() const { return m_settings; }
+
+    // Union of all selected classes
+    const AlphabetTable &alphabet() const { return m_alphabet; }
+
+    // One table per selected, non-empty class
+    int requiredCount() const { return m_requiredCount; }
+    const AlphabetTable &required(int index) const { return m_required[index]; }
+
+    // Rejection threshold for a 32-bit draw in [0, bound), used by the
+    // Fisher-Yates shuffle where bound runs from 2 to length()
+    uint32_t shuffleThreshold(uint32_t bound) const { return m_shuffleThresholds[bound]; }
+
+private:
+    GeneratorSettings m_settings;
+    AlphabetTable m_alphabet;
+    AlphabetTable m_required[CLASS_COUNT];
+    int m_requiredCount;
+    uint32_t m_shuffleThresholds[MAX_PASSWORD_LENGTH + 1];
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_CHARSETPLAN_H
@@ -0,0 +1,489 @@
+#include "constrained.h"
+#include "random.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace qenqey {
+
+namespace {
+
+// Counts are fixed-width little-endian numbers of 64-bit limbs
+
+bool less(const uint64_t *a, const uint64_t *b, int limbs)
+{
+    for (int i = limbs - 1; i >= 0; --i) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i];
+        }
+    }
+    return false;
+}
+
+void add(uint64_t *to, const uint64_t *value, int limbs)
+{
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < limbs; ++i) {
+        carry += static_cast<unsigned __int128>(to[i]) + value[i];
+        to[i] = static_cast<uint64_t>(carry);
+        carry >>= 64;
+    }
+}
+
+void subtract(uint64_t *from, const uint64_t *value, int limbs)
+{
+    uint64_t borrow = 0;
+    for (int i = 0; i < limbs; ++i) {
+        const uint64_t v = value[i] + borrow;
+        borrow = (v < borrow) | (from[i] < v);
+        from[i] -= v;
+    }
+}
+
+void addMultiple(uint64_t *to, const uint64_t *value, uint64_t factor, int limbs)
+{
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < limbs; ++i) {
+        carry += static_cast<unsigned __int128>(value[i]) * factor + to[i];
+        to[i] = static_cast<uint64_t>(carry);
+        carry >>= 64;
+    }
+}
+
+} // namespace
+
+bool CharacterRules::isDefault() const
+{
+    const CharacterRules defaults;
+    return std::equal(std::begin(minimum), std::end(minimum), std::begin(defaults.minimum))
+        && maxRepeat == 0 && maxSequence == 0 && bannedFirst.empty();
+}
+
+const char *ruleErrorText(RuleError error)
+{
+    switch (error) {
+    case RuleError::None: return "ok";
+    case RuleError::NoClasses: return "no character classes";
+    case RuleError::UnselectedMinimum: return "minimum set for an unselected class";
+    case RuleError::BadLimit: return "rule limit out of range";
+    case RuleError::Impossible: return "no password satisfies the rules";
+    case RuleError::TooComplex: return "rules too complex for this length";
+    }
+    return "invalid rules";
+}
+
+bool parseClassMinimums(std::string_view text, CharacterRules &rules)
+{
+    CharacterRules parsed = rules;
+    size_t position = 0;
+    while (position < text.size()) {
+        const size_t end = std::min(text.find(',', position), text.size());
+        const std::string_view item = text.substr(position, end - position);
+        position = end + 1;
+
+        static const char letters[] = "ulds";
+        const char *const letter = item.size() >= 2 ? std::strchr(letters, item[0]) : nullptr;
+        if (!letter || *letter == '\0') {
+            return false;
+        }
+        int value = 0;
+        const auto result = std::from_chars(item.data() + 1, item.data() + item.size(), value);
+        if (result.ec != std::errc() || result.ptr != item.data() + item.size()
+            || value < 0 || value > MAX_PASSWORD_LENGTH) {
+            return false;
+        }
+        parsed.minimum[letter - letters] = value;
+    }
+    rules = parsed;
+    return !text.empty();
+}
+
+ConstrainedPlan::ConstrainedPlan()
+    : ConstrainedPlan(GeneratorSettings{MIN_PASSWORD_LENGTH, 0, false}, CharacterRules())
+{
+}
+
+ConstrainedPlan::ConstrainedPlan(const GeneratorSettings &settings, const CharacterRules &rules)
+    : m_settings(settings)
+    , m_rules(rules)
+    , m_runs(1)
+    , m_repeatLimit(0)
+    , m_sequenceLimit(0)
+    , m_deficits(1)
+    , m_startDeficit(0)
+    , m_limbs(1)
+    , m_total{}
+    , m_totalBits(0)
+    , m_entropy(0.0)
+    , m_error(RuleError::None)
+{
+    m_settings.length = std::clamp(settings.length, MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+    build();
+    if (m_error != RuleError::None) {
+        m_groups.clear();
+        m_kinds.clear();
+        std::vector<uint64_t>().swap(m_counts);
+        std::vector<uint64_t>().swap(m_totals);
+        m_entropy = 0.0;
+    }
+}
+
+int ConstrainedPlan::minimum(int cls) const
+{
+    const int value = m_rules.minimum[cls];
+    if (value != CharacterRules::DEFAULT_MINIMUM) {
+        return value;
+    }
+    return (m_settings.classes & (1u << cls)) ? 1 : 0;
+}
+
+int ConstrainedPlan::runIndex(int repeat, int ascending) const
+{
+    // (1, 1), then longer repeats, then longer ascending runs
+    if (repeat > 1) {
+        return repeat - 1;
+    }
+    return ascending > 1 ? std::max(m_repeatLimit, 1) + ascending - 2 : 0;
+}
+
+uint32_t ConstrainedPlan::decrement(uint32_t deficit, int group) const
+{
+    const Group &g = m_groups[group];
+    return (deficit / g.stride) % (g.minimum + 1) > 0 ? deficit - g.stride : deficit;
+}
+
+const uint64_t *ConstrainedPlan::count(int position, uint32_t deficit, int kind, int run) const
+{
+    const size_t cell = ((static_cast<size_t>(position - 1) * m_deficits + deficit) * m_kinds.size() + kind) * m_runs + run;
+    return m_counts.data() + cell * m_limbs;
+}
+
+uint64_t *ConstrainedPlan::countAt(int position, uint32_t deficit, int kind, int run)
+{
+    return const_cast<uint64_t *>(count(position, deficit, kind, run));
+}
+
+const uint64_t *ConstrainedPlan::groupTotal(int position, uint32_t deficit, int group) const
+{
+    const size_t cell = (static_cast<size_t>(position - 1) * m_deficits + deficit) * m_groups.size() + group;
+    return m_totals.data() + cell * m_limbs;
+}
+
+uint64_t *ConstrainedPlan::groupTotalAt(int position, uint32_t deficit, int group)
+{
+    return const_cast<uint64_t *>(groupTotal(position, deficit, group));
+}
+
+void ConstrainedPlan::build()
+{
+    const int length = m_settings.length;
+    if (m_rules.maxRepeat < 0 || m_rules.maxRepeat > MAX_RULE_RUN
+        || m_rules.maxSequence < 0 || m_rules.maxSequence > MAX_RULE_RUN) {
+        m_error = RuleError::BadLimit;
+        return;
+    }
+    m_repeatLimit = m_rules.maxRepeat;
+    m_sequenceLimit = m_rules.maxSequence;
+    m_runs = std::max(m_repeatLimit, 1) + std::max(m_sequenceLimit, 1) - 1;
+
+    // Groups are the selected, non-empty classes; kinds split them only
+    // as far as the rules can tell characters apart
+    int required = 0;
+    size_t alphabet = 0;
+    for (int cls = 0; cls < CLASS_COUNT; ++cls) {
+        const int least = minimum(cls);
+        if (least < CharacterRules::DEFAULT_MINIMUM || least > MAX_PASSWORD_LENGTH) {
+            m_error = RuleError::BadLimit;
+            return;
+        }
+
+        std::string members;
+        if (m_settings.classes & (1u << cls)) {
+            for (const char *c = classCharacters(cls); *c; ++c) {
+                if (!(m_settings.excludeSimilar && isSimilarCharacter(*c))) {
+                    members += *c;
+                }
+            }
+        }
+        if (members.empty()) {
+            if (least > 0) {
+                m_error = RuleError::UnselectedMinimum;
+                return;
+            }
+            continue;
+        }
+
+        Group group{cls, least, static_cast<int>(m_kinds.size()), 0, m_deficits};
+        const int groupIndex = static_cast<int>(m_groups.size());
+        auto addKind = [&](const std::string &characters) {
+            Kind kind{};
+            kind.group = static_cast<uint8_t>(groupIndex);
+            kind.successor = -1;
+            for (char c : characters) {
+                kind.characters[kind.size++] = c;
+                if (m_rules.bannedFirst.find(c) == std::string::npos) {
+                    kind.firstCharacters[kind.firstSize++] = c;
+                }
+            }
+            m_kinds.push_back(kind);
+            ++group.kindCount;
+        };
+        if (m_sequenceLimit > 0) {
+            for (char c : members) {
+                addKind(std::string(1, c));
+            }
+            // Symbols are not listed in code point order, so look it up
+            for (int k = group.firstKind; k < group.firstKind + group.kindCount; ++k) {
+                const size_t next = members.find(static_cast<char>(m_kinds[k].characters[0] + 1));
+                if (next != std::string::npos) {
+                    m_kinds[k].successor = static_cast<int16_t>(group.firstKind + next);
+                }
+            }
+        } else {
+            addKind(members);
+        }
+
+        m_startDeficit += static_cast<uint32_t>(least) * m_deficits;
+        m_deficits *= static_cast<uint32_t>(least + 1);
+        m_groups.push_back(group);
+        required += least;
+        alphabet += members.size();
+    }
+
+    if (m_groups.empty()) {
+        m_error = RuleError::NoClasses;
+        return;
+    }
+    if (required > length) {
+        m_error = RuleError::Impossible;
+        return;
+    }
+
+    // alphabet^length bounds every count, with room for the partial sums
+    const double bits = length * std::log2(static_cast<double>(alphabet)) + 2.0;
+    m_limbs = static_cast<int>(bits / 64.0) + 1;
+    static_assert(MAX_PASSWORD_LENGTH * 7 / 64 + 1 <= MAX_LIMBS, "counts must fit MAX_LIMBS");
+
+    const uint64_t cells = static_cast<uint64_t>(length) * m_deficits * (m_kinds.size() * m_runs + m_groups.size());
+    if (cells * m_limbs * sizeof(uint64_t) > MAX_RULE_TABLE_BYTES) {
+        m_error = RuleError::TooComplex;
+        return;
+    }
+    m_counts.assign(static_cast<size_t>(length) * m_deficits * m_kinds.size() * m_runs * m_limbs, 0);
+    m_totals.assign(static_cast<size_t>(length) * m_deficits * m_groups.size() * m_limbs, 0);
+
+    const int kinds = static_cast<int>(m_kinds.size());
+    const int groups = static_cast<int>(m_groups.size());
+    const int repeats = std::max(m_repeatLimit, 1);
+
+    // A full password: only the paid-up deficit counts
+    for (int k = 0; k < kinds; ++k) {
+        for (int run = 0; run < m_runs; ++run) {
+            countAt(length, 0, k, run)[0] = 1;
+        }
+    }
+
+    // Characters still owed per deficit; states owing more than the
+    // positions left have no completions and keep their zeros
+    std::vector<int> owed(m_deficits, 0);
+    for (uint32_t deficit = 0; deficit < m_deficits; ++deficit) {
+        for (const Group &group : m_groups) {
+            owed[deficit] += static_cast<int>((deficit / group.stride) % (group.minimum + 1));
+        }
+    }
+
+    uint64_t sum[MAX_LIMBS];
+    for (int position = length; position >= 1; --position) {
+        if (position < length) {
+            for (uint32_t deficit = 0; deficit < m_deficits; ++deficit) {
+                if (owed[deficit] > length - position) {
+                    continue;
+                }
+                // Every way to continue with any character at all
+                std::fill(sum, sum + m_limbs, 0);
+                for (int g = 0; g < groups; ++g) {
+                    add(sum, groupTotal(position + 1, deficit, g), m_limbs);
+                }
+
+                for (int k = 0; k < kinds; ++k) {
+                    const Kind &kind = m_kinds[k];
+                    const uint32_t next = decrement(deficit, kind.group);
+                    const int successor = kind.successor;
+                    for (int run = 0; run < m_runs; ++run) {
+                        const int repeat = run < repeats ? run + 1 : 1;
+                        const int ascending = run < repeats ? 1 : run - repeats + 2;
+
+                        // The last character and its successor are taken
+                        // out of the fresh choices and counted by run below
+                        uint64_t *value = countAt(position, deficit, k, run);
+                        std::copy(sum, sum + m_limbs, value);
+                        subtract(value, count(position + 1, next, k, 0), m_limbs);
+                        if (successor >= 0) {
+                            subtract(value, count(position + 1, next, successor, 0), m_limbs);
+                        }
+                        if (m_repeatLimit == 0 || repeat < m_repeatLimit) {
+                            const int target = m_repeatLimit == 0 ? 0 : runIndex(repeat + 1, 1);
+                            add(value, count(position + 1, next, k, target), m_limbs);
+                        }
+                        if (successor >= 0 && ascending < m_sequenceLimit) {
+                            add(value, count(position + 1, next, successor, runIndex(1, ascending + 1)), m_limbs);
+                        }
+                    }
+                }
+            }
+        }
+
+        for (uint32_t deficit = 0; deficit < m_deficits; ++deficit) {
+            if (owed[deficit] > length - position + 1) {
+                continue;
+            }
+            for (int g = 0; g < groups; ++g) {
+                const uint32_t next = decrement(deficit, g);
+                uint64_t *total = groupTotalAt(position, deficit, g);
+                for (int k = m_groups[g].firstKind; k < m_groups[g].firstKind + m_groups[g].kindCount; ++k) {
+                    addMultiple(total, count(position, next, k, 0), m_kinds[k].size, m_limbs);
+                }
+            }
+        }
+    }
+
+    for (int k = 0; k < kinds; ++k) {
+        addMultiple(m_total, count(1, decrement(m_startDeficit, m_kinds[k].group), k, 0), m_kinds[k].firstSize, m_limbs);
+    }
+
+    int top = m_limbs - 1;
+    while (top > 0 && m_total[top] == 0) {
+        --top;
+    }
+    if (m_total[top] == 0) {
+        m_error = RuleError::Impossible;
+        return;
+    }
+    m_totalBits = 64 * top + 64 - __builtin_clzll(m_total[top]);
+    const double high = static_cast<double>(m_total[top])
+        + (top > 0 ? std::ldexp(static_cast<double>(m_total[top - 1]), -64) : 0.0);
+    m_entropy = std::log2(high) + 64.0 * top;
+}
+
+size_t ConstrainedPlan::generate(RandomStream &random, char *out) const
+{
+    const int length = m_settings.length;
+    if (!isValid()) {
+        return 0;
+    }
+
+    // Uniform rank below the total, by masked rejection: fewer than two
+    // draws on average
+    uint64_t rank[MAX_LIMBS] = {};
+    const int words = (m_totalBits + 63) / 64;
+    const uint64_t mask = m_totalBits % 64 ? (uint64_t(1) << (m_totalBits % 64)) - 1 : ~uint64_t(0);
+    for (;;) {
+        random.fill(rank, words * sizeof(uint64_t));
+        rank[words - 1] &= mask;
+        if (less(rank, m_total, m_limbs)) {
+            break;
+        }
+        Metrics::add(Metrics::RejectedSamples, 1);
+    }
+
+    // Each choice covers a block of ranks as wide as its completions; the
+    // one holding rank is taken and rank becomes the offset inside it
+    auto take = [&](const uint64_t *weight) {
+        if (less(rank, weight, m_limbs)) {
+            return true;
+        }
+        subtract(rank, weight, m_limbs);
+        return false;
+    };
+
+    uint32_t deficit = m_startDeficit;
+    int last = -1;
+    int run = 0;
+    char previous = 0;
+
+    for (int k = 0; k < static_cast<int>(m_kinds.size()) && last < 0; ++k) {
+        const Kind &kind = m_kinds[k];
+        const uint64_t *weight = count(1, decrement(deficit, kind.group), k, 0);
+        for (int i = 0; i < kind.firstSize; ++i) {
+            if (take(weight)) {
+                previous = kind.firstCharacters[i];
+                last = k;
+                break;
+            }
+        }
+    }
+    out[0] = previous;
+    deficit = decrement(deficit, m_kinds[last].group);
+
+    const int repeats = std::max(m_repeatLimit, 1);
+    uint64_t weight[MAX_LIMBS];
+    for (int position = 1; position < length; ++position) {
+        const Kind &kind = m_kinds[last];
+        const int successor = kind.successor;
+        const int repeat = run < repeats ? run + 1 : 1;
+        const int ascending = run < repeats ? 1 : run - repeats + 2;
+        const uint32_t next = decrement(deficit, kind.group);
+
+        if (m_repeatLimit == 0 || repeat < m_repeatLimit) {
+            const int target = m_repeatLimit == 0 ? 0 : runIndex(repeat + 1, 1);
+            if (take(count(position + 1, next, last, target))) {
+                out[position] = previous;
+                deficit = next;
+                run = target;
+                continue;
+            }
+        }
+        if (successor >= 0 && ascending < m_sequenceLimit) {
+            const int target = runIndex(1, ascending + 1);
+            if (take(count(position + 1, next, successor, target))) {
+                previous = m_kinds[successor].characters[0];
+                out[position] = previous;
+                deficit = next;
+                last = successor;
+                run = target;
+                continue;
+            }
+        }
+
+        // A fresh character: first its group, then the character
+        int chosen = -1;
+        for (int g = 0; g < static_cast<int>(m_groups.size()) && chosen < 0; ++g) {
+            const uint32_t target = decrement(deficit, g);
+            std::copy(groupTotal(position + 1, deficit, g), groupTotal(position + 1, deficit, g) + m_limbs, weight);
+            if (g == kind.group) {
+                subtract(weight, count(position + 1, target, last, 0), m_limbs);
+                if (successor >= 0) {
+                    subtract(weight, count(position + 1, target, successor, 0), m_limbs);
+                }
+            }
+            if (!take(weight)) {
+                continue;
+            }
+
+            const Group &group = m_groups[g];
+            for (int k = group.firstKind; k < group.firstKind + group.kindCount && chosen < 0; ++k) {
+                if (k == successor) {
+                    continue;
+                }
+                const uint64_t *each = count(position + 1, target, k, 0);
+                for (int i = 0; i < m_kinds[k].size; ++i) {
+                    const char c = m_kinds[k].characters[i];
+                    if (c != previous && take(each)) {
+                        previous = c;
+                        chosen = k;
+                        break;
+                    }
+                }
+            }
+            deficit = target;
+        }
+        out[position] = previous;
+        last = chosen;
+        run = 0;
+    }
+    return static_cast<size_t>(length);
+}
+
+} // namespace qenqey
@@ -0,0 +1,151 @@
+#ifndef QENQEY_CORE_CONSTRAINED_H
+#define QENQEY_CORE_CONSTRAINED_H
+
+#include "settings.h"
+#include "source.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qenqey {
+
+// Longest run limit the rules accept; anything above it would hardly ever bind
+constexpr int MAX_RULE_RUN = 8;
+
+// Largest count table a rule set may build. Longer passwords with high
+// minimums and a sequence limit are refused rather than allowed to
+// stall the caller.
+constexpr size_t MAX_RULE_TABLE_BYTES = 64u << 20;
+
+// Constraints on top of GeneratorSettings. The defaults reproduce the
+// plain character mode: one character of each selected class.
+struct CharacterRules
+{
+    static constexpr int DEFAULT_MINIMUM = -1;
+
+    // Fewest characters of each class, indexed like classCharacters().
+    // DEFAULT_MINIMUM means one for a selected class and none otherwise.
+    int minimum[CLASS_COUNT] = {DEFAULT_MINIMUM, DEFAULT_MINIMUM, DEFAULT_MINIMUM, DEFAULT_MINIMUM};
+
+    // Longest run of one repeated character ("aaa" is 3); 0 for no limit
+    int maxRepeat = 0;
+
+    // Longest run of characters ascending one code point at a time within
+    // a class ("abc", "123", "#$%" are 3); 0 for no limit
+    int maxSequence = 0;
+
+    // Characters a password must not start with
+    std::string bannedFirst;
+
+    bool isDefault() const;
+};
+
+enum class RuleError {
+    None,
+    NoClasses,
+    UnselectedMinimum,
+    BadLimit,
+    Impossible,
+    TooComplex,
+};
+
+const char *ruleErrorText(RuleError error);
+
+// Reads per-class minimums such as "u2,d3" (class letters as in the
+// policy's classes= key) into rules. Classes not named keep their value.
+bool parseClassMinimums(std::string_view text, CharacterRules &rules);
+
+// Character passwords under CharacterRules, drawn exactly uniformly from
+// every password the rules allow, with no retry loop.
+//
+// The constructor counts, for each position, every way to finish a
+// password from each state: the minimums still owed per class, the last
+// character and its current repeat and ascending runs. generate() then
+// draws one random rank below the total and walks it down the table, one
+// character per position, so a password costs O(length * alphabet) big
+// number compares however strict the rules are. The table size is what
+// strict rules make grow, and it is capped by MAX_RULE_TABLE_BYTES.
+class ConstrainedPlan : public PasswordSource
+{
+public:
+    ConstrainedPlan();
+    ConstrainedPlan(const GeneratorSettings &settings, const CharacterRules &rules);
+
+    bool isValid() const override { return m_error == RuleError::None; }
+    size_t maxLength() const override { return static_cast<size_t>(m_settings.length); }
+    size_t generate(RandomStream &random, char *out) const override;
+
+    // Exact: log2 of the number of allowed passwords
+    double entropyBits() const override { return m_entropy; }
+
+    RuleError error() const { return m_error; }
+    const GeneratorSettings &settings() const { return m_settings; }
+    const CharacterRules &rules() const { return m_rules; }
+
+    // Minimum actually enforced for a class, after defaults
+    int minimum(int cls) const;
+
+    // Memory held by the count table
+    size_t tableBytes() const { return (m_counts.size() + m_totals.size()) * sizeof(uint64_t); }
+
+private:
+    static constexpr int MAX_LIMBS = 16;
+
+    // Characters that behave the same for the rules. With a sequence
+    // limit every character is its own kind; otherwise a whole class is
+    // one kind.
+    struct Kind
+    {
+        uint8_t group;
+        // Index of the kind holding character + 1, or -1
+        int16_t successor;
+        uint8_t size;
+        uint8_t firstSize;
+        char characters[26];
+        // Members allowed first, a prefix permutation of characters
+        char firstCharacters[26];
+    };
+
+    struct Group
+    {
+        int cls;
+        int minimum;
+        int firstKind;
+        int kindCount;
+        uint32_t stride;
+    };
+
+    void build();
+    int runIndex(int repeat, int ascending) const;
+    uint32_t decrement(uint32_t deficit, int group) const;
+
+    // Count of completions after position characters, from a state
+    const uint64_t *count(int position, uint32_t deficit, int kind, int run) const;
+    // Sum of count() over every member of a group entered fresh
+    const uint64_t *groupTotal(int position, uint32_t deficit, int group) const;
+    uint64_t *countAt(int position, uint32_t deficit, int kind, int run);
+    uint64_t *groupTotalAt(int position, uint32_t deficit, int group);
+
+    GeneratorSettings m_settings;
+    CharacterRules m_rules;
+    std::vector<Group> m_groups;
+    std::vector<Kind> m_kinds;
+    int m_runs;
+    int m_repeatLimit;
+    int m_sequenceLimit;
+    uint32_t m_deficits;
+    uint32_t m_startDeficit;
+    int m_limbs;
+    std::vector<uint64_t> m_counts;
+    std::vector<uint64_t> m_totals;
+    uint64_t m_total[MAX_LIMBS];
+    int m_totalBits;
+    double m_entropy;
+    RuleError m_error;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_CONSTRAINED_H
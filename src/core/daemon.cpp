@@ -0,0 +1,585 @@
+#include "daemon.h"
+#include "breach.h"
+#include "constrained.h"
+#include "metrics.h"
+#include "random.h"
+#include "wordlist.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace qenqey {
+
+namespace {
+
+// Stop reading a connection's requests while this much output is queued
+constexpr size_t HIGH_WATER = 4 << 20;
+
+// Passwords generated per step of a large batch
+constexpr uint64_t GENERATE_BLOCK = 4096;
+
+// Longer request lines are a protocol error
+constexpr size_t MAX_LINE = 4096;
+
+// The compiled-policy cache is simply dropped when it grows past this
+constexpr size_t MAX_CACHED_POLICIES = 256;
+
+// ... or when its character rule tables grow past this
+constexpr size_t MAX_CACHED_TABLE_BYTES = 4 * MAX_RULE_TABLE_BYTES;
+
+// Output queue for one connection. Holds passwords, so every byte is
+// wiped once sent and the old block is wiped whenever it grows.
+class SecretBuffer
+{
+public:
+    SecretBuffer() = default;
+    ~SecretBuffer()
+    {
+        if (m_data) {
+            explicit_bzero(m_data, m_end);
+            std::free(m_data);
+        }
+    }
+
+    SecretBuffer(const SecretBuffer &) = delete;
+    SecretBuffer &operator=(const SecretBuffer &) = delete;
+
+    const char *data() const { return m_data + m_start; }
+    size_t size() const { return m_end - m_start; }
+
+    // Returns room for at least size more bytes
+    char *reserve(size_t size)
+    {
+        if (m_capacity - m_end >= size) {
+            return m_data + m_end;
+        }
+
+        const size_t live = m_end - m_start;
+        if (live + size <= m_capacity && m_start >= live) {
+            // Non-overlapping move to the front, then wipe what is left
+            std::memcpy(m_data, m_data + m_start, live);
+            explicit_bzero(m_data + live, m_end - live);
+        } else {
+            const size_t capacity = std::max({m_capacity * 2, live + size, size_t(64 * 1024)});
+            char *data = static_cast<char *>(std::malloc(capacity));
+            if (!data) {
+                return nullptr;
+            }
+            if (m_data) {
+                std::memcpy(data, m_data + m_start, live);
+                explicit_bzero(m_data, m_end);
+                std::free(m_data);
+            }
+            m_data = data;
+            m_capacity = capacity;
+        }
+        m_start = 0;
+        m_end = live;
+        return m_data + m_end;
+    }
+
+    void commit(size_t size) { m_end += size; }
+
+    void append(const char *data, size_t size)
+    {
+        if (char *out = reserve(size)) {
+            std::memcpy(out, data, size);
+            commit(size);
+        }
+    }
+
+    void consume(size_t size)
+    {
+        explicit_bzero(m_data + m_start, size);
+        m_start += size;
+        if (m_start == m_end) {
+            m_start = m_end = 0;
+        }
+    }
+
+private:
+    char *m_data = nullptr;
+    size_t m_capacity = 0;
+    size_t m_start = 0;
+    size_t m_end = 0;
+};
+
+bool parseCount(std::string_view text, uint64_t &count)
+{
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), count);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+} // namespace
+
+struct DaemonServer::Connection
+{
+    int fd = -1;
+    uint32_t events = 0;
+    std::string input;
+    SecretBuffer output;
+
+    // Rest of a GEN batch still to be produced
+    std::shared_ptr<const PasswordSource> pendingSource;
+    uint64_t pendingCount = 0;
+
+    // The peer shut down its side; answer what was sent, then close
+    bool peerClosed = false;
+    bool failed = false;
+};
+
+DaemonServer::DaemonServer(const DaemonOptions &options)
+    : m_options(options)
+    , m_listenFd(-1)
+    , m_epollFd(-1)
+    , m_stopFd(-1)
+    , m_signalFd(-1)
+    , m_cachedBytes(0)
+{
+    if (m_options.socketPath.empty()) {
+        m_options.socketPath = defaultSocketPath();
+    }
+}
+
+DaemonServer::~DaemonServer()
+{
+    for (auto &entry : m_connections) {
+        ::close(entry.first);
+    }
+    m_connections.clear();
+
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        unlink(m_options.socketPath.c_str());
+    }
+    for (int fd : {m_epollFd, m_stopFd, m_signalFd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+std::string DaemonServer::defaultSocketPath()
+{
+    if (const char *runtime = std::getenv("XDG_RUNTIME_DIR")) {
+        if (*runtime) {
+            return std::string(runtime) + "/qenqey.sock";
+        }
+    }
+    return "/tmp/qenqey-" + std::to_string(getuid()) + ".sock";
+}
+
+bool DaemonServer::listen(std::string *error)
+{
+    auto fail = [error](const std::string &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (m_options.socketPath.size() >= sizeof(address.sun_path)) {
+        return fail("socket path too long: " + m_options.socketPath);
+    }
+    std::memcpy(address.sun_path, m_options.socketPath.c_str(), m_options.socketPath.size() + 1);
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        return fail(std::string("socket: ") + std::strerror(errno));
+    }
+
+    // Refuse to steal the socket of a running daemon; replace a stale one
+    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        const bool alive = connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+        ::close(probe);
+        if (alive) {
+            ::close(m_listenFd);
+            m_listenFd = -1;
+            return fail("another daemon is listening on " + m_options.socketPath);
+        }
+    }
+    unlink(m_options.socketPath.c_str());
+
+    // Owner-only from the moment the file appears
+    const mode_t mask = umask(0177);
+    const int bound = bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+    umask(mask);
+    if (bound < 0 || ::listen(m_listenFd, SOMAXCONN) < 0) {
+        const std::string message = m_options.socketPath + ": " + std::strerror(errno);
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return fail(message);
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_stopFd < 0) {
+        return fail(std::string("epoll: ") + std::strerror(errno));
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = m_listenFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event);
+    event.data.fd = m_stopFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_stopFd, &event);
+
+    if (m_options.handleSignals) {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        sigprocmask(SIG_BLOCK, &signals, nullptr);
+        m_signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (m_signalFd >= 0) {
+            event.data.fd = m_signalFd;
+            epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_signalFd, &event);
+        }
+    }
+    return true;
+}
+
+bool DaemonServer::run()
+{
+    if (m_epollFd < 0) {
+        return false;
+    }
+
+    epoll_event events[64];
+    for (;;) {
+        const int ready = epoll_wait(m_epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == m_stopFd || fd == m_signalFd) {
+                return true;
+            }
+            if (fd == m_listenFd) {
+                accept();
+                continue;
+            }
+
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) {
+                continue;
+            }
+            Connection &connection = *it->second;
+            bool ok = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                ok = readFrom(connection);
+            }
+            if (ok) {
+                ok = writeTo(connection);
+            }
+            if (!ok) {
+                close(fd);
+            }
+        }
+    }
+}
+
+void DaemonServer::stop()
+{
+    const uint64_t one = 1;
+    if (m_stopFd >= 0) {
+        [[maybe_unused]] ssize_t written = ::write(m_stopFd, &one, sizeof(one));
+    }
+}
+
+void DaemonServer::accept()
+{
+    for (;;) {
+        const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ::close(fd);
+            continue;
+        }
+        m_connections.emplace(fd, std::move(connection));
+    }
+}
+
+void DaemonServer::close(int fd)
+{
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_connections.erase(fd);
+}
+
+bool DaemonServer::readFrom(Connection &connection)
+{
+    if (connection.peerClosed) {
+        return true;
+    }
+
+    char buffer[64 * 1024];
+    const ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (received < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    if (received == 0) {
+        connection.peerClosed = true;
+        return true;
+    }
+    connection.input.append(buffer, static_cast<size_t>(received));
+    return true;
+}
+
+bool DaemonServer::writeTo(Connection &connection)
+{
+    for (;;) {
+        // Produce: finish the current batch, then handle queued requests,
+        // until enough output is waiting. Handled lines are dropped from
+        // the input once per pass, not one by one, so a pipelined burst
+        // costs a single move.
+        size_t consumed = 0;
+        while (connection.output.size() < HIGH_WATER && !connection.failed) {
+            if (connection.pendingCount > 0) {
+                generate(connection, connection.pendingCount, *connection.pendingSource);
+                continue;
+            }
+
+            const size_t newline = connection.input.find('\n', consumed);
+            if (newline == std::string::npos) {
+                if (connection.input.size() - consumed > MAX_LINE) {
+                    static const char TOO_LONG[] = "ERR request too long\n";
+                    connection.output.append(TOO_LONG, sizeof(TOO_LONG) - 1);
+                    consumed = connection.input.size();
+                    connection.failed = true;
+                }
+                break;
+            }
+
+            std::string_view line(connection.input.data() + consumed, newline - consumed);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            handleLine(connection, line);
+            consumed = newline + 1;
+        }
+        connection.input.erase(0, consumed);
+
+        // Send as much as the socket takes
+        while (connection.output.size() > 0) {
+            const ssize_t sent = send(connection.fd, connection.output.data(), connection.output.size(),
+                                      MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    updateInterest(connection);
+                    return true;
+                }
+                return false;
+            }
+            connection.output.consume(static_cast<size_t>(sent));
+        }
+
+        const bool moreWork = !connection.failed
+            && (connection.pendingCount > 0 || connection.input.find('\n') != std::string::npos);
+        if (!moreWork) {
+            break;
+        }
+    }
+
+    if (connection.failed || connection.peerClosed) {
+        return false;
+    }
+    updateInterest(connection);
+    return true;
+}
+
+void DaemonServer::updateInterest(Connection &connection)
+{
+    uint32_t events = 0;
+    if (!connection.peerClosed && connection.output.size() < HIGH_WATER) {
+        events |= EPOLLIN;
+    }
+    if (connection.output.size() > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return;
+    }
+
+    epoll_event event = {};
+    event.events = events;
+    event.data.fd = connection.fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = events;
+}
+
+void DaemonServer::handleLine(Connection &connection, std::string_view line)
+{
+    auto reply = [&](const std::string &text) {
+        connection.output.append(text.data(), text.size());
+    };
+
+    const size_t space = line.find(' ');
+    const std::string_view command = line.substr(0, space);
+    std::string_view arguments = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+
+    if (command == "PING") {
+        reply("PONG\n");
+        return;
+    }
+
+    std::string error;
+    if (command == "GEN") {
+        const size_t end = arguments.find(' ');
+        uint64_t count = 0;
+        if (!parseCount(arguments.substr(0, end), count) || count == 0 || count > MAX_BATCH) {
+            reply("ERR count must be 1-" + std::to_string(MAX_BATCH) + "\n");
+            return;
+        }
+        arguments = end == std::string_view::npos ? std::string_view() : arguments.substr(end + 1);
+
+        std::shared_ptr<const PasswordSource> source = sourceFor(arguments, error);
+        if (!source) {
+            reply("ERR " + error + "\n");
+            return;
+        }
+
+        reply("OK " + std::to_string(count) + "\n");
+        connection.pendingSource = std::move(source);
+        connection.pendingCount = count;
+        generate(connection, count, *connection.pendingSource);
+        return;
+    }
+
+    if (command == "ENTROPY") {
+        const std::shared_ptr<const PasswordSource> source = sourceFor(arguments, error);
+        if (!source) {
+            reply("ERR " + error + "\n");
+            return;
+        }
+        char text[64];
+        std::snprintf(text, sizeof(text), "OK %.2f\n", source->entropyBits());
+        reply(text);
+        return;
+    }
+
+    reply("ERR unknown command\n");
+}
+
+std::shared_ptr<const PasswordSource> DaemonServer::sourceFor(std::string_view policyText, std::string &error)
+{
+    const std::string key(policyText);
+    auto it = m_sources.find(key);
+    if (it != m_sources.end()) {
+        return it->second;
+    }
+
+    Policy policy;
+    if (!parsePolicy(policyText, policy, &error)) {
+        return nullptr;
+    }
+    const Wordlist *wordlist = m_options.wordlist ? m_options.wordlist : Wordlist::shared();
+    std::unique_ptr<PasswordSource> source = makeSource(policy, wordlist, &error);
+    if (!source) {
+        return nullptr;
+    }
+
+    const auto *rules = dynamic_cast<const ConstrainedPlan *>(source.get());
+    const size_t bytes = rules ? rules->tableBytes() : 0;
+
+    // Batches in progress hold their own reference
+    if (m_sources.size() >= MAX_CACHED_POLICIES || m_cachedBytes + bytes > MAX_CACHED_TABLE_BYTES) {
+        m_sources.clear();
+        m_cachedBytes = 0;
+    }
+    m_cachedBytes += bytes;
+    return m_sources.emplace(key, std::move(source)).first->second;
+}
+
+void DaemonServer::generate(Connection &connection, uint64_t count, const PasswordSource &source)
+{
+    RandomStream &random = RandomStream::forThread();
+    const size_t recordSize = source.maxLength() + 1;
+
+    while (count > 0 && connection.output.size() < HIGH_WATER) {
+        const uint64_t n = std::min(count, GENERATE_BLOCK);
+        char *const buffer = connection.output.reserve(n * recordSize);
+        if (!buffer) {
+            connection.failed = true;
+            return;
+        }
+
+        char *out = buffer;
+        bool exhausted = false;
+        for (uint64_t i = 0; i < n && !exhausted; ++i) {
+            const uint64_t started = i % Metrics::SAMPLE_INTERVAL == 0 ? Metrics::start() : 0;
+            size_t length = source.generate(random, out);
+            if (m_options.rejectBreached) {
+                for (int attempt = 0; m_options.rejectBreached->containsPassword(std::string_view(out, length));
+                     ++attempt) {
+                    if (attempt + 1 == MAX_BREACH_RETRIES) {
+                        exhausted = true;
+                        break;
+                    }
+                    length = source.generate(random, out);
+                }
+            }
+            Metrics::stop(Metrics::Generation, started);
+            if (!exhausted) {
+                out[length] = '\n';
+                out += length + 1;
+            }
+        }
+        connection.output.commit(static_cast<size_t>(out - buffer));
+
+        if (exhausted) {
+            // The buffer only wipes what was committed
+            explicit_bzero(out, recordSize);
+            // The batch cannot be completed, and a short batch would
+            // misalign every pipelined reply after it: report and close
+            static const char EXHAUSTED[] = "ERR policy space exhausted by breach corpus\n";
+            connection.output.append(EXHAUSTED, sizeof(EXHAUSTED) - 1);
+            connection.failed = true;
+            connection.pendingSource.reset();
+            connection.pendingCount = 0;
+            return;
+        }
+        Metrics::add(Metrics::Passwords, n);
+        count -= n;
+    }
+
+    connection.pendingCount = count;
+    if (count == 0) {
+        connection.pendingSource.reset();
+    }
+}
+
+} // namespace qenqey
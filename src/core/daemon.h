@@ -0,0 +1,99 @@
+#ifndef QENQEY_CORE_DAEMON_H
+#define QENQEY_CORE_DAEMON_H
+
+#include "policy.h"
+#include "source.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace qenqey {
+
+class BreachCorpus;
+class Wordlist;
+
+struct DaemonOptions
+{
+    // Empty means defaultSocketPath()
+    std::string socketPath;
+
+    // Words for passphrase policies; nullptr means Wordlist::shared()
+    const Wordlist *wordlist = nullptr;
+
+    // Passwords found in this corpus are regenerated, as in bulk mode
+    const BreachCorpus *rejectBreached = nullptr;
+
+    // Stop cleanly on SIGINT/SIGTERM (the daemon's own process only)
+    bool handleSignals = false;
+};
+
+// Generator service on a Unix domain socket, so scripts can fetch
+// passwords without starting a process each time. One epoll thread
+// serves every connection; with compiled policies cached, a request costs
+// about as much as generating its passwords.
+//
+// The protocol is line-based and fully pipelined: a client may send any
+// number of requests without waiting, and responses come back in order.
+//
+//   PING                      -> PONG
+//   GEN <count> [policy]      -> OK <count>, then <count> password lines
+//   ENTROPY [policy]          -> OK <bits>
+//   anything invalid          -> ERR <message>
+//
+// With rejectBreached set, a GEN batch whose policy leaves almost nothing
+// outside the corpus ends early with an ERR line, and the connection is
+// closed, since the rest of its replies could no longer be matched up.
+//
+// Policies use the key=value form described in policy.h.
+class DaemonServer
+{
+public:
+    static constexpr uint64_t MAX_BATCH = 1000000;
+
+    explicit DaemonServer(const DaemonOptions &options);
+    ~DaemonServer();
+
+    DaemonServer(const DaemonServer &) = delete;
+    DaemonServer &operator=(const DaemonServer &) = delete;
+
+    // Binds the socket (mode 0600). Fails if another daemon answers on it;
+    // a stale socket file is replaced.
+    bool listen(std::string *error = nullptr);
+
+    // Serves until stop() or a handled signal. False on a fatal error.
+    bool run();
+
+    // Thread-safe and async-signal-safe
+    void stop();
+
+    // $XDG_RUNTIME_DIR/qenqey.sock, or /tmp/qenqey-<uid>.sock
+    static std::string defaultSocketPath();
+
+private:
+    struct Connection;
+
+    void accept();
+    bool readFrom(Connection &connection);
+    bool writeTo(Connection &connection);
+    void handleLine(Connection &connection, std::string_view line);
+    void generate(Connection &connection, uint64_t count, const PasswordSource &source);
+    std::shared_ptr<const PasswordSource> sourceFor(std::string_view policy, std::string &error);
+    void updateInterest(Connection &connection);
+    void close(int fd);
+
+    DaemonOptions m_options;
+    int m_listenFd;
+    int m_epollFd;
+    int m_stopFd;
+    int m_signalFd;
+    std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+    std::unordered_map<std::string, std::shared_ptr<const PasswordSource>> m_sources;
+    size_t m_cachedBytes;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_DAEMON_H
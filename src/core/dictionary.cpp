@@ -0,0 +1,199 @@
+#include "dictionary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace qenqey {
+
+namespace {
+
+constexpr char MAGIC[4] = {'Q', 'Q', 'D', '2'};
+
+struct Header
+{
+    char magic[4];
+    uint32_t nodeCount;
+    uint32_t wordCount;
+};
+
+} // namespace
+
+const Dictionary *Dictionary::shared()
+{
+    static Dictionary dictionary;
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        const std::string path = findDataFile("QENQEY_DICTIONARY", "dictionary.qqd");
+        if (!path.empty()) {
+            dictionary.open(path);
+        }
+    });
+
+    return dictionary.isOpen() ? &dictionary : nullptr;
+}
+
+bool Dictionary::open(const std::string &path)
+{
+    m_firstChild = nullptr;
+    if (!m_file.open(path, MappedFile::Random) || m_file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.nodeCount == 0
+        || header.nodeCount == UINT32_MAX) {
+        m_file.close();
+        return false;
+    }
+
+    const size_t firstChildSize = (size_t(header.nodeCount) + 1) * sizeof(uint32_t);
+    const size_t ranksSize = size_t(header.nodeCount) * sizeof(uint32_t);
+    if (m_file.size() < sizeof(Header) + firstChildSize + ranksSize + header.nodeCount) {
+        m_file.close();
+        return false;
+    }
+
+    const unsigned char *base = m_file.data() + sizeof(Header);
+    m_firstChild = reinterpret_cast<const uint32_t *>(base);
+    m_ranks = reinterpret_cast<const uint32_t *>(base + firstChildSize);
+    m_labels = base + firstChildSize + ranksSize;
+    m_nodeCount = header.nodeCount;
+    m_wordCount = header.wordCount;
+    return true;
+}
+
+uint32_t Dictionary::child(uint32_t node, unsigned char label) const
+{
+    if (node >= m_nodeCount) {
+        return NO_NODE;
+    }
+
+    // Children always come after their parent, which also rules out cycles
+    const uint32_t begin = m_firstChild[node];
+    const uint32_t end = m_firstChild[node + 1];
+    if (begin <= node || begin > end || end > m_nodeCount) {
+        return NO_NODE;
+    }
+
+    const uint8_t *first = m_labels + begin;
+    const uint8_t *last = m_labels + end;
+    const uint8_t *it = std::lower_bound(first, last, label);
+    if (it == last || *it != label) {
+        return NO_NODE;
+    }
+    return begin + static_cast<uint32_t>(it - first);
+}
+
+uint32_t Dictionary::rank(uint32_t node) const
+{
+    return node < m_nodeCount ? m_ranks[node] : 0;
+}
+
+uint32_t Dictionary::lookup(std::string_view word) const
+{
+    uint32_t node = ROOT;
+    for (char c : word) {
+        node = child(node, static_cast<unsigned char>(c));
+        if (node == NO_NODE) {
+            return 0;
+        }
+    }
+    return rank(node);
+}
+
+bool writeDictionaryIndex(const std::vector<std::string> &words, const std::string &path,
+                          std::string *error)
+{
+    struct BuildNode
+    {
+        std::vector<std::pair<uint8_t, uint32_t>> children;
+        uint32_t rank = 0;
+    };
+
+    std::vector<BuildNode> trie(1);
+    uint32_t wordCount = 0;
+    uint32_t rank = 0;
+
+    for (const std::string &word : words) {
+        ++rank;
+        if (word.empty() || !std::all_of(word.begin(), word.end(), [](char c) {
+                return c > ' ' && c < 0x7f;
+            })) {
+            continue;
+        }
+
+        uint32_t node = 0;
+        for (char c : word) {
+            const uint8_t label = static_cast<uint8_t>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+            auto &children = trie[node].children;
+            auto it = std::find_if(children.begin(), children.end(),
+                                   [label](const auto &edge) { return edge.first == label; });
+            if (it != children.end()) {
+                node = it->second;
+            } else {
+                const uint32_t created = static_cast<uint32_t>(trie.size());
+                trie[node].children.emplace_back(label, created);
+                trie.emplace_back();
+                node = created;
+            }
+        }
+
+        if (trie[node].rank == 0) {
+            trie[node].rank = rank;
+            ++wordCount;
+        }
+    }
+
+    // Breadth-first numbering with sorted children makes the children of
+    // every node a consecutive run, found from the count queued before it
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> firstChild;
+    std::vector<uint32_t> ranks;
+    std::vector<uint8_t> labels{0};
+    order.reserve(trie.size());
+    firstChild.reserve(trie.size() + 1);
+    ranks.reserve(trie.size());
+    labels.reserve(trie.size());
+    order.push_back(0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto &b = trie[order[i]];
+        std::sort(b.children.begin(), b.children.end());
+        firstChild.push_back(static_cast<uint32_t>(order.size()));
+        ranks.push_back(b.rank);
+        for (const auto &edge : b.children) {
+            order.push_back(edge.second);
+            labels.push_back(edge.first);
+        }
+    }
+    firstChild.push_back(static_cast<uint32_t>(order.size()));
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.nodeCount = static_cast<uint32_t>(order.size());
+    header.wordCount = wordCount;
+
+    FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        if (error) {
+            *error = "cannot open " + path + " for writing";
+        }
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+        && std::fwrite(firstChild.data(), sizeof(uint32_t), firstChild.size(), out) == firstChild.size()
+        && std::fwrite(ranks.data(), sizeof(uint32_t), ranks.size(), out) == ranks.size()
+        && std::fwrite(labels.data(), 1, labels.size(), out) == labels.size();
+    ok = std::fclose(out) == 0 && ok;
+
+    if (!ok && error) {
+        *error = "write to " + path + " failed";
+    }
+    return ok;
+}
+
+} // namespace qenqey
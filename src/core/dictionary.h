@@ -0,0 +1,72 @@
+#ifndef QENQEY_CORE_DICTIONARY_H
+#define QENQEY_CORE_DICTIONARY_H
+
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qenqey {
+
+// Ranked word list stored as a memory-mapped trie (".qqd" file).
+//
+// Layout, little-endian:
+//   Header   magic "QQD2", nodeCount, wordCount
+//   uint32_t firstChild[nodeCount + 1]  children of node i are nodes
+//                                       firstChild[i] .. firstChild[i + 1] - 1
+//   uint32_t ranks[nodeCount]           0 = not a word
+//   uint8_t  labels[nodeCount]          character on the edge into the node
+//
+// Nodes are numbered breadth-first with the children of each node sorted
+// by label, so they are consecutive and an edge needs no pointer of its
+// own: a node costs 9 bytes, against 17 per node plus edge for a trie
+// storing child indexes. A lookup touches two offsets and one short run
+// of labels per character.
+//
+// Suffixes are not shared (as in a DAWG): every word ends on its own
+// rank, so merging suffixes would need a separate word numbering and a
+// rank table indexed by it, which costs about what it saves on lists of
+// this size. Words are lowercase ASCII; rank 1 is the most common word.
+class Dictionary
+{
+public:
+    static constexpr uint32_t NO_NODE = 0xffffffffu;
+    static constexpr uint32_t ROOT = 0;
+
+    Dictionary() = default;
+
+    // Process-wide dictionary, mapped on first call. Looks at
+    // $QENQEY_DICTIONARY, then the data directories. Returns nullptr
+    // when no index is available.
+    static const Dictionary *shared();
+
+    bool open(const std::string &path);
+    bool isOpen() const { return m_firstChild != nullptr; }
+    uint32_t wordCount() const { return m_wordCount; }
+
+    uint32_t child(uint32_t node, unsigned char label) const;
+    uint32_t rank(uint32_t node) const;
+
+    // Rank of word, or 0 when it isn't in the dictionary
+    uint32_t lookup(std::string_view word) const;
+
+private:
+    MappedFile m_file;
+    const uint32_t *m_firstChild = nullptr;
+    const uint32_t *m_ranks = nullptr;
+    const uint8_t *m_labels = nullptr;
+    uint32_t m_nodeCount = 0;
+    uint32_t m_wordCount = 0;
+};
+
+// Builds a .qqd index from words in rank order (most common first).
+// Words are lowercased; duplicates keep their best rank and words with
+// non-ASCII characters are skipped.
+bool writeDictionaryIndex(const std::vector<std::string> &words, const std::string &path,
+                          std::string *error = nullptr);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_DICTIONARY_H
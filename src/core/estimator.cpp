@@ -0,0 +1,664 @@
+#include "estimator.h"
+#include "dictionary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace qenqey {
+
+namespace {
+
+constexpr size_t MIN_WORD_LENGTH = 3;
+constexpr size_t MAX_WORD_LENGTH = 32;
+constexpr size_t MAX_REPEAT_PERIOD = 16;
+constexpr int MAX_SEQUENCE_DELTA = 5;
+
+// Even a top-ranked word costs an attacker a few dozen guesses once its
+// position in the password is unknown (zxcvbn's MIN_SUBMATCH_GUESSES)
+const double MIN_MATCH_BITS = std::log2(50.0);
+
+struct Match
+{
+    uint16_t start;
+    uint16_t end;
+    double bits;
+    WeakestPattern pattern;
+};
+
+enum CharClassBit : unsigned {
+    LowerBit = 1u << 0,
+    UpperBit = 1u << 1,
+    DigitBit = 1u << 2,
+    SymbolBit = 1u << 3,
+    OtherBit = 1u << 4,
+};
+
+inline unsigned classOf(char32_t c)
+{
+    if (c >= 'a' && c <= 'z') return LowerBit;
+    if (c >= 'A' && c <= 'Z') return UpperBit;
+    if (c >= '0' && c <= '9') return DigitBit;
+    if (c < 0x80) return SymbolBit;
+    return OtherBit;
+}
+
+#if defined(__SSE2__)
+
+// Lanes of v holding a byte in [low, high]. SSE2 only compares signed
+// bytes, so the range is shifted down to start at -128.
+inline __m128i inRange(__m128i v, char low, char high)
+{
+    const __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - low)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + high - low + 1)));
+}
+
+#endif
+
+// Same as OR-ing classOf() over the decoded text: every byte of a
+// multibyte UTF-8 sequence is >= 0x80, and so is every byte an invalid
+// sequence gets replaced for. Sixteen bytes per step.
+unsigned classesOfUtf8(const unsigned char *text, size_t size)
+{
+#if defined(__SSE2__)
+    __m128i lower = _mm_setzero_si128();
+    __m128i upper = _mm_setzero_si128();
+    __m128i digit = _mm_setzero_si128();
+    __m128i symbol = _mm_setzero_si128();
+    __m128i other = _mm_setzero_si128();
+
+    auto scan = [&](__m128i v, __m128i valid) {
+        const __m128i l = inRange(v, 'a', 'z');
+        const __m128i u = inRange(v, 'A', 'Z');
+        const __m128i d = inRange(v, '0', '9');
+        // High bit set: part of a multibyte character
+        const __m128i high = _mm_cmplt_epi8(v, _mm_setzero_si128());
+        const __m128i known = _mm_or_si128(_mm_or_si128(l, u), _mm_or_si128(d, high));
+        lower = _mm_or_si128(lower, _mm_and_si128(l, valid));
+        upper = _mm_or_si128(upper, _mm_and_si128(u, valid));
+        digit = _mm_or_si128(digit, _mm_and_si128(d, valid));
+        other = _mm_or_si128(other, _mm_and_si128(high, valid));
+        symbol = _mm_or_si128(symbol, _mm_andnot_si128(known, valid));
+    };
+
+    size_t i = 0;
+    const __m128i all = _mm_set1_epi8(-1);
+    for (; i + 16 <= size; i += 16) {
+        scan(_mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i)), all);
+    }
+    if (i < size) {
+        // Short tail through a padded copy, with lanes past the end masked
+        alignas(16) unsigned char tail[16] = {};
+        std::copy(text + i, text + size, tail);
+        const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m128i valid = _mm_cmplt_epi8(lanes, _mm_set1_epi8(static_cast<char>(size - i)));
+        scan(_mm_load_si128(reinterpret_cast<const __m128i *>(tail)), valid);
+    }
+
+    unsigned classes = 0;
+    if (_mm_movemask_epi8(lower)) classes |= LowerBit;
+    if (_mm_movemask_epi8(upper)) classes |= UpperBit;
+    if (_mm_movemask_epi8(digit)) classes |= DigitBit;
+    if (_mm_movemask_epi8(symbol)) classes |= SymbolBit;
+    if (_mm_movemask_epi8(other)) classes |= OtherBit;
+    return classes;
+#else
+    unsigned classes = 0;
+    for (size_t i = 0; i < size; ++i) {
+        classes |= classOf(text[i]);
+    }
+    return classes;
+#endif
+}
+
+double cardinality(unsigned classes)
+{
+    double size = 0;
+    if (classes & LowerBit) size += 26;
+    if (classes & UpperBit) size += 26;
+    if (classes & DigitBit) size += 10;
+    if (classes & SymbolBit) size += 33;
+    if (classes & OtherBit) size += 100;
+    return size > 0 ? size : 1;
+}
+
+inline bool isUpperAscii(char32_t c)
+{
+    return c >= 'A' && c <= 'Z';
+}
+
+inline char32_t toLowerAscii(char32_t c)
+{
+    return isUpperAscii(c) ? c - 'A' + 'a' : c;
+}
+
+// Letters a l33t character commonly stands for
+const char *leetLetters(char32_t c)
+{
+    switch (c) {
+    case '4': case '@': return "a";
+    case '8': return "b";
+    case '(': case '{': case '[': case '<': return "c";
+    case '3': return "e";
+    case '6': case '9': return "g";
+    case '1': case '|': return "il";
+    case '!': return "i";
+    case '0': return "o";
+    case '$': case '5': return "s";
+    case '7': return "lt";
+    case '+': return "t";
+    case '%': return "x";
+    case '2': return "z";
+    }
+    return "";
+}
+
+// log2 of sum_{k=1..min(a,b)} C(a+b, k): the ways to place a marked
+// characters (capitals, shifted keys) among a+b
+double variationsBits(unsigned marked, unsigned unmarked)
+{
+    double sum = 0;
+    double binomial = 1;
+    const unsigned n = marked + unmarked;
+    for (unsigned k = 1; k <= std::min(marked, unmarked); ++k) {
+        binomial = binomial * (n - k + 1) / k;
+        sum += binomial;
+    }
+    return sum > 1 ? std::log2(sum) : 1.0;
+}
+
+double uppercaseBits(const char32_t *text, size_t start, size_t end)
+{
+    unsigned upper = 0;
+    unsigned lower = 0;
+    for (size_t i = start; i <= end; ++i) {
+        if (isUpperAscii(text[i])) {
+            ++upper;
+        } else if (text[i] >= 'a' && text[i] <= 'z') {
+            ++lower;
+        }
+    }
+
+    if (upper == 0) {
+        return 0.0;
+    }
+    // All caps, or a single capital at either end: the common cases
+    if (lower == 0 || (upper == 1 && (isUpperAscii(text[start]) || isUpperAscii(text[end])))) {
+        return 1.0;
+    }
+    return variationsBits(upper, lower);
+}
+
+class DictionaryMatcher
+{
+public:
+    DictionaryMatcher(const Dictionary &dictionary, const char32_t *text, size_t length,
+                      bool reversed, std::vector<Match> &matches)
+        : m_dictionary(dictionary)
+        , m_text(text)
+        , m_length(length)
+        , m_reversed(reversed)
+        , m_matches(matches)
+    {
+    }
+
+    void run()
+    {
+        for (size_t i = 0; i < m_length; ++i) {
+            walk(Dictionary::ROOT, i, i, 0);
+        }
+    }
+
+private:
+    void walk(uint32_t node, size_t start, size_t pos, unsigned substitutions)
+    {
+        if (pos - start >= MIN_WORD_LENGTH) {
+            if (uint32_t rank = m_dictionary.rank(node)) {
+                record(start, pos - 1, rank, substitutions);
+            }
+        }
+        if (pos >= m_length || pos - start >= MAX_WORD_LENGTH || m_text[pos] >= 0x80) {
+            return;
+        }
+
+        const char32_t c = m_text[pos];
+        const char32_t lower = toLowerAscii(c);
+        uint32_t next = m_dictionary.child(node, static_cast<unsigned char>(lower));
+        if (next != Dictionary::NO_NODE) {
+            walk(next, start, pos + 1, substitutions);
+        }
+
+        for (const char *letter = leetLetters(c); *letter; ++letter) {
+            next = m_dictionary.child(node, static_cast<unsigned char>(*letter));
+            if (next != Dictionary::NO_NODE) {
+                walk(next, start, pos + 1, substitutions + 1);
+            }
+        }
+    }
+
+    void record(size_t start, size_t end, uint32_t rank, unsigned substitutions)
+    {
+        double bits = std::log2(static_cast<double>(rank))
+            + uppercaseBits(m_text, start, end)
+            + substitutions;
+        if (m_reversed) {
+            bits += 1.0;
+            const size_t originalStart = m_length - 1 - end;
+            end = m_length - 1 - start;
+            start = originalStart;
+        }
+
+        m_matches.push_back(Match{static_cast<uint16_t>(start), static_cast<uint16_t>(end),
+                                  std::max(bits, MIN_MATCH_BITS), WeakestPattern::Dictionary});
+    }
+
+    const Dictionary &m_dictionary;
+    const char32_t *m_text;
+    size_t m_length;
+    bool m_reversed;
+    std::vector<Match> &m_matches;
+};
+
+// QWERTY in "slanted" coordinates: each row starts half a key further
+// right, so the keys above column c are c and c+1, and below c-1 and c
+class Keyboard
+{
+public:
+    Keyboard()
+    {
+        static const char *const rows[] = {
+            "`1234567890-=", " qwertyuiop[]\\", " asdfghjkl;'", " zxcvbnm,./",
+        };
+        static const char *const shiftedRows[] = {
+            "~!@#$%^&*()_+", " QWERTYUIOP{}|", " ASDFGHJKL:\"", " ZXCVBNM<>?",
+        };
+
+        for (Key &key : m_keys) {
+            key.row = -1;
+        }
+        for (int r = 0; r < ROWS; ++r) {
+            for (int c = 0; rows[r][c]; ++c) {
+                if (rows[r][c] == ' ') {
+                    continue;
+                }
+                m_keys[static_cast<unsigned char>(rows[r][c])] = Key{r, c, false};
+                m_keys[static_cast<unsigned char>(shiftedRows[r][c])] = Key{r, c, true};
+                m_layout[r][c] = rows[r][c];
+                ++m_keyCount;
+            }
+        }
+
+        unsigned degrees = 0;
+        for (int r = 0; r < ROWS; ++r) {
+            for (int c = 0; c < COLUMNS; ++c) {
+                if (!m_layout[r][c]) {
+                    continue;
+                }
+                for (int d = 0; d < DIRECTIONS; ++d) {
+                    int nr = r + OFFSETS[d][0];
+                    int nc = c + OFFSETS[d][1];
+                    if (nr >= 0 && nr < ROWS && nc >= 0 && nc < COLUMNS && m_layout[nr][nc]) {
+                        ++degrees;
+                    }
+                }
+            }
+        }
+        m_averageDegree = static_cast<double>(degrees) / m_keyCount;
+    }
+
+    // Direction index from a to b, or -1 when the keys aren't adjacent
+    int direction(char32_t a, char32_t b) const
+    {
+        if (a >= 0x80 || b >= 0x80) {
+            return -1;
+        }
+        const Key &from = m_keys[a];
+        const Key &to = m_keys[b];
+        if (from.row < 0 || to.row < 0) {
+            return -1;
+        }
+        for (int d = 0; d < DIRECTIONS; ++d) {
+            if (from.row + OFFSETS[d][0] == to.row && from.column + OFFSETS[d][1] == to.column) {
+                return d;
+            }
+        }
+        return -1;
+    }
+
+    bool isShifted(char32_t c) const
+    {
+        return c < 0x80 && m_keys[c].row >= 0 && m_keys[c].shifted;
+    }
+
+    int keyCount() const { return m_keyCount; }
+    double averageDegree() const { return m_averageDegree; }
+
+private:
+    static constexpr int ROWS = 4;
+    static constexpr int COLUMNS = 16;
+    static constexpr int DIRECTIONS = 6;
+    static constexpr int OFFSETS[DIRECTIONS][2] = {
+        {0, -1}, {0, 1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0},
+    };
+
+    struct Key
+    {
+        int row;
+        int column;
+        bool shifted;
+    };
+
+    Key m_keys[128];
+    char m_layout[ROWS][COLUMNS] = {};
+    int m_keyCount = 0;
+    double m_averageDegree = 0;
+};
+
+const Keyboard &keyboard()
+{
+    static const Keyboard instance;
+    return instance;
+}
+
+// zxcvbn's estimate for a walk of the given length and number of turns
+double spatialBits(size_t length, unsigned turns, unsigned shifted)
+{
+    const Keyboard &kb = keyboard();
+    const double starts = kb.keyCount();
+    const double degree = kb.averageDegree();
+
+    double guesses = 0;
+    for (size_t i = 2; i <= length; ++i) {
+        const unsigned possibleTurns = std::min<unsigned>(turns, static_cast<unsigned>(i - 1));
+        double binomial = 1;
+        for (unsigned j = 1; j <= possibleTurns; ++j) {
+            // C(i-1, j-1) built incrementally
+            if (j > 1) {
+                binomial = binomial * (i - j + 1) / (j - 1);
+            }
+            guesses += binomial * starts * std::pow(degree, j);
+        }
+    }
+
+    double bits = std::log2(guesses);
+    if (shifted > 0) {
+        const unsigned unshifted = static_cast<unsigned>(length) - shifted;
+        bits += unshifted == 0 ? 1.0 : variationsBits(shifted, unshifted);
+    }
+    return bits;
+}
+
+void matchSpatial(const char32_t *text, size_t length, std::vector<Match> &matches)
+{
+    const Keyboard &kb = keyboard();
+    size_t i = 0;
+    while (i + 1 < length) {
+        size_t j = i;
+        int lastDirection = -1;
+        unsigned turns = 0;
+        unsigned shifted = kb.isShifted(text[i]) ? 1 : 0;
+
+        while (j + 1 < length) {
+            const int d = kb.direction(text[j], text[j + 1]);
+            if (d < 0) {
+                break;
+            }
+            if (d != lastDirection) {
+                ++turns;
+                lastDirection = d;
+            }
+            if (kb.isShifted(text[j + 1])) {
+                ++shifted;
+            }
+            ++j;
+        }
+
+        if (j - i + 1 >= 3) {
+            matches.push_back(Match{static_cast<uint16_t>(i), static_cast<uint16_t>(j),
+                                    spatialBits(j - i + 1, turns, shifted), WeakestPattern::Spatial});
+        }
+        i = j > i ? j : i + 1;
+    }
+}
+
+void matchRepeats(const char32_t *text, size_t length, std::vector<Match> &matches)
+{
+    for (size_t period = 1; period <= MAX_REPEAT_PERIOD && period * 2 <= length; ++period) {
+        for (size_t i = 0; i + 2 * period <= length; ++i) {
+            // Only report maximal repeats, starting where they start
+            if (i >= period && text[i - 1] == text[i - 1 + period]) {
+                continue;
+            }
+
+            size_t reps = 1;
+            while (i + (reps + 1) * period <= length
+                   && std::equal(text + i, text + i + period, text + i + reps * period)) {
+                ++reps;
+            }
+            if (reps < 2 || reps * period < 3) {
+                continue;
+            }
+
+            unsigned classes = 0;
+            for (size_t k = i; k < i + period; ++k) {
+                classes |= classOf(text[k]);
+            }
+            const double bits = period * std::log2(cardinality(classes)) + std::log2(double(reps));
+            matches.push_back(Match{static_cast<uint16_t>(i), static_cast<uint16_t>(i + reps * period - 1),
+                                    std::max(bits, MIN_MATCH_BITS), WeakestPattern::Repeat});
+        }
+    }
+}
+
+void matchSequences(const char32_t *text, size_t length, std::vector<Match> &matches)
+{
+    size_t i = 0;
+    while (i + 2 < length) {
+        const unsigned cls = classOf(text[i]);
+        const long delta = long(text[i + 1]) - long(text[i]);
+        if (delta == 0 || std::labs(delta) > MAX_SEQUENCE_DELTA || cls == SymbolBit || cls == OtherBit
+            || classOf(text[i + 1]) != cls) {
+            ++i;
+            continue;
+        }
+
+        size_t j = i + 1;
+        while (j + 1 < length && classOf(text[j + 1]) == cls && long(text[j + 1]) - long(text[j]) == delta) {
+            ++j;
+        }
+
+        const size_t runLength = j - i + 1;
+        if (runLength >= 3) {
+            const char32_t first = text[i];
+            double base;
+            if (first == 'a' || first == 'A' || first == 'z' || first == 'Z'
+                || first == '0' || first == '1' || first == '9') {
+                base = 4;
+            } else if (cls == DigitBit) {
+                base = 10;
+            } else {
+                base = 26;
+            }
+            const double bits = std::log2(base * runLength) + (delta < 0 ? 1.0 : 0.0);
+            matches.push_back(Match{static_cast<uint16_t>(i), static_cast<uint16_t>(j),
+                                    std::max(bits, MIN_MATCH_BITS), WeakestPattern::Sequence});
+        }
+        i = j;
+    }
+}
+
+int referenceYear()
+{
+    static const int year = [] {
+        std::time_t now = std::time(nullptr);
+        std::tm parts;
+        gmtime_r(&now, &parts);
+        return parts.tm_year + 1900;
+    }();
+    return year;
+}
+
+void matchYears(const char32_t *text, size_t length, std::vector<Match> &matches)
+{
+    for (size_t i = 0; i + 4 <= length; ++i) {
+        int year = 0;
+        size_t k = 0;
+        for (; k < 4 && text[i + k] >= '0' && text[i + k] <= '9'; ++k) {
+            year = year * 10 + int(text[i + k] - '0');
+        }
+        if (k == 4 && year >= 1900 && year <= 2099) {
+            const double span = std::max(std::abs(year - referenceYear()), 20);
+            matches.push_back(Match{static_cast<uint16_t>(i), static_cast<uint16_t>(i + 3),
+                                    std::log2(span), WeakestPattern::Year});
+        }
+    }
+}
+
+// Cover search behind the public overloads, given the OR of classOf()
+// over the password
+StrengthEstimate estimateWithClasses(const char32_t *password, size_t length,
+                                     const Dictionary *dictionary, unsigned classes)
+{
+    StrengthEstimate estimate;
+    if (length == 0) {
+        return estimate;
+    }
+
+    const double bruteBits = std::log2(cardinality(classes));
+
+    const size_t n = std::min(length, MAX_ANALYZED_LENGTH);
+    thread_local std::vector<Match> matches;
+    matches.clear();
+
+    if (dictionary) {
+        DictionaryMatcher(*dictionary, password, n, false, matches).run();
+
+        char32_t reversed[MAX_ANALYZED_LENGTH];
+        std::reverse_copy(password, password + n, reversed);
+        DictionaryMatcher(*dictionary, reversed, n, true, matches).run();
+    }
+    matchSpatial(password, n, matches);
+    matchRepeats(password, n, matches);
+    matchSequences(password, n, matches);
+    matchYears(password, n, matches);
+
+    std::sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) {
+        return a.end < b.end;
+    });
+
+    // Cheapest cover of password[0, k) for every k; a position is either
+    // brute-forced on its own or ends one of the matches
+    double best[MAX_ANALYZED_LENGTH + 1];
+    int via[MAX_ANALYZED_LENGTH + 1];
+    best[0] = 0;
+    size_t next = 0;
+    for (size_t k = 0; k < n; ++k) {
+        best[k + 1] = best[k] + bruteBits;
+        via[k + 1] = -1;
+        for (; next < matches.size() && matches[next].end == k; ++next) {
+            const double candidate = best[matches[next].start] + matches[next].bits;
+            if (candidate < best[k + 1]) {
+                best[k + 1] = candidate;
+                via[k + 1] = static_cast<int>(next);
+            }
+        }
+    }
+
+    // Walk the chosen cover back to report what made the password weak
+    size_t longest = 0;
+    for (size_t k = n; k > 0;) {
+        if (via[k] < 0) {
+            --k;
+            continue;
+        }
+        const Match &m = matches[via[k]];
+        const size_t span = m.end - m.start + 1;
+        estimate.patternLength += span;
+        if (span > longest) {
+            longest = span;
+            estimate.weakest = m.pattern;
+        }
+        k = m.start;
+    }
+
+    estimate.bits = best[n] + (length - n) * bruteBits;
+    estimate.score = strengthScore(estimate.bits);
+    return estimate;
+}
+
+// Decodes into a buffer reused across calls. Malformed sequences become
+// U+FFFD without swallowing the ASCII byte that broke them, so every
+// ASCII byte decodes to itself and every other byte ends up in a
+// character >= 0x80; classesOfUtf8() relies on both.
+const std::u32string &decodeUtf8(std::string_view utf8)
+{
+    thread_local std::u32string text;
+    text.clear();
+
+    for (size_t i = 0; i < utf8.size();) {
+        const unsigned char lead = static_cast<unsigned char>(utf8[i]);
+        const size_t extra = lead < 0x80 ? 0 : lead < 0xe0 ? 1 : lead < 0xf0 ? 2 : 3;
+
+        char32_t c = extra == 0 ? lead : lead & (0x3f >> extra);
+        size_t k = 1;
+        for (; k <= extra && i + k < utf8.size(); ++k) {
+            const unsigned char next = static_cast<unsigned char>(utf8[i + k]);
+            if ((next & 0xc0) != 0x80) {
+                break;
+            }
+            c = (c << 6) | (next & 0x3f);
+        }
+        if (k <= extra || (extra > 0 && c < 0x80) || (lead & 0xc0) == 0x80) {
+            // Truncated, overlong or a stray continuation byte
+            c = 0xfffd;
+        }
+        text.push_back(c);
+        i += k;
+    }
+    return text;
+}
+
+} // namespace
+
+int strengthScore(double bits)
+{
+    if (bits <= 0) {
+        return 0;
+    }
+    return static_cast<int>(std::lround(std::min(bits, STRONG_PASSWORD_BITS) * 100.0 / STRONG_PASSWORD_BITS));
+}
+
+StrengthEstimate estimateStrength(const char32_t *password, size_t length)
+{
+    return estimateStrength(password, length, Dictionary::shared());
+}
+
+StrengthEstimate estimateStrength(const char32_t *password, size_t length, const Dictionary *dictionary)
+{
+    unsigned classes = 0;
+    for (size_t i = 0; i < length; ++i) {
+        classes |= classOf(password[i]);
+    }
+    return estimateWithClasses(password, length, dictionary, classes);
+}
+
+StrengthEstimate estimateStrength(std::string_view utf8)
+{
+    return estimateStrength(utf8, Dictionary::shared());
+}
+
+StrengthEstimate estimateStrength(std::string_view utf8, const Dictionary *dictionary)
+{
+    const unsigned classes = classesOfUtf8(reinterpret_cast<const unsigned char *>(utf8.data()), utf8.size());
+    const std::u32string &text = decodeUtf8(utf8);
+    return estimateWithClasses(text.data(), text.size(), dictionary, classes);
+}
+
+} // namespace qenqey
@@ -0,0 +1,59 @@
+#ifndef QENQEY_CORE_ESTIMATOR_H
+#define QENQEY_CORE_ESTIMATOR_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace qenqey {
+
+class Dictionary;
+
+// Pattern that contributed most to a password being guessable
+enum class WeakestPattern {
+    None,
+    Dictionary,
+    Spatial,
+    Repeat,
+    Sequence,
+    Year,
+};
+
+struct StrengthEstimate
+{
+    // log2 of the estimated number of guesses
+    double bits = 0.0;
+
+    // 0-100, for the strength bar
+    int score = 0;
+
+    // Number of characters covered by recognised patterns
+    size_t patternLength = 0;
+    WeakestPattern weakest = WeakestPattern::None;
+};
+
+// Entropy needed for a full score
+constexpr double STRONG_PASSWORD_BITS = 90.0;
+
+constexpr size_t MAX_ANALYZED_LENGTH = 256;
+
+// Estimates how many guesses an attacker needs, in the spirit of zxcvbn:
+// the password is covered by the cheapest sequence of dictionary words
+// (including reversed and l33t spellings), keyboard walks, repeats,
+// character sequences, years and brute-forced characters. Only the first
+// MAX_ANALYZED_LENGTH characters are pattern-matched; the rest count as
+// brute force.
+//
+// Forms without a dictionary argument use Dictionary::shared(); pass a
+// dictionary (or nullptr for none) to override it. The UTF-8 forms find
+// the character classes straight from the bytes, sixteen at a time.
+StrengthEstimate estimateStrength(const char32_t *password, size_t length);
+StrengthEstimate estimateStrength(const char32_t *password, size_t length,
+                                  const Dictionary *dictionary);
+StrengthEstimate estimateStrength(std::string_view utf8);
+StrengthEstimate estimateStrength(std::string_view utf8, const Dictionary *dictionary);
+
+int strengthScore(double bits);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_ESTIMATOR_H
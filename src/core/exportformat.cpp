@@ -0,0 +1,143 @@
+#include "exportformat.h"
+
+#include <cstring>
+
+namespace qenqey {
+
+namespace {
+
+constexpr char JSON_PREFIX[] = "{\"password\":\"";
+constexpr char JSON_SUFFIX[] = "\"}\n";
+constexpr size_t JSON_PREFIX_SIZE = sizeof(JSON_PREFIX) - 1;
+constexpr size_t JSON_SUFFIX_SIZE = sizeof(JSON_SUFFIX) - 1;
+
+// Spreadsheets run a cell that starts with one of these as a formula
+bool isCsvFormulaLead(char c)
+{
+    switch (c) {
+    case '=': case '+': case '-': case '@': case '\t': case '\r':
+        return true;
+    }
+    return false;
+}
+
+bool needsCsvQuotes(const char *text, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        switch (text[i]) {
+        case ',': case '"': case ' ': case '\r': case '\n':
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool parseExportFormat(std::string_view name, ExportFormat &format)
+{
+    for (ExportFormat candidate : {ExportFormat::Plain, ExportFormat::Csv,
+                                   ExportFormat::Jsonl, ExportFormat::Binary}) {
+        if (name == exportFormatName(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *exportFormatName(ExportFormat format)
+{
+    switch (format) {
+    case ExportFormat::Plain: return "plain";
+    case ExportFormat::Csv: return "csv";
+    case ExportFormat::Jsonl: return "jsonl";
+    case ExportFormat::Binary: return "binary";
+    }
+    return "plain";
+}
+
+std::string_view exportHeader(ExportFormat format)
+{
+    switch (format) {
+    case ExportFormat::Csv: return "password\n";
+    case ExportFormat::Binary: return "QQP1";
+    default: return std::string_view();
+    }
+}
+
+size_t maxRecordSize(ExportFormat format, size_t maxLength)
+{
+    switch (format) {
+    case ExportFormat::Plain: return maxLength + 1;
+    case ExportFormat::Csv: return 2 * maxLength + 4;
+    // A control character is escaped as \u00XX, six bytes
+    case ExportFormat::Jsonl: return 6 * maxLength + JSON_PREFIX_SIZE + JSON_SUFFIX_SIZE;
+    case ExportFormat::Binary: return maxLength + 2;
+    }
+    return maxLength + 1;
+}
+
+size_t encodeRecord(ExportFormat format, const char *password, size_t length, char *out)
+{
+    char *const start = out;
+    switch (format) {
+    case ExportFormat::Plain:
+        std::memcpy(out, password, length);
+        out[length] = '\n';
+        return length + 1;
+
+    case ExportFormat::Csv: {
+        const bool formula = length > 0 && isCsvFormulaLead(password[0]);
+        if (!formula && !needsCsvQuotes(password, length)) {
+            std::memcpy(out, password, length);
+            out[length] = '\n';
+            return length + 1;
+        }
+        *out++ = '"';
+        if (formula) {
+            *out++ = '\'';
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (password[i] == '"') {
+                *out++ = '"';
+            }
+            *out++ = password[i];
+        }
+        *out++ = '"';
+        *out++ = '\n';
+        return static_cast<size_t>(out - start);
+    }
+
+    case ExportFormat::Jsonl:
+        std::memcpy(out, JSON_PREFIX, JSON_PREFIX_SIZE);
+        out += JSON_PREFIX_SIZE;
+        for (size_t i = 0; i < length; ++i) {
+            const auto c = static_cast<unsigned char>(password[i]);
+            if (c < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                std::memcpy(out, "\\u00", 4);
+                out[4] = hex[c >> 4];
+                out[5] = hex[c & 0xf];
+                out += 6;
+                continue;
+            }
+            if (c == '"' || c == '\\') {
+                *out++ = '\\';
+            }
+            *out++ = password[i];
+        }
+        std::memcpy(out, JSON_SUFFIX, JSON_SUFFIX_SIZE);
+        out += JSON_SUFFIX_SIZE;
+        return static_cast<size_t>(out - start);
+
+    case ExportFormat::Binary:
+        out[0] = static_cast<char>(length & 0xff);
+        out[1] = static_cast<char>(length >> 8);
+        std::memcpy(out + 2, password, length);
+        return length + 2;
+    }
+    return 0;
+}
+
+} // namespace qenqey
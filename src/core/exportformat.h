@@ -0,0 +1,41 @@
+#ifndef QENQEY_CORE_EXPORTFORMAT_H
+#define QENQEY_CORE_EXPORTFORMAT_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace qenqey {
+
+// File layouts for bulk export:
+//
+//   Plain   one password per line
+//   Csv     "password" header, then one field per line, quoted when it
+//           contains a comma, quote or space (RFC 4180); a field that
+//           starts with = + - @ tab or CR is also quoted and prefixed
+//           with ' so spreadsheets do not run it as a formula
+//   Jsonl   {"password":"..."} per line, control characters as \u00XX
+//   Binary  "QQP1", then per password a little-endian u16 length and the
+//           UTF-8 bytes; no separators, so any byte may appear
+enum class ExportFormat {
+    Plain,
+    Csv,
+    Jsonl,
+    Binary,
+};
+
+bool parseExportFormat(std::string_view name, ExportFormat &format);
+const char *exportFormatName(ExportFormat format);
+
+// Bytes written once at the start of the file (may be empty)
+std::string_view exportHeader(ExportFormat format);
+
+// Upper bound on encodeRecord() output for a password of at most
+// maxLength bytes
+size_t maxRecordSize(ExportFormat format, size_t maxLength);
+
+// Encodes one password as a complete record; returns the bytes written
+size_t encodeRecord(ExportFormat format, const char *password, size_t length, char *out);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_EXPORTFORMAT_H
@@ -0,0 +1,55 @@
+#include "generator.h"
+#include "random.h"
+
+#include <utility>
+
+namespace qenqey {
+
+namespace {
+
+inline char sample(const AlphabetTable &table, RandomStream &random)
+{
+    for (;;) {
+        uint8_t b = random.nextByte();
+        if (b < table.byteLimit) {
+            return table.byteMap[b];
+        }
+    }
+}
+
+} // namespace
+
+void generatePassword(const CharsetPlan &plan, RandomStream &random, char *out)
+{
+    const int length = plan.length();
+    int pos = 0;
+
+    // Add required characters first
+    for (int i = 0; i < plan.requiredCount() && pos < length; ++i) {
+        out[pos++] = sample(plan.required(i), random);
+    }
+
+    // Fill remaining positions randomly, in one batch
+    const AlphabetTable &alphabet = plan.alphabet();
+    random.sampleBytes(alphabet.byteLimit, alphabet.byteMap, out + pos, length - pos);
+
+    // Shuffle the password to avoid predictable patterns
+    for (int i = length - 1; i > 0; --i) {
+        uint32_t bound = i + 1;
+        uint32_t j = random.bounded(bound, plan.shuffleThreshold(bound));
+        std::swap(out[i], out[j]);
+    }
+}
+
+std::string generatePassword(const CharsetPlan &plan, RandomStream &random)
+{
+    if (!plan.isValid()) {
+        return std::string();
+    }
+
+    std::string password(plan.length(), '\0');
+    generatePassword(plan, random, password.data());
+    return password;
+}
+
+} // namespace qenqey
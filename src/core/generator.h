@@ -0,0 +1,21 @@
+#ifndef QENQEY_CORE_GENERATOR_H
+#define QENQEY_CORE_GENERATOR_H
+
+#include "charsetplan.h"
+
+#include <string>
+
+namespace qenqey {
+
+class RandomStream;
+
+// Writes exactly plan.length() characters into out (no terminator).
+// The plan must be valid.
+void generatePassword(const CharsetPlan &plan, RandomStream &random, char *out);
+
+// Convenience overload; returns an empty string for an invalid plan
+std::string generatePassword(const CharsetPlan &plan, RandomStream &random);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_GENERATOR_H
@@ -0,0 +1,571 @@
+#include "historylog.h"
+#include "output.h"
+#include "random.h"
+#include "settings.h"
+#include "siphash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace qenqey {
+
+namespace {
+
+// Header: magic, version, file id, key check value, seal
+constexpr char MAGIC[4] = {'Q', 'Q', 'H', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 32;
+constexpr size_t SEAL_OFFSET = 24;
+
+// Sequence numbers the key check value and the seal are tagged under;
+// records never reach them
+constexpr uint64_t KEY_CHECK_INDEX = UINT64_MAX;
+constexpr uint64_t SEAL_INDEX = UINT64_MAX - 1;
+
+// Record: payload size, tag, then the encrypted timestamp and password
+constexpr size_t RECORD_HEADER = 12;
+constexpr size_t MAX_PAYLOAD = 8 + MAX_OUTPUT_BYTES;
+
+// ChaCha20 blocks reserved per record in the counter space; enough for
+// the largest payload
+constexpr uint64_t COUNTER_STRIDE = 16;
+static_assert(COUNTER_STRIDE * CHACHA20_BLOCK_SIZE >= MAX_PAYLOAD, "record keystream too short");
+
+constexpr size_t KEY_FILE_SIZE = CHACHA20_KEY_SIZE + 2 * sizeof(uint64_t);
+
+void storeLe32(unsigned char *out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void storeLe64(unsigned char *out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint32_t loadLe32(const unsigned char *in)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+uint64_t loadLe64(const unsigned char *in)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+bool fail(std::string *error, const std::string &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+bool readExactly(int fd, void *buffer, size_t size, off_t offset)
+{
+    auto *out = static_cast<unsigned char *>(buffer);
+    while (size > 0) {
+        const ssize_t got = ::pread(fd, out, size, offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        out += got;
+        size -= static_cast<size_t>(got);
+        offset += got;
+    }
+    return true;
+}
+
+bool writeExactly(int fd, const void *buffer, size_t size, off_t offset)
+{
+    const auto *in = static_cast<const unsigned char *>(buffer);
+    while (size > 0) {
+        const ssize_t put = ::pwrite(fd, in, size, offset);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            return false;
+        }
+        in += put;
+        size -= static_cast<size_t>(put);
+        offset += put;
+    }
+    return true;
+}
+
+// Read-only mapping of part of a file
+class RangeMapping
+{
+public:
+    RangeMapping(int fd, uint64_t offset, uint64_t size)
+        : m_base(nullptr)
+        , m_length(0)
+        , m_data(nullptr)
+    {
+        if (size == 0) {
+            return;
+        }
+        const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        const uint64_t aligned = offset & ~(page - 1);
+        m_length = static_cast<size_t>(size + (offset - aligned));
+        void *base = mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(aligned));
+        if (base == MAP_FAILED) {
+            return;
+        }
+        madvise(base, m_length, MADV_SEQUENTIAL);
+        m_base = base;
+        m_data = static_cast<const unsigned char *>(base) + (offset - aligned);
+    }
+
+    ~RangeMapping()
+    {
+        if (m_base) {
+            munmap(m_base, m_length);
+        }
+    }
+
+    RangeMapping(const RangeMapping &) = delete;
+    RangeMapping &operator=(const RangeMapping &) = delete;
+
+    bool isValid() const { return m_base != nullptr; }
+    const unsigned char *data() const { return m_data; }
+
+private:
+    void *m_base;
+    size_t m_length;
+    const unsigned char *m_data;
+};
+
+} // namespace
+
+HistoryLog::HistoryLog()
+    : m_fd(-1)
+    , m_indexFd(-1)
+    , m_indexMapped(0)
+    , m_fileId(0)
+    , m_size(0)
+    , m_end(0)
+    , m_macKey{0, 0}
+{
+    std::memset(m_cipherKey, 0, sizeof(m_cipherKey));
+}
+
+HistoryLog::~HistoryLog()
+{
+    close();
+}
+
+void HistoryLog::close()
+{
+    m_index.close();
+    m_indexAppended.clear();
+    m_indexMapped = 0;
+    if (m_indexFd >= 0) {
+        ::close(m_indexFd);
+        m_indexFd = -1;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+    m_end = 0;
+    explicit_bzero(m_cipherKey, sizeof(m_cipherKey));
+    explicit_bzero(m_macKey, sizeof(m_macKey));
+}
+
+bool HistoryLog::open(const std::string &logPath, const std::string &keyPath, std::string *error)
+{
+    close();
+
+    // Not O_APPEND: records go to m_end, and the seal is rewritten in place
+    m_fd = ::open(logPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd < 0) {
+        return fail(error, logPath + ": " + std::strerror(errno));
+    }
+    if (flock(m_fd, LOCK_EX | LOCK_NB) < 0) {
+        close();
+        return fail(error, logPath + ": in use by another process");
+    }
+
+    struct stat st;
+    if (fstat(m_fd, &st) < 0) {
+        close();
+        return fail(error, logPath + ": " + std::strerror(errno));
+    }
+
+    // A log without a complete header never got its first record, so it
+    // is started over along with a new key if that is missing too
+    const bool fresh = static_cast<uint64_t>(st.st_size) < HEADER_SIZE;
+    if (!loadKey(keyPath, fresh, error)) {
+        close();
+        return false;
+    }
+
+    unsigned char header[HEADER_SIZE] = {};
+    if (fresh) {
+        if (ftruncate(m_fd, 0) < 0) {
+            close();
+            return fail(error, logPath + ": " + std::strerror(errno));
+        }
+        systemEntropy(&m_fileId, sizeof(m_fileId));
+        std::memcpy(header, MAGIC, sizeof(MAGIC));
+        storeLe32(header + 4, VERSION);
+        storeLe64(header + 8, m_fileId);
+        storeLe64(header + 16, tag(KEY_CHECK_INDEX, nullptr, 0));
+        storeLe64(header + SEAL_OFFSET, sealTag(0));
+        if (!writeExactly(m_fd, header, sizeof(header), 0)) {
+            close();
+            return fail(error, logPath + ": " + std::strerror(errno));
+        }
+        m_end = HEADER_SIZE;
+    } else {
+        if (!readExactly(m_fd, header, sizeof(header), 0) || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0
+            || loadLe32(header + 4) != VERSION) {
+            close();
+            return fail(error, logPath + ": not a history log");
+        }
+        m_fileId = loadLe64(header + 8);
+        if (loadLe64(header + 16) != tag(KEY_CHECK_INDEX, nullptr, 0)) {
+            close();
+            return fail(error, logPath + ": does not match the key in " + keyPath);
+        }
+        m_end = static_cast<uint64_t>(st.st_size);
+    }
+
+    m_indexPath = logPath + ".idx";
+    if (!loadIndex(error) || !scanTail(error)) {
+        close();
+        return false;
+    }
+
+    // The seal is written after each record, so a crash can leave it one
+    // record behind but never ahead; ahead means records were removed
+    const uint64_t seal = loadLe64(header + SEAL_OFFSET);
+    if (seal != sealTag(m_size)) {
+        if (m_size == 0 || seal != sealTag(m_size - 1)) {
+            close();
+            return fail(error, logPath + ": records are missing from the end");
+        }
+        if (!writeSeal(m_size)) {
+            close();
+            return fail(error, logPath + ": " + std::strerror(errno));
+        }
+    }
+    return true;
+}
+
+bool HistoryLog::loadKey(const std::string &path, bool create, std::string *error)
+{
+    unsigned char key[KEY_FILE_SIZE];
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT && create) {
+        // O_EXCL: if two instances race, the loser reads the winner's key
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd >= 0) {
+            systemEntropy(key, sizeof(key));
+            const bool ok = writeAll(fd, reinterpret_cast<const char *>(key), sizeof(key)) && fsync(fd) == 0;
+            explicit_bzero(key, sizeof(key));
+            ::close(fd);
+            if (!ok) {
+                unlink(path.c_str());
+                return fail(error, path + ": " + std::strerror(errno));
+            }
+        }
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        return fail(error, path + ": " + std::strerror(errno));
+    }
+
+    struct stat st;
+    const bool ok = fstat(fd, &st) == 0 && st.st_size == static_cast<off_t>(sizeof(key))
+                    && readExactly(fd, key, sizeof(key), 0);
+    ::close(fd);
+    if (!ok) {
+        explicit_bzero(key, sizeof(key));
+        return fail(error, path + ": not a history key");
+    }
+
+    std::memcpy(m_cipherKey, key, sizeof(m_cipherKey));
+    std::memcpy(m_macKey, key + sizeof(m_cipherKey), sizeof(m_macKey));
+    explicit_bzero(key, sizeof(key));
+    return true;
+}
+
+bool HistoryLog::loadIndex(std::string *error)
+{
+    m_indexFd = ::open(m_indexPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (m_indexFd < 0) {
+        return fail(error, m_indexPath + ": " + std::strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(m_indexFd, &st) < 0) {
+        return fail(error, m_indexPath + ": " + std::strerror(errno));
+    }
+
+    // A torn last entry is dropped; an index that does not fit the log,
+    // such as one restored from a different backup, is rebuilt
+    uint64_t entries = static_cast<uint64_t>(st.st_size) / sizeof(uint64_t);
+    if (entries > 0 && m_index.open(m_indexPath, MappedFile::Random)) {
+        const uint64_t firstOffset = loadLe64(m_index.data());
+        const uint64_t lastOffset = loadLe64(m_index.data() + (entries - 1) * sizeof(uint64_t));
+        if (firstOffset != HEADER_SIZE || lastOffset < HEADER_SIZE || lastOffset >= m_end) {
+            entries = 0;
+        }
+    } else {
+        entries = 0;
+    }
+    if (entries * sizeof(uint64_t) != static_cast<uint64_t>(st.st_size)) {
+        m_index.close();
+        if (ftruncate(m_indexFd, static_cast<off_t>(entries * sizeof(uint64_t))) < 0) {
+            return fail(error, m_indexPath + ": " + std::strerror(errno));
+        }
+        if (entries > 0 && !m_index.open(m_indexPath, MappedFile::Random)) {
+            return fail(error, m_indexPath + ": cannot be mapped");
+        }
+    }
+    m_indexMapped = entries;
+    return true;
+}
+
+bool HistoryLog::scanTail(std::string *error)
+{
+    const uint64_t pages = pageCount();
+    uint64_t index = pages > 0 ? (pages - 1) * PAGE_RECORDS : 0;
+    const uint64_t start = pages > 0 ? pageOffset(pages - 1) : HEADER_SIZE;
+    const uint64_t fileEnd = m_end;
+
+    const RangeMapping tail(m_fd, start, fileEnd - start);
+    if (fileEnd > start && !tail.isValid()) {
+        return fail(error, std::string("history log cannot be mapped: ") + std::strerror(errno));
+    }
+
+    uint64_t offset = start;
+    while (fileEnd - offset >= RECORD_HEADER) {
+        const uint32_t payload = loadLe32(tail.data() + (offset - start));
+        if (payload < 8 || payload > MAX_PAYLOAD || fileEnd - offset < RECORD_HEADER + payload) {
+            // A crash mid-append can leave garbage or zeros (ext4 and xfs
+            // extend the file before the data lands); that is a torn tail
+            // unless a real record still follows it
+            if (recordFollows(tail.data(), offset - start + 1, fileEnd - start, index)) {
+                return fail(error, "history log is corrupt at offset " + std::to_string(offset));
+            }
+            break;
+        }
+        if (index % PAGE_RECORDS == 0 && index / PAGE_RECORDS >= pageCount() && !appendIndex(offset)) {
+            return fail(error, m_indexPath + ": " + std::strerror(errno));
+        }
+        offset += RECORD_HEADER + payload;
+        ++index;
+    }
+
+    // What is left is a record cut short by a crash mid-append
+    if (offset != fileEnd && ftruncate(m_fd, static_cast<off_t>(offset)) < 0) {
+        return fail(error, std::string("history log cannot be repaired: ") + std::strerror(errno));
+    }
+    m_size = index;
+    m_end = offset;
+    return true;
+}
+
+// Whether a record tagged as the next or the one after starts anywhere in
+// data[from, end), which would make the bytes before it damage rather than
+// a torn append
+bool HistoryLog::recordFollows(const unsigned char *data, size_t from, size_t end, uint64_t index) const
+{
+    for (size_t offset = from; offset + RECORD_HEADER <= end; ++offset) {
+        const uint32_t payload = loadLe32(data + offset);
+        if (payload < 8 || payload > MAX_PAYLOAD || end - offset < RECORD_HEADER + payload) {
+            continue;
+        }
+        const uint64_t recordTag = loadLe64(data + offset + 4);
+        const unsigned char *const body = data + offset + RECORD_HEADER;
+        if (recordTag == tag(index, body, payload) || recordTag == tag(index + 1, body, payload)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HistoryLog::appendIndex(uint64_t offset)
+{
+    unsigned char entry[sizeof(uint64_t)];
+    storeLe64(entry, offset);
+    if (!writeAll(m_indexFd, reinterpret_cast<const char *>(entry), sizeof(entry))) {
+        // A torn entry would shift every later one
+        if (ftruncate(m_indexFd, static_cast<off_t>(pageCount() * sizeof(uint64_t))) < 0) {
+            unlink(m_indexPath.c_str());
+        }
+        return false;
+    }
+    m_indexAppended.push_back(offset);
+    return true;
+}
+
+uint64_t HistoryLog::sealTag(uint64_t count) const
+{
+    unsigned char message[sizeof(uint64_t)];
+    storeLe64(message, count);
+    return tag(SEAL_INDEX, message, sizeof(message));
+}
+
+bool HistoryLog::writeSeal(uint64_t count)
+{
+    unsigned char seal[sizeof(uint64_t)];
+    storeLe64(seal, sealTag(count));
+    return writeExactly(m_fd, seal, sizeof(seal), SEAL_OFFSET);
+}
+
+uint64_t HistoryLog::pageCount() const
+{
+    return m_indexMapped + m_indexAppended.size();
+}
+
+uint64_t HistoryLog::pageOffset(uint64_t page) const
+{
+    if (page < m_indexMapped) {
+        return loadLe64(m_index.data() + page * sizeof(uint64_t));
+    }
+    return m_indexAppended[page - m_indexMapped];
+}
+
+void HistoryLog::crypt(uint64_t index, unsigned char *data, size_t size) const
+{
+    unsigned char keystream[COUNTER_STRIDE * CHACHA20_BLOCK_SIZE];
+    const size_t blocks = (size + CHACHA20_BLOCK_SIZE - 1) / CHACHA20_BLOCK_SIZE;
+    chacha20Keystream(m_cipherKey, m_fileId, index * COUNTER_STRIDE, keystream, blocks);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] ^= keystream[i];
+    }
+    explicit_bzero(keystream, blocks * CHACHA20_BLOCK_SIZE);
+}
+
+uint64_t HistoryLog::tag(uint64_t index, const unsigned char *ciphertext, size_t size) const
+{
+    unsigned char message[16 + MAX_PAYLOAD];
+    storeLe64(message, m_fileId);
+    storeLe64(message + 8, index);
+    if (size > 0) {
+        std::memcpy(message + 16, ciphertext, size);
+    }
+    return sipHash24(m_macKey, reinterpret_cast<const char *>(message), 16 + size);
+}
+
+bool HistoryLog::append(int64_t timeMs, const char *password, size_t size)
+{
+    if (!isOpen()) {
+        return false;
+    }
+    size = std::min(size, MAX_OUTPUT_BYTES);
+
+    unsigned char record[RECORD_HEADER + MAX_PAYLOAD];
+    const uint32_t payload = static_cast<uint32_t>(8 + size);
+    unsigned char *const body = record + RECORD_HEADER;
+    storeLe32(record, payload);
+    storeLe64(body, static_cast<uint64_t>(timeMs));
+    std::memcpy(body + 8, password, size);
+    crypt(m_size, body, payload);
+    storeLe64(record + 4, tag(m_size, body, payload));
+
+    const size_t recordSize = RECORD_HEADER + payload;
+    const bool written = writeExactly(m_fd, record, recordSize, static_cast<off_t>(m_end));
+    explicit_bzero(record, recordSize);
+
+    // The record only counts once the index, if it starts a page, and the
+    // seal agree with it
+    const bool newPage = m_size % PAGE_RECORDS == 0;
+    const bool indexed = written && (!newPage || appendIndex(m_end));
+    if (!indexed || !writeSeal(m_size + 1)) {
+        if (indexed && newPage) {
+            m_indexAppended.pop_back();
+            if (ftruncate(m_indexFd, static_cast<off_t>(pageCount() * sizeof(uint64_t))) < 0) {
+                unlink(m_indexPath.c_str());
+            }
+        }
+        // Leave no partial record behind for the next open to cut off. A
+        // seal left at m_size + 1 would flag it as truncation, so both must
+        // be back in step.
+        if (ftruncate(m_fd, static_cast<off_t>(m_end)) < 0 || (written && !writeSeal(m_size))) {
+            close();
+        }
+        return false;
+    }
+
+    m_end += recordSize;
+    ++m_size;
+    return true;
+}
+
+bool HistoryLog::read(uint64_t first, uint64_t count, const Visitor &visit) const
+{
+    if (!isOpen() || first > m_size || count > m_size - first) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    const uint64_t firstPage = first / PAGE_RECORDS;
+    const uint64_t endPage = (first + count - 1) / PAGE_RECORDS + 1;
+    const uint64_t begin = pageOffset(firstPage);
+    const uint64_t end = endPage < pageCount() ? pageOffset(endPage) : m_end;
+    const RangeMapping pages(m_fd, begin, end - begin);
+    if (!pages.isValid()) {
+        return false;
+    }
+
+    unsigned char plain[MAX_PAYLOAD];
+    uint64_t offset = 0;
+    for (uint64_t index = firstPage * PAGE_RECORDS; index < first + count; ++index) {
+        if (end - begin - offset < RECORD_HEADER) {
+            return false;
+        }
+        const unsigned char *const record = pages.data() + offset;
+        const uint32_t payload = loadLe32(record);
+        if (payload < 8 || payload > MAX_PAYLOAD || end - begin - offset < RECORD_HEADER + payload) {
+            return false;
+        }
+
+        if (index >= first) {
+            const unsigned char *const body = record + RECORD_HEADER;
+            if (loadLe64(record + 4) == tag(index, body, payload)) {
+                std::memcpy(plain, body, payload);
+                crypt(index, plain, payload);
+                visit(index, static_cast<int64_t>(loadLe64(plain)), reinterpret_cast<const char *>(plain + 8),
+                      payload - 8);
+                explicit_bzero(plain, payload);
+            } else {
+                visit(index, 0, nullptr, 0);
+            }
+        }
+        offset += RECORD_HEADER + payload;
+    }
+    return true;
+}
+
+} // namespace qenqey
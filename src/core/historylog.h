@@ -0,0 +1,97 @@
+#ifndef QENQEY_CORE_HISTORYLOG_H
+#define QENQEY_CORE_HISTORYLOG_H
+
+#include "chacha20.h"
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace qenqey {
+
+// Append-only, encrypted log of issued passwords.
+//
+// Each record is a 4-byte payload size, an 8-byte SipHash-2-4 tag and
+// the payload (8-byte timestamp and the password) encrypted with
+// ChaCha20 under a per-record counter. The tag covers the file id, the
+// record's sequence number and the ciphertext, so records cannot be
+// altered, swapped or moved between files unnoticed. The header carries a
+// seal, a tag over the record count rewritten after every append, so
+// records cut from the end are detected as well; replacing the whole log
+// with an older copy of itself is not. Keys live in a separate key file
+// created on first use.
+//
+// A sparse index beside the log holds the offset of every PAGE_RECORDS-th
+// record. Opening maps only the index and the tail after its last entry,
+// so it costs the same for ten records or ten million; read() maps just
+// the pages it needs.
+//
+// One process appends at a time; open() fails while another holds the
+// log.
+class HistoryLog
+{
+public:
+    static constexpr uint64_t PAGE_RECORDS = 256;
+
+    // Visits one record. password is nullptr when the record failed
+    // authentication; it is wiped as soon as the callback returns.
+    using Visitor = std::function<void(uint64_t index, int64_t timeMs, const char *password, size_t size)>;
+
+    HistoryLog();
+    ~HistoryLog();
+
+    HistoryLog(const HistoryLog &) = delete;
+    HistoryLog &operator=(const HistoryLog &) = delete;
+
+    // Creates the log, its index and the key file if they do not exist.
+    // A torn record at the end of the log, including a zero-filled one
+    // left by a crash mid-append, is cut off, and index entries
+    // missing after a crash are rebuilt from the tail. Fails when the seal
+    // shows that records were removed.
+    bool open(const std::string &logPath, const std::string &keyPath, std::string *error = nullptr);
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+
+    // Number of records
+    uint64_t size() const { return m_size; }
+
+    // False, with the log unchanged, when the record, its index entry or
+    // the seal cannot be written
+    bool append(int64_t timeMs, const char *password, size_t size);
+
+    // Visits records [first, first + count) in order
+    bool read(uint64_t first, uint64_t count, const Visitor &visit) const;
+
+private:
+    bool loadKey(const std::string &path, bool create, std::string *error);
+    bool loadIndex(std::string *error);
+    bool scanTail(std::string *error);
+    bool recordFollows(const unsigned char *data, size_t from, size_t end, uint64_t index) const;
+    bool appendIndex(uint64_t offset);
+    uint64_t sealTag(uint64_t count) const;
+    bool writeSeal(uint64_t count);
+    uint64_t pageOffset(uint64_t page) const;
+    uint64_t pageCount() const;
+    void crypt(uint64_t index, unsigned char *data, size_t size) const;
+    uint64_t tag(uint64_t index, const unsigned char *ciphertext, size_t size) const;
+
+    int m_fd;
+    int m_indexFd;
+    std::string m_indexPath;
+    MappedFile m_index;
+    uint64_t m_indexMapped;
+    std::vector<uint64_t> m_indexAppended;
+    uint64_t m_fileId;
+    uint64_t m_size;
+    uint64_t m_end;
+    uint8_t m_cipherKey[CHACHA20_KEY_SIZE];
+    uint64_t m_macKey[2];
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_HISTORYLOG_H
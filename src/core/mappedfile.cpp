@@ -0,0 +1,114 @@
+#include "mappedfile.h"
+
+#include <climits>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef QENQEY_DATADIR
+#define QENQEY_DATADIR "/usr/share/qenqey"
+#endif
+
+namespace qenqey {
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path, AccessPattern pattern)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    switch (pattern) {
+    case Random:
+        ::madvise(data, static_cast<size_t>(info.st_size), MADV_RANDOM);
+        break;
+    case Sequential:
+        ::madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        break;
+    case Normal:
+        break;
+    }
+
+    m_data = static_cast<const unsigned char *>(data);
+    m_size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data) {
+        ::munmap(const_cast<unsigned char *>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+std::string findDataFile(const char *envVar, const char *fileName)
+{
+    if (envVar) {
+        if (const char *path = std::getenv(envVar)) {
+            return ::access(path, R_OK) == 0 ? std::string(path) : std::string();
+        }
+    }
+
+    char exe[PATH_MAX];
+    ssize_t len = ::readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len > 0) {
+        std::string dir(exe, static_cast<size_t>(len));
+        dir.erase(dir.find_last_of('/') + 1);
+        std::string candidate = dir + fileName;
+        if (::access(candidate.c_str(), R_OK) == 0) {
+            return candidate;
+        }
+    }
+
+    std::string installed = std::string(QENQEY_DATADIR) + "/" + fileName;
+    if (::access(installed.c_str(), R_OK) == 0) {
+        return installed;
+    }
+    return std::string();
+}
+
+} // namespace qenqey
@@ -0,0 +1,47 @@
+#ifndef QENQEY_CORE_MAPPEDFILE_H
+#define QENQEY_CORE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace qenqey {
+
+// Read-only memory mapping of a whole file. Pages are only read in when
+// touched, so opening even a multi-gigabyte index is cheap.
+class MappedFile
+{
+public:
+    enum AccessPattern {
+        Normal,
+        Random,
+        Sequential,
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool open(const std::string &path, AccessPattern pattern = Normal);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const unsigned char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const unsigned char *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// Locates a data file: the path in envVar if set, then fileName next to
+// the running executable (uninstalled builds), then the install datadir.
+// Returns an empty string when none of them exists.
+std::string findDataFile(const char *envVar, const char *fileName);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_MAPPEDFILE_H
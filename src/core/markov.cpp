@@ -0,0 +1,295 @@
+#include "markov.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <numeric>
+
+namespace qenqey {
+
+namespace {
+
+constexpr char MAGIC[4] = {'Q', 'Q', 'M', '1'};
+
+struct Header
+{
+    char magic[4];
+    uint32_t order;
+    uint32_t stateCount;
+    uint32_t totalWeight;
+};
+
+constexpr uint32_t COLUMN_CAPACITY = MarkovModel::TOTAL_WEIGHT / MarkovModel::COLUMNS;
+
+uint32_t statesForOrder(int order)
+{
+    uint32_t states = 1;
+    for (int i = 0; i < order; ++i) {
+        states *= MARKOV_LETTERS + 1;
+    }
+    return states;
+}
+
+// Integer weights summing to TOTAL_WEIGHT, proportional to counts. Every
+// letter that was seen keeps a nonzero weight.
+void quantize(const uint64_t *counts, uint32_t *weights)
+{
+    const uint64_t total = std::accumulate(counts, counts + MARKOV_LETTERS, uint64_t(0));
+    uint64_t assigned = 0;
+    uint64_t remainders[MARKOV_LETTERS];
+    for (int c = 0; c < MARKOV_LETTERS; ++c) {
+        const unsigned __int128 scaled = static_cast<unsigned __int128>(counts[c]) * MarkovModel::TOTAL_WEIGHT;
+        weights[c] = static_cast<uint32_t>(scaled / total);
+        remainders[c] = static_cast<uint64_t>(scaled % total);
+        if (counts[c] > 0 && weights[c] == 0) {
+            weights[c] = 1;
+            remainders[c] = 0;
+        }
+        assigned += weights[c];
+    }
+
+    // Round up the largest remainders, or take back from the heaviest
+    // letters what the minimum of one overshot
+    int order[MARKOV_LETTERS];
+    std::iota(order, order + MARKOV_LETTERS, 0);
+    std::stable_sort(order, order + MARKOV_LETTERS, [&](int a, int b) { return remainders[a] > remainders[b]; });
+    for (int i = 0; assigned < MarkovModel::TOTAL_WEIGHT; i = (i + 1) % MARKOV_LETTERS) {
+        if (counts[order[i]] > 0) {
+            ++weights[order[i]];
+            ++assigned;
+        }
+    }
+    while (assigned > MarkovModel::TOTAL_WEIGHT) {
+        uint32_t *heaviest = std::max_element(weights, weights + MARKOV_LETTERS);
+        --*heaviest;
+        --assigned;
+    }
+}
+
+// Vose's construction in exact integers: every column holds
+// COLUMN_CAPACITY, split between its own letter and one alias
+void buildAliasTable(const uint32_t *weights, MarkovModel::AliasEntry *table)
+{
+    uint32_t remaining[MarkovModel::COLUMNS] = {};
+    std::copy(weights, weights + MARKOV_LETTERS, remaining);
+
+    int small[MarkovModel::COLUMNS];
+    int large[MarkovModel::COLUMNS];
+    int smallCount = 0;
+    int largeCount = 0;
+    for (int column = 0; column < MarkovModel::COLUMNS; ++column) {
+        if (remaining[column] < COLUMN_CAPACITY) {
+            small[smallCount++] = column;
+        } else {
+            large[largeCount++] = column;
+        }
+    }
+
+    while (smallCount > 0 && largeCount > 0) {
+        const int column = small[--smallCount];
+        const int donor = large[largeCount - 1];
+        table[column] = {static_cast<uint16_t>(remaining[column]), static_cast<uint8_t>(donor), 0};
+        remaining[donor] -= COLUMN_CAPACITY - remaining[column];
+        if (remaining[donor] < COLUMN_CAPACITY) {
+            --largeCount;
+            small[smallCount++] = donor;
+        }
+    }
+    // Whatever is left is exactly full
+    for (int i = 0; i < largeCount; ++i) {
+        table[large[i]] = {0, static_cast<uint8_t>(large[i]), 0};
+    }
+}
+
+} // namespace
+
+const MarkovModel *MarkovModel::shared()
+{
+    static MarkovModel model;
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        const std::string path = findDataFile("QENQEY_MARKOV", "markov.qqm");
+        if (!path.empty()) {
+            model.open(path);
+        }
+    });
+
+    return model.isOpen() ? &model : nullptr;
+}
+
+bool MarkovModel::open(const std::string &path)
+{
+    m_alias = nullptr;
+    m_weights = nullptr;
+    m_stateEntropy.clear();
+    m_stateCount = 0;
+    if (!m_file.open(path, MappedFile::Random) || m_file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    const int order = static_cast<int>(header.order);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || order < MIN_MARKOV_ORDER
+        || order > MAX_MARKOV_ORDER || header.stateCount != statesForOrder(order)
+        || header.totalWeight != TOTAL_WEIGHT
+        || m_file.size() != sizeof(Header) + header.stateCount * (COLUMNS * sizeof(AliasEntry)
+                                                                  + MARKOV_LETTERS * sizeof(uint32_t))) {
+        m_file.close();
+        return false;
+    }
+
+    const auto *alias = reinterpret_cast<const AliasEntry *>(m_file.data() + sizeof(Header));
+    const auto *weights = reinterpret_cast<const uint32_t *>(alias + header.stateCount * COLUMNS);
+
+    // Sampling must give exactly the stored weights, or the entropy shown
+    // would not be the entropy produced
+    std::vector<double> entropy(header.stateCount);
+    for (uint32_t state = 0; state < header.stateCount; ++state) {
+        uint64_t implied[COLUMNS] = {};
+        for (int column = 0; column < COLUMNS; ++column) {
+            const AliasEntry &entry = alias[state * COLUMNS + column];
+            if (entry.alias >= MARKOV_LETTERS || (column >= MARKOV_LETTERS && entry.threshold != 0)) {
+                m_file.close();
+                return false;
+            }
+            implied[column] += entry.threshold;
+            implied[entry.alias] += COLUMN_CAPACITY - entry.threshold;
+        }
+
+        double bits = 0.0;
+        for (int letter = 0; letter < MARKOV_LETTERS; ++letter) {
+            const uint32_t weight = weights[state * MARKOV_LETTERS + letter];
+            if (implied[letter] != weight) {
+                m_file.close();
+                return false;
+            }
+            if (weight > 0) {
+                const double p = static_cast<double>(weight) / TOTAL_WEIGHT;
+                bits -= p * std::log2(p);
+            }
+        }
+        entropy[state] = bits;
+    }
+
+    m_alias = alias;
+    m_weights = weights;
+    m_stateEntropy = std::move(entropy);
+    m_stateCount = header.stateCount;
+    m_order = order;
+    return true;
+}
+
+double MarkovModel::surprisal(std::string_view text) const
+{
+    if (!isOpen()) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    uint32_t state = startState();
+    double bits = 0.0;
+    for (char c : text) {
+        const int letter = c - 'a';
+        if (letter < 0 || letter >= MARKOV_LETTERS || weight(state, letter) == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        bits -= std::log2(static_cast<double>(weight(state, letter)) / TOTAL_WEIGHT);
+        state = nextState(state, letter);
+    }
+    return bits;
+}
+
+bool writeMarkovModel(const std::vector<std::string> &words, int order, const std::string &path,
+                      std::string *error)
+{
+    if (order < MIN_MARKOV_ORDER || order > MAX_MARKOV_ORDER) {
+        if (error) {
+            *error = "order must be " + std::to_string(MIN_MARKOV_ORDER) + "-" + std::to_string(MAX_MARKOV_ORDER);
+        }
+        return false;
+    }
+
+    // Letter counts after every context of each length up to order, so
+    // unseen contexts can back off to shorter ones
+    std::vector<std::vector<uint64_t>> counts(order + 1);
+    for (int o = 0; o <= order; ++o) {
+        counts[o].assign(static_cast<size_t>(statesForOrder(o)) * MARKOV_LETTERS, 0);
+    }
+
+    uint64_t letters = 0;
+    for (const std::string &word : words) {
+        std::vector<int> indexes;
+        for (char c : word) {
+            const char lower = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+            if (lower < 'a' || lower > 'z') {
+                indexes.clear();
+                break;
+            }
+            indexes.push_back(lower - 'a');
+        }
+
+        for (int o = 0; o <= order; ++o) {
+            const uint32_t states = statesForOrder(o);
+            uint32_t state = 0;
+            for (int letter : indexes) {
+                ++counts[o][static_cast<size_t>(state) * MARKOV_LETTERS + letter];
+                state = (state * (MARKOV_LETTERS + 1) + letter + 1) % states;
+            }
+        }
+        letters += indexes.size();
+    }
+
+    if (letters == 0) {
+        if (error) {
+            *error = "no usable words";
+        }
+        return false;
+    }
+
+    const uint32_t stateCount = statesForOrder(order);
+    std::vector<MarkovModel::AliasEntry> alias(static_cast<size_t>(stateCount) * MarkovModel::COLUMNS);
+    std::vector<uint32_t> weights(static_cast<size_t>(stateCount) * MARKOV_LETTERS);
+    for (uint32_t state = 0; state < stateCount; ++state) {
+        // The most recent letters are the low digits of a state
+        const uint64_t *source = nullptr;
+        for (int o = order; o >= 0 && !source; --o) {
+            const uint64_t *row = counts[o].data() + static_cast<size_t>(state % statesForOrder(o)) * MARKOV_LETTERS;
+            if (std::any_of(row, row + MARKOV_LETTERS, [](uint64_t n) { return n > 0; })) {
+                source = row;
+            }
+        }
+        quantize(source, weights.data() + static_cast<size_t>(state) * MARKOV_LETTERS);
+        buildAliasTable(weights.data() + static_cast<size_t>(state) * MARKOV_LETTERS,
+                        alias.data() + static_cast<size_t>(state) * MarkovModel::COLUMNS);
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.order = static_cast<uint32_t>(order);
+    header.stateCount = stateCount;
+    header.totalWeight = MarkovModel::TOTAL_WEIGHT;
+
+    FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        if (error) {
+            *error = "cannot open " + path + " for writing";
+        }
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+        && std::fwrite(alias.data(), sizeof(MarkovModel::AliasEntry), alias.size(), out) == alias.size()
+        && std::fwrite(weights.data(), sizeof(uint32_t), weights.size(), out) == weights.size();
+    ok = std::fclose(out) == 0 && ok;
+
+    if (!ok && error) {
+        *error = "write to " + path + " failed";
+    }
+    return ok;
+}
+
+} // namespace qenqey
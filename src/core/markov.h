@@ -0,0 +1,106 @@
+#ifndef QENQEY_CORE_MARKOV_H
+#define QENQEY_CORE_MARKOV_H
+
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qenqey {
+
+// Letters a..z; models produce nothing else
+constexpr int MARKOV_LETTERS = 26;
+
+constexpr int MIN_MARKOV_ORDER = 1;
+constexpr int MAX_MARKOV_ORDER = 3;
+constexpr int DEFAULT_MARKOV_ORDER = 2;
+
+// Letter n-gram model for pronounceable passwords, memory-mapped from a
+// .qqm index built by qenqey-index. A state is the last order() letters,
+// with a boundary symbol before the first one. Every state stores a
+// Walker alias table over the next letter, so a letter is one 32-bit
+// random draw, one load and one compare, and the integer weights the
+// table was built from, for exact entropy. Opening checks that each
+// table samples exactly its weights.
+class MarkovModel
+{
+public:
+    // Alias columns per state: a power of two, so the low bits of a
+    // draw pick one. Columns past the last letter only hold aliases.
+    static constexpr int COLUMN_BITS = 5;
+    static constexpr int COLUMNS = 1 << COLUMN_BITS;
+    static constexpr int THRESHOLD_BITS = 16;
+
+    // Weights of each state sum to this, one full column per column
+    static constexpr uint32_t TOTAL_WEIGHT = uint32_t(1) << (COLUMN_BITS + THRESHOLD_BITS);
+
+    struct AliasEntry
+    {
+        // The column keeps its own letter when the threshold bits of the
+        // draw fall below this, and gives alias otherwise
+        uint16_t threshold;
+        uint8_t alias;
+        uint8_t reserved;
+    };
+
+    MarkovModel() = default;
+
+    // Installed model, mapped on first call from $QENQEY_MARKOV or the
+    // data directories. nullptr when none is available.
+    static const MarkovModel *shared();
+
+    bool open(const std::string &path);
+    bool isOpen() const { return m_alias != nullptr; }
+
+    int order() const { return m_order; }
+    uint32_t stateCount() const { return m_stateCount; }
+
+    // Before the first letter every state symbol is the boundary
+    static constexpr uint32_t startState() { return 0; }
+
+    uint32_t nextState(uint32_t state, int letter) const
+    {
+        return (state * (MARKOV_LETTERS + 1) + static_cast<uint32_t>(letter) + 1) % m_stateCount;
+    }
+
+    // Letter index drawn from state with 21 bits of random
+    int draw(uint32_t state, uint32_t random) const
+    {
+        const uint32_t column = random & (COLUMNS - 1);
+        const AliasEntry &entry = m_alias[state * COLUMNS + column];
+        return ((random >> COLUMN_BITS) & ((1u << THRESHOLD_BITS) - 1)) < entry.threshold
+            ? static_cast<int>(column) : entry.alias;
+    }
+
+    // Probability of letter after state, times TOTAL_WEIGHT
+    uint32_t weight(uint32_t state, int letter) const { return m_weights[state * MARKOV_LETTERS + letter]; }
+
+    // Entropy of the next letter in state, in bits
+    double stateEntropy(uint32_t state) const { return m_stateEntropy[state]; }
+
+    // -log2 of the probability that the model writes text; infinity when
+    // it never would (other characters, or a letter it never follows
+    // with). For a generated password, its exact information content.
+    double surprisal(std::string_view text) const;
+
+private:
+    MappedFile m_file;
+    const AliasEntry *m_alias = nullptr;
+    const uint32_t *m_weights = nullptr;
+    std::vector<double> m_stateEntropy;
+    uint32_t m_stateCount = 0;
+    int m_order = 0;
+};
+
+// Trains a model of the given order on words and writes a .qqm index.
+// Words are folded to lower case; words with other characters are
+// skipped. States the words never continue borrow the distribution of
+// their shorter suffixes, down to single letter frequencies.
+bool writeMarkovModel(const std::vector<std::string> &words, int order, const std::string &path,
+                      std::string *error = nullptr);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_MARKOV_H
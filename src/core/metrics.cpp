@@ -0,0 +1,213 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <vector>
+
+namespace qenqey {
+
+std::atomic<bool> Metrics::s_enabled(false);
+
+namespace {
+
+// Written only by its own thread, so plain load and store suffice; the
+// atomics just make concurrent snapshots well-defined
+void bump(std::atomic<uint64_t> &value, uint64_t amount)
+{
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct Shard
+{
+    struct Timer
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS] = {};
+    };
+
+    std::atomic<uint64_t> counters[Metrics::COUNTER_COUNT] = {};
+    Timer timers[Metrics::TIMER_COUNT];
+
+    void addTo(Metrics::Snapshot &snapshot) const
+    {
+        for (int i = 0; i < Metrics::COUNTER_COUNT; ++i) {
+            snapshot.counters[i] += counters[i].load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < Metrics::TIMER_COUNT; ++i) {
+            LatencyHistogram &histogram = snapshot.timers[i];
+            histogram.count += timers[i].count.load(std::memory_order_relaxed);
+            histogram.totalNs += timers[i].totalNs.load(std::memory_order_relaxed);
+            histogram.maxNs = std::max(histogram.maxNs, timers[i].maxNs.load(std::memory_order_relaxed));
+            for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                histogram.buckets[b] += timers[i].buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<const Shard *> live;
+    Metrics::Snapshot retired;
+};
+
+Registry &registry()
+{
+    // Leaked so threads exiting during static destruction still find it
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+// Registers on a thread's first hook and folds its totals into the
+// retired ones when the thread exits
+class ThreadShard
+{
+public:
+    ThreadShard()
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(&m_shard);
+    }
+
+    ~ThreadShard()
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        m_shard.addTo(r.retired);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &m_shard));
+    }
+
+    Shard &shard() { return m_shard; }
+
+private:
+    Shard m_shard;
+};
+
+Shard &threadShard()
+{
+    thread_local ThreadShard shard;
+    return shard.shard();
+}
+
+int bucketFor(uint64_t nanoseconds)
+{
+    if (nanoseconds < 2) {
+        return 0;
+    }
+    return std::min(63 - __builtin_clzll(nanoseconds), HISTOGRAM_BUCKETS - 1);
+}
+
+} // namespace
+
+double LatencyHistogram::percentileNs(double fraction) const
+{
+    if (count == 0) {
+        return 0.0;
+    }
+    const double rank = fraction * static_cast<double>(count);
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (static_cast<double>(seen) >= rank && buckets[b] > 0) {
+            // Geometric middle of [2^b, 2^(b+1))
+            return std::min(std::ldexp(std::sqrt(2.0), b), static_cast<double>(maxNs));
+        }
+    }
+    return static_cast<double>(maxNs);
+}
+
+void Metrics::enable()
+{
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void Metrics::addSlow(Counter counter, uint64_t amount)
+{
+    bump(threadShard().counters[counter], amount);
+}
+
+void Metrics::record(Timer timer, uint64_t nanoseconds)
+{
+    Shard::Timer &t = threadShard().timers[timer];
+    bump(t.count, 1);
+    bump(t.totalNs, nanoseconds);
+    if (nanoseconds > t.maxNs.load(std::memory_order_relaxed)) {
+        t.maxNs.store(nanoseconds, std::memory_order_relaxed);
+    }
+    bump(t.buckets[bucketFor(nanoseconds)], 1);
+}
+
+Metrics::Snapshot Metrics::snapshot()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Snapshot snapshot = r.retired;
+    for (const Shard *shard : r.live) {
+        shard->addTo(snapshot);
+    }
+    return snapshot;
+}
+
+const char *Metrics::counterName(Counter counter)
+{
+    switch (counter) {
+    case Passwords: return "passwords";
+    case RandomBytes: return "random_bytes";
+    case RejectedSamples: return "rejected_samples";
+    case COUNTER_COUNT: break;
+    }
+    return "unknown";
+}
+
+const char *Metrics::timerName(Timer timer)
+{
+    switch (timer) {
+    case Generation: return "generation";
+    case StrengthScoring: return "strength_scoring";
+    case HistoryAppend: return "history_append";
+    case UiUpdate: return "ui_update";
+    case TIMER_COUNT: break;
+    }
+    return "unknown";
+}
+
+std::string Metrics::toJson(const Snapshot &snapshot)
+{
+    std::string json = "{\n  \"counters\": {";
+    char line[256];
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        std::snprintf(line, sizeof(line), "%s\n    \"%s\": %llu", i > 0 ? "," : "",
+                      counterName(static_cast<Counter>(i)),
+                      static_cast<unsigned long long>(snapshot.counters[i]));
+        json += line;
+    }
+    json += "\n  },\n  \"timers\": {";
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        const LatencyHistogram &h = snapshot.timers[i];
+        std::snprintf(line, sizeof(line),
+                      "%s\n    \"%s\": {\"count\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %.0f, "
+                      "\"p90_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %llu}",
+                      i > 0 ? "," : "", timerName(static_cast<Timer>(i)),
+                      static_cast<unsigned long long>(h.count), h.meanNs(), h.percentileNs(0.5),
+                      h.percentileNs(0.9), h.percentileNs(0.99), static_cast<unsigned long long>(h.maxNs));
+        json += line;
+    }
+    json += "\n  }\n}\n";
+    return json;
+}
+
+} // namespace qenqey
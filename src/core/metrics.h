@@ -0,0 +1,118 @@
+#ifndef QENQEY_CORE_METRICS_H
+#define QENQEY_CORE_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace qenqey {
+
+// Log2 buckets of nanoseconds: bucket i holds [2^i, 2^(i+1)), the last
+// one everything above
+constexpr int HISTOGRAM_BUCKETS = 40;
+
+struct LatencyHistogram
+{
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+
+    double meanNs() const { return count > 0 ? static_cast<double>(totalNs) / count : 0.0; }
+
+    // Estimated from the buckets, so accurate to within a factor of ~1.4
+    double percentileNs(double fraction) const;
+};
+
+// Counters and latency histograms for the hot paths. Off by default;
+// while off every hook is a single branch on a global flag. Each thread
+// writes its own shard, so hooks on parallel workers never contend.
+class Metrics
+{
+public:
+    enum Counter {
+        Passwords,
+        RandomBytes,
+        RejectedSamples,
+        COUNTER_COUNT,
+    };
+
+    enum Timer {
+        Generation,
+        StrengthScoring,
+        HistoryAppend,
+        UiUpdate,
+        TIMER_COUNT,
+    };
+
+    // Bulk paths time one password in this many; timing every one would
+    // cost about as much as generating it
+    static constexpr uint64_t SAMPLE_INTERVAL = 64;
+
+    struct Snapshot
+    {
+        uint64_t counters[COUNTER_COUNT] = {};
+        LatencyHistogram timers[TIMER_COUNT];
+    };
+
+    static void enable();
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static void add(Counter counter, uint64_t amount)
+    {
+        if (isEnabled()) {
+            addSlow(counter, amount);
+        }
+    }
+
+    // Timestamp to pass to stop(), or 0 when disabled
+    static uint64_t start() { return isEnabled() ? now() : 0; }
+
+    static void stop(Timer timer, uint64_t started)
+    {
+        if (started != 0) {
+            record(timer, now() - started);
+        }
+    }
+
+    static void record(Timer timer, uint64_t nanoseconds);
+
+    // Totals over all threads, including ones that have exited
+    static Snapshot snapshot();
+
+    static const char *counterName(Counter counter);
+    static const char *timerName(Timer timer);
+
+    // {"counters": {...}, "timers": {"generation": {"count": ..., ...}}}
+    static std::string toJson(const Snapshot &snapshot);
+
+private:
+    static uint64_t now();
+    static void addSlow(Counter counter, uint64_t amount);
+
+    static std::atomic<bool> s_enabled;
+};
+
+// Times the enclosing scope
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Metrics::Timer timer)
+        : m_timer(timer)
+        , m_started(Metrics::start())
+    {
+    }
+
+    ~ScopedTimer() { Metrics::stop(m_timer, m_started); }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Metrics::Timer m_timer;
+    uint64_t m_started;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_METRICS_H
@@ -0,0 +1,77 @@
+#include "output.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace qenqey {
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+OutputBuffer::OutputBuffer(int fd, size_t capacity)
+    : m_fd(fd)
+    , m_data(static_cast<char *>(std::malloc(capacity)))
+    , m_capacity(capacity)
+    , m_used(0)
+    , m_good(m_data != nullptr)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    flush();
+    std::free(m_data);
+}
+
+char *OutputBuffer::reserve(size_t size)
+{
+    if (m_capacity - m_used < size) {
+        flush();
+        if (size > m_capacity) {
+            char *grown = static_cast<char *>(std::realloc(m_data, size));
+            if (!grown) {
+                m_good = false;
+                return nullptr;
+            }
+            m_data = grown;
+            m_capacity = size;
+        }
+    }
+    return m_data + m_used;
+}
+
+void OutputBuffer::append(const char *data, size_t size)
+{
+    char *out = reserve(size);
+    if (out) {
+        std::memcpy(out, data, size);
+        commit(size);
+    }
+}
+
+bool OutputBuffer::flush()
+{
+    if (m_used > 0 && m_good) {
+        m_good = writeAll(m_fd, m_data, m_used);
+    }
+    m_used = 0;
+    return m_good;
+}
+
+} // namespace qenqey
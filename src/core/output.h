@@ -0,0 +1,42 @@
+#ifndef QENQEY_CORE_OUTPUT_H
+#define QENQEY_CORE_OUTPUT_H
+
+#include <cstddef>
+
+namespace qenqey {
+
+// Large write buffer over a raw file descriptor. Callers reserve space,
+// write into it directly and commit, so nothing is copied per password.
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(int fd, size_t capacity = 1 << 20);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    // Returns a pointer with at least size bytes available
+    char *reserve(size_t size);
+    void commit(size_t size) { m_used += size; }
+
+    void append(const char *data, size_t size);
+    bool flush();
+
+    // False once any write to the descriptor has failed
+    bool isGood() const { return m_good; }
+
+private:
+    int m_fd;
+    char *m_data;
+    size_t m_capacity;
+    size_t m_used;
+    bool m_good;
+};
+
+// Writes the whole range, retrying on short writes and EINTR
+bool writeAll(int fd, const char *data, size_t size);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_OUTPUT_H
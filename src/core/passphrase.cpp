@@ -0,0 +1,67 @@
+#include "passphrase.h"
+#include "random.h"
+#include "wordlist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace qenqey {
+
+static_assert(MAX_PASSPHRASE_WORDS * (Wordlist::MAX_WORD_BYTES + 1) <= MAX_OUTPUT_BYTES,
+              "the longest passphrase must fit the output buffers");
+
+PassphrasePlan::PassphrasePlan()
+    : PassphrasePlan(nullptr, PassphraseSettings())
+{
+}
+
+PassphrasePlan::PassphrasePlan(const Wordlist *wordlist, const PassphraseSettings &settings)
+    : m_wordlist(nullptr)
+    , m_settings(settings)
+    , m_count(0)
+    , m_threshold(0)
+{
+    m_settings.words = std::clamp(settings.words, MIN_PASSPHRASE_WORDS, MAX_PASSPHRASE_WORDS);
+    if (!wordlist || wordlist->size() == 0 || settings.separator == '\0'
+        || !std::strchr(PASSPHRASE_SEPARATORS, settings.separator)) {
+        return;
+    }
+
+    m_wordlist = wordlist;
+    m_count = static_cast<uint32_t>(wordlist->size());
+    m_threshold = -m_count % m_count;
+}
+
+size_t PassphrasePlan::maxLength() const
+{
+    if (!m_wordlist) {
+        return 0;
+    }
+    return m_settings.words * (m_wordlist->maxWordBytes() + 1) - 1;
+}
+
+size_t PassphrasePlan::generate(RandomStream &random, char *out) const
+{
+    char *p = out;
+    for (int i = 0; i < m_settings.words; ++i) {
+        if (i > 0) {
+            *p++ = m_settings.separator;
+        }
+
+        const std::string_view word = m_wordlist->word(random.bounded(m_count, m_threshold));
+        std::memcpy(p, word.data(), word.size());
+        if (m_settings.capitalize && *p >= 'a' && *p <= 'z') {
+            *p = static_cast<char>(*p - 'a' + 'A');
+        }
+        p += word.size();
+    }
+    return static_cast<size_t>(p - out);
+}
+
+double PassphrasePlan::entropyBits() const
+{
+    return m_wordlist ? m_settings.words * std::log2(static_cast<double>(m_count)) : 0.0;
+}
+
+} // namespace qenqey
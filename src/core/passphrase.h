@@ -0,0 +1,43 @@
+#ifndef QENQEY_CORE_PASSPHRASE_H
+#define QENQEY_CORE_PASSPHRASE_H
+
+#include "settings.h"
+#include "source.h"
+
+#include <cstdint>
+
+namespace qenqey {
+
+class Wordlist;
+
+// Diceware-style passphrase: words() words drawn uniformly and
+// independently from a Wordlist, joined by a separator. The wordlist must
+// outlive the plan.
+class PassphrasePlan : public PasswordSource
+{
+public:
+    PassphrasePlan();
+    PassphrasePlan(const Wordlist *wordlist, const PassphraseSettings &settings);
+
+    // False without a wordlist or with a separator outside
+    // PASSPHRASE_SEPARATORS
+    bool isValid() const override { return m_wordlist != nullptr; }
+    size_t maxLength() const override;
+    size_t generate(RandomStream &random, char *out) const override;
+
+    // Exact: words * log2(wordlist size), as all words are distinct and
+    // the separator never occurs inside one
+    double entropyBits() const override;
+
+    const PassphraseSettings &settings() const { return m_settings; }
+
+private:
+    const Wordlist *m_wordlist;
+    PassphraseSettings m_settings;
+    uint32_t m_count;
+    uint32_t m_threshold;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_PASSPHRASE_H
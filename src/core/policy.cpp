@@ -0,0 +1,185 @@
+#include "policy.h"
+#include "charsetplan.h"
+#include "constrained.h"
+#include "markov.h"
+#include "passphrase.h"
+#include "pronounceable.h"
+#include "template.h"
+#include "token.h"
+#include "wordlist.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace qenqey {
+
+namespace {
+
+bool parseInt(std::string_view text, int low, int high, int &value)
+{
+    int parsed = 0;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size() || parsed < low || parsed > high) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parseFlag(std::string_view text, bool &value)
+{
+    if (text == "1" || text == "yes") {
+        value = true;
+        return true;
+    }
+    if (text == "0" || text == "no") {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+bool parseClassLetters(std::string_view text, unsigned &classes)
+{
+    classes = 0;
+    for (char c : text) {
+        switch (c) {
+        case 'u': classes |= Uppercase; break;
+        case 'l': classes |= Lowercase; break;
+        case 'd': classes |= Numbers; break;
+        case 's': classes |= Symbols; break;
+        default: return false;
+        }
+    }
+    return classes != 0;
+}
+
+} // namespace
+
+bool parsePolicy(std::string_view text, Policy &policy, std::string *error)
+{
+    auto fail = [&](std::string_view token) {
+        if (error) {
+            *error = "bad policy token '" + std::string(token) + "'";
+        }
+        return false;
+    };
+
+    size_t position = 0;
+    while (position < text.size()) {
+        if (text[position] == ' ') {
+            ++position;
+            continue;
+        }
+        size_t end = text.find(' ', position);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        const std::string_view token = text.substr(position, end - position);
+        position = end;
+
+        const size_t eq = token.find('=');
+        if (eq == std::string_view::npos) {
+            return fail(token);
+        }
+        const std::string_view key = token.substr(0, eq);
+        const std::string_view value = token.substr(eq + 1);
+
+        bool ok = true;
+        if (key == "len") {
+            ok = parseInt(value, MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH, policy.characters.length);
+        } else if (key == "classes") {
+            ok = parseClassLetters(value, policy.characters.classes);
+        } else if (key == "similar") {
+            bool allowed = true;
+            ok = parseFlag(value, allowed);
+            policy.characters.excludeSimilar = !allowed;
+        } else if (key == "min") {
+            ok = parseClassMinimums(value, policy.rules);
+        } else if (key == "repeat") {
+            ok = parseInt(value, 0, MAX_RULE_RUN, policy.rules.maxRepeat);
+        } else if (key == "seq") {
+            ok = parseInt(value, 0, MAX_RULE_RUN, policy.rules.maxSequence);
+        } else if (key == "nofirst") {
+            ok = !value.empty();
+            policy.rules.bannedFirst = std::string(value);
+        } else if (key == "words") {
+            ok = parseInt(value, MIN_PASSPHRASE_WORDS, MAX_PASSPHRASE_WORDS, policy.passphrase.words);
+            policy.mode = Policy::Mode::Passphrase;
+        } else if (key == "sep") {
+            const char separator = value == "space" ? ' ' : (value.size() == 1 ? value[0] : '\0');
+            ok = separator != '\0' && std::strchr(PASSPHRASE_SEPARATORS, separator);
+            policy.passphrase.separator = separator;
+            policy.mode = Policy::Mode::Passphrase;
+        } else if (key == "cap") {
+            ok = parseFlag(value, policy.passphrase.capitalize);
+            policy.mode = Policy::Mode::Passphrase;
+        } else if (key == "pron") {
+            ok = parseInt(value, MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH, policy.pronounceable.length);
+            policy.mode = Policy::Mode::Pronounceable;
+        } else if (key == "token") {
+            ok = parseTokenEncoding(value, policy.token.encoding);
+            policy.mode = Policy::Mode::Token;
+        } else if (key == "bytes") {
+            ok = parseInt(value, MIN_TOKEN_BYTES, MAX_TOKEN_BYTES, policy.token.bytes);
+            policy.mode = Policy::Mode::Token;
+        } else if (key == "tpl") {
+            ok = !value.empty();
+            policy.pattern = std::string(value);
+            policy.mode = Policy::Mode::Template;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            return fail(token);
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<PasswordSource> makeSource(const Policy &policy, const Wordlist *wordlist,
+                                           std::string *error)
+{
+    std::unique_ptr<PasswordSource> source;
+    const char *reason = "invalid policy";
+    switch (policy.mode) {
+    case Policy::Mode::Characters:
+        if (policy.rules.isDefault()) {
+            source = std::make_unique<CharsetPlan>(policy.characters);
+            reason = "no character classes";
+        } else {
+            auto plan = std::make_unique<ConstrainedPlan>(policy.characters, policy.rules);
+            reason = ruleErrorText(plan->error());
+            source = std::move(plan);
+        }
+        break;
+    case Policy::Mode::Passphrase:
+        source = std::make_unique<PassphrasePlan>(wordlist, policy.passphrase);
+        reason = "no wordlist installed";
+        break;
+    case Policy::Mode::Template: {
+        auto plan = std::make_unique<TemplatePlan>(policy.pattern, wordlist);
+        reason = templateErrorText(plan->error());
+        source = std::move(plan);
+        break;
+    }
+    case Policy::Mode::Pronounceable:
+        source = std::make_unique<PronounceablePlan>(MarkovModel::shared(), policy.pronounceable);
+        reason = "no letter model installed";
+        break;
+    case Policy::Mode::Token:
+        source = std::make_unique<TokenPlan>(policy.token);
+        break;
+    }
+
+    if (!source || !source->isValid()) {
+        if (error) {
+            *error = reason;
+        }
+        return nullptr;
+    }
+    return source;
+}
+
+} // namespace qenqey
@@ -0,0 +1,63 @@
+#ifndef QENQEY_CORE_POLICY_H
+#define QENQEY_CORE_POLICY_H
+
+#include "constrained.h"
+#include "settings.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace qenqey {
+
+class PasswordSource;
+class Wordlist;
+
+// Everything that selects a generation mode and its settings, in the
+// compact space-separated form used by the daemon protocol:
+//
+//   len=20 classes=ulds similar=0        characters (the default mode)
+//   words=6 sep=- cap=1                  passphrase; sep=space for ' '
+//   tpl=Aaaa-9999-ssss                   template, see template.h; the
+//                                        pattern cannot contain spaces
+//   min=u2,d3 repeat=2 seq=2 nofirst=0!  character rules, see
+//                                        constrained.h
+//   pron=20                              pronounceable, 20 letters
+//   token=base64url bytes=32             token: hex, base64url, base32,
+//                                        crockford or uuid
+//
+// similar=0 excludes look-alike characters (il1Lo0O). Omitted keys keep
+// their defaults.
+struct Policy
+{
+    enum class Mode {
+        Characters,
+        Passphrase,
+        Template,
+        Pronounceable,
+        Token,
+    };
+
+    Mode mode = Mode::Characters;
+    GeneratorSettings characters;
+    CharacterRules rules;
+    PassphraseSettings passphrase;
+    std::string pattern;
+    PronounceableSettings pronounceable;
+    TokenSettings token;
+};
+
+bool parsePolicy(std::string_view text, Policy &policy, std::string *error = nullptr);
+
+// Compiled source for the policy; nullptr, with an English reason in
+// error, when it cannot generate (no classes, no wordlist, bad template,
+// rules nothing satisfies, no letter model). Pronounceable passwords use
+// the shared MarkovModel.
+// Passphrases and templates with words use wordlist, which must outlive
+// the source.
+std::unique_ptr<PasswordSource> makeSource(const Policy &policy, const Wordlist *wordlist,
+                                           std::string *error = nullptr);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_POLICY_H
@@ -0,0 +1,60 @@
+#include "pronounceable.h"
+#include "markov.h"
+#include "random.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace qenqey {
+
+PronounceablePlan::PronounceablePlan()
+    : PronounceablePlan(nullptr, PronounceableSettings())
+{
+}
+
+PronounceablePlan::PronounceablePlan(const MarkovModel *model, const PronounceableSettings &settings)
+    : m_model(model && model->isOpen() ? model : nullptr)
+    , m_settings(settings)
+    , m_entropy(0.0)
+{
+    m_settings.length = std::clamp(settings.length, MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+    if (!m_model) {
+        return;
+    }
+
+    // The entropy of each letter given the ones before it, averaged over
+    // where the model can be by then; the chain rule sums them exactly
+    const uint32_t states = m_model->stateCount();
+    std::vector<double> probability(states, 0.0);
+    std::vector<double> next(states);
+    probability[MarkovModel::startState()] = 1.0;
+    for (int position = 0; position < m_settings.length; ++position) {
+        std::fill(next.begin(), next.end(), 0.0);
+        for (uint32_t state = 0; state < states; ++state) {
+            const double p = probability[state];
+            if (p == 0.0) {
+                continue;
+            }
+            m_entropy += p * m_model->stateEntropy(state);
+            for (int letter = 0; letter < MARKOV_LETTERS; ++letter) {
+                if (const uint32_t weight = m_model->weight(state, letter)) {
+                    next[m_model->nextState(state, letter)] += p * weight / MarkovModel::TOTAL_WEIGHT;
+                }
+            }
+        }
+        probability.swap(next);
+    }
+}
+
+size_t PronounceablePlan::generate(RandomStream &random, char *out) const
+{
+    uint32_t state = MarkovModel::startState();
+    for (int i = 0; i < m_settings.length; ++i) {
+        const int letter = m_model->draw(state, random.next32());
+        out[i] = static_cast<char>('a' + letter);
+        state = m_model->nextState(state, letter);
+    }
+    return static_cast<size_t>(m_settings.length);
+}
+
+} // namespace qenqey
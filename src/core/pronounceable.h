@@ -0,0 +1,39 @@
+#ifndef QENQEY_CORE_PRONOUNCEABLE_H
+#define QENQEY_CORE_PRONOUNCEABLE_H
+
+#include "settings.h"
+#include "source.h"
+
+namespace qenqey {
+
+class MarkovModel;
+
+// Pronounceable password: length() lower-case letters, each drawn from a
+// MarkovModel given the letters before it. Letters are not uniform, so
+// entropyBits() is the exact Shannon entropy of the whole password, and
+// a particular password carries MarkovModel::surprisal() bits. The model
+// must outlive the plan.
+class PronounceablePlan : public PasswordSource
+{
+public:
+    PronounceablePlan();
+    PronounceablePlan(const MarkovModel *model, const PronounceableSettings &settings);
+
+    // False without a model
+    bool isValid() const override { return m_model != nullptr; }
+    size_t maxLength() const override { return static_cast<size_t>(m_settings.length); }
+    size_t generate(RandomStream &random, char *out) const override;
+    double entropyBits() const override { return m_entropy; }
+
+    const PronounceableSettings &settings() const { return m_settings; }
+    const MarkovModel *model() const { return m_model; }
+
+private:
+    const MarkovModel *m_model;
+    PronounceableSettings m_settings;
+    double m_entropy;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_PRONOUNCEABLE_H
@@ -0,0 +1,133 @@
+#include "random.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/random.h>
+#include <unistd.h>
+
+namespace qenqey {
+
+void systemEntropy(void *buffer, size_t size)
+{
+    auto *out = static_cast<unsigned char *>(buffer);
+    while (size > 0) {
+        ssize_t got = getrandom(out, size, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("getrandom() failed");
+        }
+        out += got;
+        size -= static_cast<size_t>(got);
+    }
+}
+
+RandomStream::RandomStream()
+    : m_buffer(m_block + CHACHA20_KEY_SIZE)
+    , m_position(BUFFER_SIZE)
+    , m_refillsSinceSeed(0)
+    , m_pid(::getpid())
+{
+    systemEntropy(m_key, sizeof(m_key));
+}
+
+RandomStream::~RandomStream()
+{
+    explicit_bzero(m_block, sizeof(m_block));
+    explicit_bzero(m_key, sizeof(m_key));
+}
+
+RandomStream &RandomStream::forThread()
+{
+    thread_local RandomStream stream;
+    return stream;
+}
+
+void RandomStream::reseed()
+{
+    uint8_t fresh[CHACHA20_KEY_SIZE];
+    systemEntropy(fresh, sizeof(fresh));
+    for (size_t i = 0; i < sizeof(m_key); ++i) {
+        m_key[i] ^= fresh[i];
+    }
+    explicit_bzero(fresh, sizeof(fresh));
+    m_refillsSinceSeed = 0;
+}
+
+void RandomStream::refill()
+{
+    // A forked child must not replay the parent's stream
+    long pid = ::getpid();
+    if (pid != m_pid || m_refillsSinceSeed >= RESEED_INTERVAL) {
+        m_pid = pid;
+        reseed();
+    }
+
+    chacha20Keystream(m_key, 0, 0, m_block, REFILL_BLOCKS);
+    std::memcpy(m_key, m_block, CHACHA20_KEY_SIZE);
+    explicit_bzero(m_block, CHACHA20_KEY_SIZE);
+
+    m_position = 0;
+    ++m_refillsSinceSeed;
+
+    // Counted per refill: a stream is only refilled once it has used up
+    // the previous buffer, so this trails consumption by at most one
+    Metrics::add(Metrics::RandomBytes, BUFFER_SIZE);
+}
+
+void RandomStream::fill(void *buffer, size_t size)
+{
+    auto *out = static_cast<unsigned char *>(buffer);
+    while (size > 0) {
+        if (m_position == BUFFER_SIZE) {
+            refill();
+        }
+        size_t chunk = BUFFER_SIZE - m_position;
+        if (chunk > size) {
+            chunk = size;
+        }
+        std::memcpy(out, m_buffer + m_position, chunk);
+        m_position += chunk;
+        out += chunk;
+        size -= chunk;
+    }
+}
+
+uint32_t RandomStream::next32()
+{
+    if (BUFFER_SIZE - m_position < sizeof(uint32_t)) {
+        refill();
+    }
+    uint32_t value;
+    std::memcpy(&value, m_buffer + m_position, sizeof(value));
+    m_position += sizeof(value);
+    return value;
+}
+
+void RandomStream::sampleBytes(uint32_t limit, const char *map, char *out, size_t count)
+{
+    while (count > 0) {
+        if (m_position == BUFFER_SIZE) {
+            refill();
+        }
+
+        const uint8_t *p = m_buffer + m_position;
+        const uint8_t *end = m_buffer + BUFFER_SIZE;
+        const size_t wanted = count;
+        while (p < end && count > 0) {
+            uint32_t b = *p++;
+            if (b < limit) {
+                *out++ = map[b];
+                --count;
+            }
+        }
+        const size_t used = static_cast<size_t>(p - m_buffer) - m_position;
+        Metrics::add(Metrics::RejectedSamples, used - (wanted - count));
+        m_position = static_cast<size_t>(p - m_buffer);
+    }
+}
+
+} // namespace qenqey
@@ -0,0 +1,85 @@
+#ifndef QENQEY_CORE_RANDOM_H
+#define QENQEY_CORE_RANDOM_H
+
+#include "chacha20.h"
+#include "metrics.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace qenqey {
+
+// Buffered CSPRNG: a ChaCha20 keystream keyed from getrandom() and
+// generated a few hundred blocks at a time. Every refill takes the next
+// key from the keystream itself (fast key erasure), and fresh kernel
+// entropy is mixed in periodically and after fork().
+//
+// Not thread-safe; use forThread() to get an independent stream per
+// thread.
+class RandomStream
+{
+public:
+    RandomStream();
+    ~RandomStream();
+
+    RandomStream(const RandomStream &) = delete;
+    RandomStream &operator=(const RandomStream &) = delete;
+
+    // Stream owned by the calling thread
+    static RandomStream &forThread();
+
+    void fill(void *buffer, size_t size);
+    uint32_t next32();
+
+    uint8_t nextByte()
+    {
+        if (m_position == BUFFER_SIZE) {
+            refill();
+        }
+        return m_buffer[m_position++];
+    }
+
+    // Uniform value in [0, bound), bound must be > 0
+    uint32_t bounded(uint32_t bound) { return bounded(bound, -bound % bound); }
+
+    // Same, with the rejection threshold (-bound % bound) precomputed
+    uint32_t bounded(uint32_t bound, uint32_t threshold)
+    {
+        // Lemire's multiply-and-reject: unbiased without a division
+        uint64_t m = static_cast<uint64_t>(next32()) * bound;
+        while (static_cast<uint32_t>(m) < threshold) {
+            Metrics::add(Metrics::RejectedSamples, 1);
+            m = static_cast<uint64_t>(next32()) * bound;
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // Writes count values map[b] for random bytes b, rejecting b >= limit.
+    // Runs straight over the buffered keystream, so most outputs cost a
+    // load, a compare and a store.
+    void sampleBytes(uint32_t limit, const char *map, char *out, size_t count);
+
+private:
+    void refill();
+    void reseed();
+
+    static constexpr size_t REFILL_BLOCKS = 256;
+    static constexpr size_t BUFFER_SIZE = REFILL_BLOCKS * CHACHA20_BLOCK_SIZE - CHACHA20_KEY_SIZE;
+    static constexpr unsigned RESEED_INTERVAL = 64;
+
+    // Keystream output: the first CHACHA20_KEY_SIZE bytes become the next
+    // key, the rest is handed out
+    uint8_t m_block[CHACHA20_KEY_SIZE + BUFFER_SIZE];
+    uint8_t *const m_buffer;
+    size_t m_position;
+    uint8_t m_key[CHACHA20_KEY_SIZE];
+    unsigned m_refillsSinceSeed;
+    long m_pid;
+};
+
+// Reads directly from the kernel entropy source, bypassing any buffering
+void systemEntropy(void *buffer, size_t size);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_RANDOM_H
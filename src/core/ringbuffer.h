@@ -0,0 +1,113 @@
+#ifndef QENQEY_CORE_RINGBUFFER_H
+#define QENQEY_CORE_RINGBUFFER_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace qenqey {
+
+// Fixed-capacity FIFO that overwrites its oldest element when full.
+// Storage grows on demand up to the capacity and never beyond it.
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity)
+        : m_start(0)
+        , m_size(0)
+        , m_capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool isEmpty() const { return m_size == 0; }
+    bool isFull() const { return m_size == m_capacity; }
+
+    // Index 0 is the oldest element
+    const T &at(size_t index) const { return m_items[(m_start + index) % m_capacity]; }
+
+    void push(T value)
+    {
+        if (m_size == m_capacity) {
+            m_items[m_start] = std::move(value);
+            m_start = (m_start + 1) % m_capacity;
+        } else if (m_items.size() < m_capacity) {
+            // Until storage reaches the capacity it is contiguous from 0
+            m_items.push_back(std::move(value));
+            ++m_size;
+        } else {
+            m_items[(m_start + m_size) % m_capacity] = std::move(value);
+            ++m_size;
+        }
+    }
+
+    // Inserts before the oldest element, for loading older items on
+    // demand. Does nothing when full. Storage is grown to the full
+    // capacity first, so this is O(1) from then on.
+    void pushFront(T value)
+    {
+        if (m_size == m_capacity) {
+            return;
+        }
+        if (m_items.size() < m_capacity) {
+            m_items.resize(m_capacity);
+        }
+        m_start = (m_start + m_capacity - 1) % m_capacity;
+        m_items[m_start] = std::move(value);
+        ++m_size;
+    }
+
+    // Drops the oldest element; O(1) once storage has reached capacity
+    void popFront()
+    {
+        if (m_size == 0) {
+            return;
+        }
+        if (m_items.size() < m_capacity) {
+            m_items.erase(m_items.begin());
+        } else {
+            m_items[m_start] = T();
+            m_start = (m_start + 1) % m_capacity;
+        }
+        --m_size;
+    }
+
+    void clear()
+    {
+        std::vector<T>().swap(m_items);
+        m_start = 0;
+        m_size = 0;
+    }
+
+    // Keeps the newest elements that still fit
+    void setCapacity(size_t capacity)
+    {
+        if (capacity == 0) {
+            capacity = 1;
+        }
+
+        const size_t keep = m_size < capacity ? m_size : capacity;
+        std::vector<T> items;
+        items.reserve(keep);
+        for (size_t i = m_size - keep; i < m_size; ++i) {
+            items.push_back(std::move(m_items[(m_start + i) % m_capacity]));
+        }
+
+        m_items.swap(items);
+        m_start = 0;
+        m_size = keep;
+        m_capacity = capacity;
+    }
+
+private:
+    std::vector<T> m_items;
+    size_t m_start;
+    size_t m_size;
+    size_t m_capacity;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_RINGBUFFER_H
@@ -0,0 +1,124 @@
+#include "securememory.h"
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace qenqey {
+
+namespace {
+
+size_t roundToPages(size_t size)
+{
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (size + page - 1) / page * page;
+}
+
+} // namespace
+
+SecureArena::SecureArena(size_t capacity)
+    : m_data(nullptr)
+    , m_capacity(0)
+    , m_used(0)
+    , m_locked(false)
+{
+    const size_t size = roundToPages(capacity > 0 ? capacity : 1);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return;
+    }
+
+    m_data = static_cast<char *>(data);
+    m_capacity = size;
+    m_locked = mlock(m_data, m_capacity) == 0;
+#ifdef MADV_DONTDUMP
+    madvise(m_data, m_capacity, MADV_DONTDUMP);
+#endif
+#ifdef MADV_WIPEONFORK
+    madvise(m_data, m_capacity, MADV_WIPEONFORK);
+#endif
+}
+
+SecureArena::~SecureArena()
+{
+    if (!m_data) {
+        return;
+    }
+    explicit_bzero(m_data, m_used);
+    if (m_locked) {
+        munlock(m_data, m_capacity);
+    }
+    munmap(m_data, m_capacity);
+}
+
+char *SecureArena::allocate(size_t size, size_t alignment)
+{
+    if (!m_data) {
+        return nullptr;
+    }
+
+    const size_t start = (m_used + alignment - 1) / alignment * alignment;
+    if (start > m_capacity || size > m_capacity - start) {
+        return nullptr;
+    }
+    m_used = start + size;
+    return m_data + start;
+}
+
+void SecureArena::reset()
+{
+    if (m_data) {
+        explicit_bzero(m_data, m_used);
+    }
+    m_used = 0;
+}
+
+SecurePool::SecurePool(size_t slotSize, size_t slotsPerArena)
+    : m_slotSize(slotSize > 0 ? slotSize : 1)
+    , m_slotsPerArena(slotsPerArena > 0 ? slotsPerArena : 1)
+{
+}
+
+char *SecurePool::allocate()
+{
+    if (!m_free.empty()) {
+        char *slot = m_free.back();
+        m_free.pop_back();
+        return slot;
+    }
+
+    if (!m_arenas.empty()) {
+        if (char *slot = m_arenas.back()->allocate(m_slotSize)) {
+            return slot;
+        }
+    }
+
+    m_arenas.push_back(std::make_unique<SecureArena>(m_slotSize * m_slotsPerArena));
+    return m_arenas.back()->allocate(m_slotSize);
+}
+
+void SecurePool::release(char *slot)
+{
+    if (!slot) {
+        return;
+    }
+    explicit_bzero(slot, m_slotSize);
+    m_free.push_back(slot);
+}
+
+void SecurePool::reset()
+{
+    m_free.clear();
+    if (!m_arenas.empty()) {
+        m_arenas.resize(1);
+        m_arenas.front()->reset();
+    }
+}
+
+void secureZero(void *data, size_t size)
+{
+    explicit_bzero(data, size);
+}
+
+} // namespace qenqey
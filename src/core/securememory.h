@@ -0,0 +1,76 @@
+#ifndef QENQEY_CORE_SECUREMEMORY_H
+#define QENQEY_CORE_SECUREMEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace qenqey {
+
+// Bump allocator over its own anonymous mapping for secret data. The
+// pages are mlock'ed (kept out of swap) where RLIMIT_MEMLOCK allows,
+// excluded from core dumps and not inherited by fork()ed children.
+// reset() and destruction zero everything handed out, so releasing a
+// whole batch of passwords is one explicit_bzero rather than a free per
+// password.
+class SecureArena
+{
+public:
+    explicit SecureArena(size_t capacity);
+    ~SecureArena();
+
+    SecureArena(const SecureArena &) = delete;
+    SecureArena &operator=(const SecureArena &) = delete;
+
+    // nullptr when the arena is exhausted or could not be mapped
+    char *allocate(size_t size, size_t alignment = 1);
+
+    // Zeroes and releases every allocation at once
+    void reset();
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+
+    // False when mlock() was refused; the memory is still wiped
+    bool isLocked() const { return m_locked; }
+
+private:
+    char *m_data;
+    size_t m_capacity;
+    size_t m_used;
+    bool m_locked;
+};
+
+// Fixed-size slots carved out of a growing list of SecureArenas. A slot
+// is wiped as soon as it is released and reused before any new memory is
+// mapped.
+class SecurePool
+{
+public:
+    explicit SecurePool(size_t slotSize, size_t slotsPerArena = 128);
+
+    SecurePool(const SecurePool &) = delete;
+    SecurePool &operator=(const SecurePool &) = delete;
+
+    size_t slotSize() const { return m_slotSize; }
+
+    // nullptr only if a new arena cannot be mapped
+    char *allocate();
+    void release(char *slot);
+
+    // Wipes all slots and unmaps all but the first arena
+    void reset();
+
+private:
+    size_t m_slotSize;
+    size_t m_slotsPerArena;
+    std::vector<std::unique_ptr<SecureArena>> m_arenas;
+    std::vector<char *> m_free;
+};
+
+// explicit_bzero for callers that cannot include <string.h> extensions
+void secureZero(void *data, size_t size);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_SECUREMEMORY_H
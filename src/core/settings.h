@@ -0,0 +1,66 @@
+#ifndef QENQEY_CORE_SETTINGS_H
+#define QENQEY_CORE_SETTINGS_H
+
+#include "charset.h"
+
+#include <cstddef>
+
+namespace qenqey {
+
+constexpr int MIN_PASSWORD_LENGTH = 4;
+constexpr int MAX_PASSWORD_LENGTH = 128;
+
+// Upper bound on any generation mode's output, in bytes
+constexpr size_t MAX_OUTPUT_BYTES = 512;
+
+constexpr int MIN_PASSPHRASE_WORDS = 2;
+constexpr int MAX_PASSPHRASE_WORDS = 12;
+
+// Random bytes behind a token; the largest still fits MAX_OUTPUT_BYTES
+// in hex
+constexpr int MIN_TOKEN_BYTES = 8;
+constexpr int MAX_TOKEN_BYTES = 128;
+
+struct GeneratorSettings
+{
+    int length = 16;
+    unsigned classes = Uppercase | Lowercase | Numbers;
+    bool excludeSimilar = false;
+};
+
+struct PassphraseSettings
+{
+    int words = 6;
+    char separator = '-';
+
+    // Upper-cases the first letter of each word. Deterministic, so it adds
+    // no entropy; it only satisfies sites that demand capitals.
+    bool capitalize = false;
+};
+
+struct PronounceableSettings
+{
+    // Letters, within MIN_PASSWORD_LENGTH..MAX_PASSWORD_LENGTH. Letters
+    // carry about three bits each, so the default is longer than for
+    // character passwords.
+    int length = 20;
+};
+
+enum class TokenEncoding {
+    Hex,
+    Base64Url,
+    Base32,
+    Crockford,
+    // Random (version 4) UUID; always 16 bytes, 122 of the bits random
+    Uuid,
+};
+
+struct TokenSettings
+{
+    TokenEncoding encoding = TokenEncoding::Hex;
+    int bytes = 32;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_SETTINGS_H
@@ -0,0 +1,90 @@
+#include "sha1.h"
+
+#include <cstring>
+
+namespace qenqey {
+
+namespace {
+
+inline uint32_t rotl(uint32_t v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+void compress(uint32_t state[5], const uint8_t block[64])
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16
+            | uint32_t(block[4 * i + 2]) << 8 | uint32_t(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 80; ++i) {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    auto round = [&](uint32_t f, uint32_t k, uint32_t word) {
+        const uint32_t t = rotl(a, 5) + f + e + k + word;
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = t;
+    };
+
+    // Four separate loops so the compiler can unroll each without a
+    // per-round branch on the round function
+    for (int i = 0; i < 20; ++i) {
+        round((b & c) | (~b & d), 0x5a827999, w[i]);
+    }
+    for (int i = 20; i < 40; ++i) {
+        round(b ^ c ^ d, 0x6ed9eba1, w[i]);
+    }
+    for (int i = 40; i < 60; ++i) {
+        round((b & c) | (b & d) | (c & d), 0x8f1bbcdc, w[i]);
+    }
+    for (int i = 60; i < 80; ++i) {
+        round(b ^ c ^ d, 0xca62c1d6, w[i]);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+} // namespace
+
+void sha1(const void *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    const auto *p = static_cast<const uint8_t *>(data);
+    const uint64_t bitLength = uint64_t(size) * 8;
+
+    for (; size >= 64; size -= 64, p += 64) {
+        compress(state, p);
+    }
+
+    // Final block(s): remaining bytes, 0x80, zero padding, bit length
+    uint8_t tail[128] = {};
+    std::memcpy(tail, p, size);
+    tail[size] = 0x80;
+    const size_t tailSize = size + 1 + 8 <= 64 ? 64 : 128;
+    for (int i = 0; i < 8; ++i) {
+        tail[tailSize - 1 - i] = uint8_t(bitLength >> (8 * i));
+    }
+    compress(state, tail);
+    if (tailSize == 128) {
+        compress(state, tail + 64);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        digest[4 * i] = uint8_t(state[i] >> 24);
+        digest[4 * i + 1] = uint8_t(state[i] >> 16);
+        digest[4 * i + 2] = uint8_t(state[i] >> 8);
+        digest[4 * i + 3] = uint8_t(state[i]);
+    }
+}
+
+} // namespace qenqey
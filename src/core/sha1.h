@@ -0,0 +1,17 @@
+#ifndef QENQEY_CORE_SHA1_H
+#define QENQEY_CORE_SHA1_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace qenqey {
+
+constexpr size_t SHA1_DIGEST_SIZE = 20;
+
+// SHA-1, only for matching against breach corpora that are published as
+// SHA-1 hashes. Not for anything security-sensitive.
+void sha1(const void *data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_SHA1_H
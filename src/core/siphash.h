@@ -0,0 +1,78 @@
+#ifndef QENQEY_CORE_SIPHASH_H
+#define QENQEY_CORE_SIPHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace qenqey {
+
+namespace detail {
+
+inline uint64_t rotl(uint64_t x, int b)
+{
+    return (x << b) | (x >> (64 - b));
+}
+
+inline void sipRound(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3)
+{
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+template <int C, int D>
+uint64_t sipHash(const uint64_t key[2], const char *data, size_t size)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+
+    const char *const end = data + (size & ~size_t(7));
+    for (; data != end; data += 8) {
+        uint64_t m;
+        std::memcpy(&m, data, 8);
+        v3 ^= m;
+        for (int i = 0; i < C; ++i) {
+            sipRound(v0, v1, v2, v3);
+        }
+        v0 ^= m;
+    }
+
+    uint64_t last = uint64_t(size) << 56;
+    for (size_t i = 0; i < (size & 7); ++i) {
+        last |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    v3 ^= last;
+    for (int i = 0; i < C; ++i) {
+        sipRound(v0, v1, v2, v3);
+    }
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < D; ++i) {
+        sipRound(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace detail
+
+// SipHash-1-3: keyed, and plenty for hash tables that only need
+// collisions to be unpredictable
+inline uint64_t sipHash13(const uint64_t key[2], const char *data, size_t size)
+{
+    return detail::sipHash<1, 3>(key, data, size);
+}
+
+// SipHash-2-4, the full-strength variant, for 64-bit authentication tags
+inline uint64_t sipHash24(const uint64_t key[2], const char *data, size_t size)
+{
+    return detail::sipHash<2, 4>(key, data, size);
+}
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_SIPHASH_H
@@ -0,0 +1,34 @@
+#ifndef QENQEY_CORE_SOURCE_H
+#define QENQEY_CORE_SOURCE_H
+
+#include <cstddef>
+
+namespace qenqey {
+
+class RandomStream;
+
+// Anything passwords can be drawn from: character plans, passphrases and
+// the other generation modes. The window and the bulk engine only talk
+// to this interface. Implementations precompute their tables, so
+// generate() allocates nothing and is safe to call from many threads at
+// once (each with its own RandomStream).
+class PasswordSource
+{
+public:
+    virtual ~PasswordSource() = default;
+
+    virtual bool isValid() const = 0;
+
+    // Upper bound on the bytes generate() writes
+    virtual size_t maxLength() const = 0;
+
+    // Writes one password (UTF-8, no terminator) and returns its length
+    virtual size_t generate(RandomStream &random, char *out) const = 0;
+
+    // Entropy of one output in bits
+    virtual double entropyBits() const = 0;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_SOURCE_H
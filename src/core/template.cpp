@@ -0,0 +1,288 @@
+#include "template.h"
+#include "random.h"
+#include "wordlist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace qenqey {
+
+namespace {
+
+std::string classes(unsigned mask)
+{
+    std::string characters;
+    for (int cls = 0; cls < CLASS_COUNT; ++cls) {
+        if (mask & (1u << cls)) {
+            characters += classCharacters(cls);
+        }
+    }
+    return characters;
+}
+
+} // namespace
+
+const char *templateErrorText(TemplateError error)
+{
+    switch (error) {
+    case TemplateError::None: return "ok";
+    case TemplateError::Empty: return "empty template";
+    case TemplateError::UnclosedSet: return "unclosed [";
+    case TemplateError::BadSet: return "empty or invalid character set";
+    case TemplateError::BadRepeat: return "bad {n} repeat";
+    case TemplateError::TooLong: return "template output too long";
+    case TemplateError::NoWordlist: return "no wordlist installed";
+    case TemplateError::BadLiteral: return "only printable ASCII characters are allowed";
+    }
+    return "invalid template";
+}
+
+TemplatePlan::TemplatePlan()
+    : TemplatePlan(DEFAULT_TEMPLATE, nullptr)
+{
+}
+
+TemplatePlan::TemplatePlan(std::string_view pattern, const Wordlist *wordlist)
+    : m_pattern(pattern)
+    , m_wordlist(nullptr)
+    , m_wordCount(0)
+    , m_wordThreshold(0)
+    , m_maxLength(0)
+    , m_entropy(0.0)
+    , m_entropyExact(true)
+    , m_afterWord(false)
+    , m_error(TemplateError::None)
+    , m_errorPosition(0)
+{
+    compile(wordlist);
+}
+
+bool TemplatePlan::fail(TemplateError error, size_t position)
+{
+    m_error = error;
+    m_errorPosition = position;
+    m_ops.clear();
+    m_maxLength = 0;
+    m_entropy = 0.0;
+    return false;
+}
+
+int TemplatePlan::tableFor(const std::string &characters)
+{
+    for (size_t i = 0; i < m_tables.size(); ++i) {
+        const AlphabetTable &table = m_tables[i];
+        if (characters.size() == table.size
+            && std::memcmp(table.characters, characters.data(), table.size) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    if (m_tables.size() > UINT8_MAX) {
+        return -1;
+    }
+
+    AlphabetTable table;
+    table.size = static_cast<uint32_t>(characters.size());
+    std::memcpy(table.characters, characters.data(), characters.size());
+    finalizeAlphabet(table);
+    m_tables.push_back(table);
+    return static_cast<int>(m_tables.size() - 1);
+}
+
+void TemplatePlan::append(OpKind kind, int table, size_t count, char literal)
+{
+    // Runs of the same kind and table become one op
+    const bool merge = !m_ops.empty() && m_ops.back().kind == kind
+                       && (kind == Literal || m_ops.back().table == table);
+    if (!merge) {
+        m_ops.push_back(Op{kind, static_cast<uint8_t>(table), 0,
+                           static_cast<uint32_t>(m_literals.size())});
+    }
+    m_ops.back().count = static_cast<uint16_t>(m_ops.back().count + count);
+
+    switch (kind) {
+    case Literal:
+        m_literals.append(count, literal);
+        m_maxLength += count;
+        if (std::strchr(PASSPHRASE_SEPARATORS, literal)) {
+            m_afterWord = false;
+        }
+        break;
+    case Characters:
+        m_maxLength += count;
+        m_entropy += count * std::log2(static_cast<double>(m_tables[table].size));
+        break;
+    case Words:
+    case CapitalWords:
+        m_maxLength += count * m_wordlist->maxWordBytes();
+        m_entropy += count * std::log2(static_cast<double>(m_wordCount));
+        if (m_afterWord || count > 1) {
+            m_entropyExact = false;
+        }
+        m_afterWord = true;
+        break;
+    }
+}
+
+void TemplatePlan::compile(const Wordlist *wordlist)
+{
+    const std::string &pattern = m_pattern;
+    if (pattern.empty()) {
+        fail(TemplateError::Empty, 0);
+        return;
+    }
+
+    size_t i = 0;
+    while (i < pattern.size()) {
+        const size_t start = i;
+        OpKind kind = Characters;
+        std::string characters;
+        char literal = pattern[i++];
+
+        switch (literal) {
+        case 'A': characters = classes(Uppercase); break;
+        case 'a': characters = classes(Lowercase); break;
+        case '9': characters = classes(Numbers); break;
+        case 's': characters = classes(Symbols); break;
+        case 'x': characters = classes(Uppercase | Lowercase | Numbers); break;
+        case '*': characters = classes(ALL_CLASSES); break;
+        case 'w':
+        case 'W':
+            if (!wordlist || wordlist->size() == 0) {
+                fail(TemplateError::NoWordlist, start);
+                return;
+            }
+            m_wordlist = wordlist;
+            m_wordCount = static_cast<uint32_t>(wordlist->size());
+            m_wordThreshold = -m_wordCount % m_wordCount;
+            kind = literal == 'W' ? CapitalWords : Words;
+            break;
+        case '[': {
+            bool present[256] = {};
+            bool closed = false;
+            while (i < pattern.size()) {
+                char c = pattern[i++];
+                if (c == ']') {
+                    closed = true;
+                    break;
+                }
+                if (c == '\\' && i < pattern.size()) {
+                    c = pattern[i++];
+                }
+                unsigned char last = static_cast<unsigned char>(c);
+                if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+                    last = static_cast<unsigned char>(pattern[i + 1]);
+                    if (last < static_cast<unsigned char>(c)) {
+                        fail(TemplateError::BadSet, i);
+                        return;
+                    }
+                    i += 2;
+                }
+                for (unsigned b = static_cast<unsigned char>(c); b <= last; ++b) {
+                    present[b] = true;
+                }
+            }
+            if (!closed) {
+                fail(TemplateError::UnclosedSet, start);
+                return;
+            }
+            // Printable ASCII only, so every character is one byte of output
+            for (int b = 0x21; b < 0x7f; ++b) {
+                if (present[b]) {
+                    characters += static_cast<char>(b);
+                }
+            }
+            if (characters.empty() || std::any_of(present, present + 0x21, [](bool p) { return p; })
+                || std::any_of(present + 0x7f, present + 256, [](bool p) { return p; })) {
+                fail(TemplateError::BadSet, start);
+                return;
+            }
+            break;
+        }
+        case '{':
+            fail(TemplateError::BadRepeat, start);
+            return;
+        case '\\':
+            if (i < pattern.size()) {
+                literal = pattern[i++];
+            }
+            kind = Literal;
+            break;
+        default:
+            kind = Literal;
+            break;
+        }
+
+        // Control characters would split records, and a lone byte of a
+        // UTF-8 character repeated by {n} is not text
+        if (kind == Literal && (static_cast<unsigned char>(literal) < 0x20 || static_cast<unsigned char>(literal) > 0x7e)) {
+            fail(TemplateError::BadLiteral, start);
+            return;
+        }
+
+        size_t count = 1;
+        if (i < pattern.size() && pattern[i] == '{') {
+            const size_t close = pattern.find('}', i);
+            count = 0;
+            for (size_t j = i + 1; j < close && close != std::string::npos && count <= MAX_OUTPUT_BYTES; ++j) {
+                if (pattern[j] < '0' || pattern[j] > '9') {
+                    count = 0;
+                    break;
+                }
+                count = count * 10 + static_cast<size_t>(pattern[j] - '0');
+            }
+            if (close == std::string::npos || count == 0 || count > MAX_OUTPUT_BYTES) {
+                fail(TemplateError::BadRepeat, i);
+                return;
+            }
+            i = close + 1;
+        }
+
+        int table = 0;
+        if (kind == Characters) {
+            table = tableFor(characters);
+            if (table < 0) {
+                fail(TemplateError::TooLong, start);
+                return;
+            }
+        }
+        append(kind, table, count, literal);
+        if (m_maxLength > MAX_OUTPUT_BYTES) {
+            fail(TemplateError::TooLong, start);
+            return;
+        }
+    }
+}
+
+size_t TemplatePlan::generate(RandomStream &random, char *out) const
+{
+    char *p = out;
+    for (const Op &op : m_ops) {
+        switch (op.kind) {
+        case Literal:
+            std::memcpy(p, m_literals.data() + op.offset, op.count);
+            p += op.count;
+            break;
+        case Characters: {
+            const AlphabetTable &table = m_tables[op.table];
+            random.sampleBytes(table.byteLimit, table.byteMap, p, op.count);
+            p += op.count;
+            break;
+        }
+        case Words:
+        case CapitalWords:
+            for (int i = 0; i < op.count; ++i) {
+                const std::string_view word = m_wordlist->word(random.bounded(m_wordCount, m_wordThreshold));
+                std::memcpy(p, word.data(), word.size());
+                if (op.kind == CapitalWords && *p >= 'a' && *p <= 'z') {
+                    *p = static_cast<char>(*p - 'a' + 'A');
+                }
+                p += word.size();
+            }
+            break;
+        }
+    }
+    return static_cast<size_t>(p - out);
+}
+
+} // namespace qenqey
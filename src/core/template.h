@@ -0,0 +1,115 @@
+#ifndef QENQEY_CORE_TEMPLATE_H
+#define QENQEY_CORE_TEMPLATE_H
+
+#include "charsetplan.h"
+#include "source.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qenqey {
+
+class Wordlist;
+
+// Pattern syntax:
+//
+//   A  uppercase letter       a  lowercase letter
+//   9  digit                  s  symbol
+//   x  letter or digit        *  any of A, a, 9 and s
+//   [...]  one of the listed characters; ranges like [0-9a-f] allowed
+//   w  word from the wordlist W  word with a capital first letter
+//   {n}  repeats the previous element n times
+//   \c  the character c itself; any other character also stands for
+//       itself, so "Aaaa-9999-ssss" or "w.w.99s" work as written
+//
+// Literals, like the characters of a set, must be printable ASCII
+// (space to '~'): one byte each, and nothing that would break a record
+// in any export format.
+constexpr const char *DEFAULT_TEMPLATE = "Aaaa-9999-ssss";
+
+enum class TemplateError {
+    None,
+    Empty,
+    UnclosedSet,
+    BadSet,
+    BadRepeat,
+    TooLong,
+    NoWordlist,
+    BadLiteral,
+};
+
+// English description, for the daemon protocol
+const char *templateErrorText(TemplateError error);
+
+// A pattern compiled into a flat program: one op per run of literals,
+// characters from the same table or words, each pointing at a
+// precomputed table. Generation walks the ops once with no parsing, so a
+// template costs about as much as a plain password of the same length.
+class TemplatePlan : public PasswordSource
+{
+public:
+    TemplatePlan();
+
+    // The wordlist is only used, and must only outlive the plan, when the
+    // pattern contains words
+    TemplatePlan(std::string_view pattern, const Wordlist *wordlist);
+
+    bool isValid() const override { return m_error == TemplateError::None; }
+    size_t maxLength() const override { return m_maxLength; }
+    size_t generate(RandomStream &random, char *out) const override;
+
+    // Exact while every two words have a separator (" -._") between
+    // them; otherwise the words can occasionally spell the same string
+    // two ways ("sun" + "set" and "sunset"), so it is an upper bound
+    double entropyBits() const override { return m_entropy; }
+    bool isEntropyExact() const { return m_entropyExact; }
+
+    TemplateError error() const { return m_error; }
+
+    // Offset in the pattern where compilation stopped
+    size_t errorPosition() const { return m_errorPosition; }
+
+    const std::string &pattern() const { return m_pattern; }
+
+private:
+    enum OpKind : uint8_t {
+        Literal,
+        Characters,
+        Words,
+        CapitalWords,
+    };
+
+    struct Op
+    {
+        OpKind kind;
+        uint8_t table;
+        uint16_t count;
+        uint32_t offset;
+    };
+
+    void compile(const Wordlist *wordlist);
+    bool fail(TemplateError error, size_t position);
+    int tableFor(const std::string &characters);
+    void append(OpKind kind, int table, size_t count, char literal);
+
+    std::string m_pattern;
+    std::vector<Op> m_ops;
+    std::vector<AlphabetTable> m_tables;
+    std::string m_literals;
+    const Wordlist *m_wordlist;
+    uint32_t m_wordCount;
+    uint32_t m_wordThreshold;
+    size_t m_maxLength;
+    double m_entropy;
+    bool m_entropyExact;
+    // A word was the last element, with no separator after it yet
+    bool m_afterWord;
+    TemplateError m_error;
+    size_t m_errorPosition;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_TEMPLATE_H
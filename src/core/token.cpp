@@ -0,0 +1,408 @@
+#include "token.h"
+#include "random.h"
+#include "securememory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Byte shuffles make base64 and base32 several times cheaper; those
+// kernels are compiled for SSSE3 and picked at run time
+#if defined(__x86_64__) && defined(__GNUC__)
+#define QENQEY_TOKEN_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace qenqey {
+
+namespace {
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+constexpr char BASE64URL_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+constexpr char BASE32_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+constexpr char CROCKFORD_ALPHABET[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+constexpr size_t UUID_BYTES = 16;
+constexpr size_t UUID_LENGTH = 36;
+
+// Last partial group: bits taken most significant first, the final
+// character padded with zero bits
+template <int BITS>
+char *encodeBits(const uint8_t *in, size_t size, const char *alphabet, char *out)
+{
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < size; ++i) {
+        buffer = buffer << 8 | in[i];
+        bits += 8;
+        while (bits >= BITS) {
+            bits -= BITS;
+            *out++ = alphabet[(buffer >> bits) & ((1u << BITS) - 1)];
+        }
+    }
+    if (bits > 0) {
+        *out++ = alphabet[(buffer << (BITS - bits)) & ((1u << BITS) - 1)];
+    }
+    return out;
+}
+
+#if defined(__SSE2__)
+
+// Adds add to the bytes of x greater than limit (all values here are
+// below 128, so the signed compare is exact)
+inline __m128i offsetAbove(__m128i x, int limit, int add)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(limit))),
+                         _mm_set1_epi8(static_cast<char>(add)));
+}
+
+inline __m128i hexDigits(__m128i nibbles)
+{
+    const __m128i ascii = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+    return _mm_add_epi8(ascii, offsetAbove(nibbles, 9, 'a' - '0' - 10));
+}
+
+// 16 bytes to 32 digits: nibbles split into two vectors and interleaved
+inline void hexBlock(const uint8_t *in, char *out)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    const __m128i low = _mm_and_si128(bytes, mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), hexDigits(_mm_unpacklo_epi8(high, low)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), hexDigits(_mm_unpackhi_epi8(high, low)));
+}
+
+inline uint32_t loadLittle32(const uint8_t *p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// 12 bytes to 16 characters. Each 32-bit lane holds one 3-byte group in
+// its low bytes, and shifts and masks move its four 6-bit fields into the
+// four bytes of the lane in output order. The last group is loaded from
+// a byte early so nothing past the block is read.
+inline void base64UrlBlock(const uint8_t *in, char *out)
+{
+    const __m128i x = _mm_setr_epi32(static_cast<int>(loadLittle32(in)), static_cast<int>(loadLittle32(in + 3)),
+                                     static_cast<int>(loadLittle32(in + 6)), static_cast<int>(loadLittle32(in + 8) >> 8));
+    const auto field = [&](__m128i shifted, uint32_t mask) {
+        return _mm_and_si128(shifted, _mm_set1_epi32(static_cast<int>(mask)));
+    };
+    __m128i indexes = field(_mm_srli_epi32(x, 2), 0x0000003f);
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi32(x, 12), 0x00003000));
+    indexes = _mm_or_si128(indexes, field(_mm_srli_epi32(x, 4), 0x00000f00));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi32(x, 10), 0x003c0000));
+    indexes = _mm_or_si128(indexes, field(_mm_srli_epi32(x, 6), 0x00030000));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi32(x, 8), 0x3f000000));
+
+    // A..Z, a..z, 0..9, '-', '_' as offsets from the index
+    __m128i offset = _mm_set1_epi8('A');
+    offset = _mm_add_epi8(offset, offsetAbove(indexes, 25, 'a' - 26 - 'A'));
+    offset = _mm_add_epi8(offset, offsetAbove(indexes, 51, '0' - 52 - ('a' - 26)));
+    offset = _mm_add_epi8(offset, offsetAbove(indexes, 61, '-' - 62 - ('0' - 52)));
+    offset = _mm_add_epi8(offset, offsetAbove(indexes, 62, '_' - 63 - ('-' - 62)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_add_epi8(indexes, offset));
+}
+
+inline uint64_t loadBig64(const uint8_t *p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return __builtin_bswap64(value);
+}
+
+// 10 bytes to 16 characters. Each 64-bit lane holds a 5-byte group as a
+// big-endian 40-bit number; field k sits at bit 35 - 5k and belongs in
+// byte k, so one shift by 13k - 35 and a mask places it. Both loads stay
+// within the block: the second group is the low end of bytes 2-9.
+template <bool CROCKFORD>
+inline void base32Block(const uint8_t *in, char *out)
+{
+    const __m128i x = _mm_set_epi64x(static_cast<long long>(loadBig64(in + 2) & 0xffffffffffull),
+                                     static_cast<long long>(loadBig64(in) >> 24));
+    const auto field = [&](__m128i shifted, int k) {
+        return _mm_and_si128(shifted, _mm_set1_epi64x(0x1fll << (8 * k)));
+    };
+    __m128i indexes = field(_mm_srli_epi64(x, 35), 0);
+    indexes = _mm_or_si128(indexes, field(_mm_srli_epi64(x, 22), 1));
+    indexes = _mm_or_si128(indexes, field(_mm_srli_epi64(x, 9), 2));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi64(x, 4), 3));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi64(x, 17), 4));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi64(x, 30), 5));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi64(x, 43), 6));
+    indexes = _mm_or_si128(indexes, field(_mm_slli_epi64(x, 56), 7));
+
+    __m128i ascii;
+    if (CROCKFORD) {
+        // Digits, then letters skipping I, L, O and U
+        ascii = _mm_add_epi8(indexes, _mm_set1_epi8('0'));
+        ascii = _mm_add_epi8(ascii, offsetAbove(indexes, 9, 'A' - '0' - 10));
+        ascii = _mm_add_epi8(ascii, offsetAbove(indexes, 17, 1));
+        ascii = _mm_add_epi8(ascii, offsetAbove(indexes, 19, 1));
+        ascii = _mm_add_epi8(ascii, offsetAbove(indexes, 21, 1));
+        ascii = _mm_add_epi8(ascii, offsetAbove(indexes, 26, 1));
+    } else {
+        ascii = _mm_add_epi8(indexes, _mm_set1_epi8('A'));
+        ascii = _mm_add_epi8(ascii, offsetAbove(indexes, 25, '2' - 26 - 'A'));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), ascii);
+}
+
+#endif
+
+#if defined(QENQEY_TOKEN_SSSE3)
+
+#define QENQEY_SSSE3 __attribute__((target("ssse3")))
+
+bool hasSsse3()
+{
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+// 12 bytes to 16 characters, reading 16 (Muła and Lemire). A shuffle
+// copies each 3-byte group into a lane as b1 b0 b2 b1; two masked 16-bit
+// multiplies then shift all four 6-bit fields into place at once, and a
+// 16-entry table of offsets from the index maps them to the alphabet.
+QENQEY_SSSE3 void base64UrlBlockSsse3(const uint8_t *in, char *out)
+{
+    const __m128i bytes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)),
+                                           _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i high = _mm_mulhi_epu16(_mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00)),
+                                         _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(_mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0)),
+                                        _mm_set1_epi32(0x01000010));
+    const __m128i indexes = _mm_or_si128(high, low);
+
+    // 0 for a..z, 1-10 for digits, 11 and 12 for '-' and '_', 13 for A..Z
+    __m128i range = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes), _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_add_epi8(indexes, _mm_shuffle_epi8(offsets, range)));
+}
+
+// 10 bytes to 16 characters, reading 16. Character k of a 5-byte group
+// is bits 5k to 5k+4, which always lie in the big-endian 16-bit window at
+// byte 5k/8. A shuffle builds the eight windows of each group, an
+// unsigned high multiply shifts each window right by its own amount, and
+// the alphabet is looked up directly, half from each of two tables.
+template <bool CROCKFORD>
+QENQEY_SSSE3 void base32BlockSsse3(const uint8_t *in, char *out)
+{
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i shifts = _mm_setr_epi16(1 << 5, 1 << 10, 1 << 7, 1 << 12, 1 << 9, 1 << 6, 1 << 11, 1 << 8);
+    const __m128i mask = _mm_set1_epi16(0x1f);
+    const __m128i first = _mm_and_si128(
+        _mm_mulhi_epu16(_mm_shuffle_epi8(bytes, _mm_setr_epi8(1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, -1, 4)),
+                        shifts), mask);
+    const __m128i second = _mm_and_si128(
+        _mm_mulhi_epu16(_mm_shuffle_epi8(bytes, _mm_setr_epi8(6, 5, 6, 5, 7, 6, 7, 6, 8, 7, 9, 8, 9, 8, -1, 9)),
+                        shifts), mask);
+    const __m128i indexes = _mm_packus_epi16(first, second);
+
+    const char *alphabet = CROCKFORD ? CROCKFORD_ALPHABET : BASE32_ALPHABET;
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alphabet));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alphabet + 16));
+    const __m128i upper = _mm_cmpgt_epi8(indexes, _mm_set1_epi8(15));
+    const __m128i ascii = _mm_or_si128(_mm_andnot_si128(upper, _mm_shuffle_epi8(low, indexes)),
+                                       _mm_and_si128(upper, _mm_shuffle_epi8(high, indexes)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), ascii);
+}
+
+#endif
+
+template <bool CROCKFORD>
+size_t encodeBase32Alphabet(const uint8_t *in, size_t size, char *out)
+{
+    size_t i = 0;
+    char *end = out;
+    const char *alphabet = CROCKFORD ? CROCKFORD_ALPHABET : BASE32_ALPHABET;
+#if defined(QENQEY_TOKEN_SSSE3)
+    if (hasSsse3()) {
+        for (; size - i >= 16; i += 10, end += 16) {
+            base32BlockSsse3<CROCKFORD>(in + i, end);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    for (; size - i >= 10; i += 10, end += 16) {
+        base32Block<CROCKFORD>(in + i, end);
+    }
+#endif
+    for (; size - i >= 5; i += 5, end += 8) {
+        const uint64_t group = uint64_t(in[i]) << 32 | uint64_t(in[i + 1]) << 24 | uint64_t(in[i + 2]) << 16
+            | uint64_t(in[i + 3]) << 8 | in[i + 4];
+        for (int k = 0; k < 8; ++k) {
+            end[k] = alphabet[(group >> (35 - 5 * k)) & 0x1f];
+        }
+    }
+    end = encodeBits<5>(in + i, size - i, alphabet, end);
+    return static_cast<size_t>(end - out);
+}
+
+} // namespace
+
+const char *tokenEncodingName(TokenEncoding encoding)
+{
+    switch (encoding) {
+    case TokenEncoding::Hex:
+        return "hex";
+    case TokenEncoding::Base64Url:
+        return "base64url";
+    case TokenEncoding::Base32:
+        return "base32";
+    case TokenEncoding::Crockford:
+        return "crockford";
+    case TokenEncoding::Uuid:
+        return "uuid";
+    }
+    return "hex";
+}
+
+bool parseTokenEncoding(std::string_view text, TokenEncoding &encoding)
+{
+    for (TokenEncoding candidate : {TokenEncoding::Hex, TokenEncoding::Base64Url, TokenEncoding::Base32,
+                                    TokenEncoding::Crockford, TokenEncoding::Uuid}) {
+        if (text == tokenEncodingName(candidate)) {
+            encoding = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t encodedLength(TokenEncoding encoding, size_t size)
+{
+    switch (encoding) {
+    case TokenEncoding::Hex:
+        return 2 * size;
+    case TokenEncoding::Base64Url:
+        return (8 * size + 5) / 6;
+    case TokenEncoding::Base32:
+    case TokenEncoding::Crockford:
+        return (8 * size + 4) / 5;
+    case TokenEncoding::Uuid:
+        return UUID_LENGTH;
+    }
+    return 0;
+}
+
+size_t encodeHex(const uint8_t *in, size_t size, char *out)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; size - i >= 16; i += 16) {
+        hexBlock(in + i, out + 2 * i);
+    }
+#endif
+    for (; i < size; ++i) {
+        out[2 * i] = HEX_DIGITS[in[i] >> 4];
+        out[2 * i + 1] = HEX_DIGITS[in[i] & 0x0f];
+    }
+    return 2 * size;
+}
+
+size_t encodeBase64Url(const uint8_t *in, size_t size, char *out)
+{
+    size_t i = 0;
+    char *end = out;
+#if defined(QENQEY_TOKEN_SSSE3)
+    if (hasSsse3()) {
+        for (; size - i >= 16; i += 12, end += 16) {
+            base64UrlBlockSsse3(in + i, end);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    for (; size - i >= 12; i += 12, end += 16) {
+        base64UrlBlock(in + i, end);
+    }
+#endif
+    for (; size - i >= 3; i += 3, end += 4) {
+        const uint32_t group = uint32_t(in[i]) << 16 | uint32_t(in[i + 1]) << 8 | in[i + 2];
+        end[0] = BASE64URL_ALPHABET[group >> 18];
+        end[1] = BASE64URL_ALPHABET[(group >> 12) & 0x3f];
+        end[2] = BASE64URL_ALPHABET[(group >> 6) & 0x3f];
+        end[3] = BASE64URL_ALPHABET[group & 0x3f];
+    }
+    end = encodeBits<6>(in + i, size - i, BASE64URL_ALPHABET, end);
+    return static_cast<size_t>(end - out);
+}
+
+size_t encodeBase32(const uint8_t *in, size_t size, char *out)
+{
+    return encodeBase32Alphabet<false>(in, size, out);
+}
+
+size_t encodeCrockford(const uint8_t *in, size_t size, char *out)
+{
+    return encodeBase32Alphabet<true>(in, size, out);
+}
+
+TokenPlan::TokenPlan()
+    : TokenPlan(TokenSettings())
+{
+}
+
+TokenPlan::TokenPlan(const TokenSettings &settings)
+    : m_settings(settings)
+{
+    m_settings.bytes = settings.encoding == TokenEncoding::Uuid
+        ? static_cast<int>(UUID_BYTES)
+        : std::clamp(settings.bytes, MIN_TOKEN_BYTES, MAX_TOKEN_BYTES);
+    m_length = encodedLength(m_settings.encoding, static_cast<size_t>(m_settings.bytes));
+}
+
+double TokenPlan::entropyBits() const
+{
+    // A UUID spends six bits on its version and variant
+    return m_settings.encoding == TokenEncoding::Uuid ? 122.0 : 8.0 * m_settings.bytes;
+}
+
+size_t TokenPlan::generate(RandomStream &random, char *out) const
+{
+    uint8_t bytes[MAX_TOKEN_BYTES];
+    const size_t size = static_cast<size_t>(m_settings.bytes);
+    random.fill(bytes, size);
+
+    size_t length = 0;
+    switch (m_settings.encoding) {
+    case TokenEncoding::Hex:
+        length = encodeHex(bytes, size, out);
+        break;
+    case TokenEncoding::Base64Url:
+        length = encodeBase64Url(bytes, size, out);
+        break;
+    case TokenEncoding::Base32:
+        length = encodeBase32(bytes, size, out);
+        break;
+    case TokenEncoding::Crockford:
+        length = encodeCrockford(bytes, size, out);
+        break;
+    case TokenEncoding::Uuid:
+        // Version 4, variant 10xx (RFC 9562). The digits are encoded in
+        // one piece and the groups moved apart, last first.
+        bytes[6] = static_cast<uint8_t>((bytes[6] & 0x0f) | 0x40);
+        bytes[8] = static_cast<uint8_t>((bytes[8] & 0x3f) | 0x80);
+        encodeHex(bytes, UUID_BYTES, out);
+        std::memmove(out + 24, out + 20, 12);
+        std::memmove(out + 19, out + 16, 4);
+        std::memmove(out + 14, out + 12, 4);
+        std::memmove(out + 9, out + 8, 4);
+        out[8] = out[13] = out[18] = out[23] = '-';
+        length = UUID_LENGTH;
+        break;
+    }
+
+    secureZero(bytes, size);
+    return length;
+}
+
+} // namespace qenqey
@@ -0,0 +1,59 @@
+#ifndef QENQEY_CORE_TOKEN_H
+#define QENQEY_CORE_TOKEN_H
+
+#include "settings.h"
+#include "source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace qenqey {
+
+// Name used by the CLI and policies: hex, base64url, base32, crockford, uuid
+const char *tokenEncodingName(TokenEncoding encoding);
+bool parseTokenEncoding(std::string_view text, TokenEncoding &encoding);
+
+// Characters the encoding writes for size bytes, without padding
+size_t encodedLength(TokenEncoding encoding, size_t size);
+
+// Encoders for raw bytes. Each writes encodedLength() characters and
+// returns that count: lower-case hex, base64url (RFC 4648 section 5) and
+// base32 (section 6, upper case) without '=' padding, and Crockford's
+// base32 alphabet in upper case. Bytes are consumed most significant bit
+// first, so the output decodes with any standard decoder. With SSE2 the
+// bulk of the input goes 12 to 16 bytes per step through vector kernels;
+// the tail and other targets use the scalar code.
+size_t encodeHex(const uint8_t *in, size_t size, char *out);
+size_t encodeBase64Url(const uint8_t *in, size_t size, char *out);
+size_t encodeBase32(const uint8_t *in, size_t size, char *out);
+size_t encodeCrockford(const uint8_t *in, size_t size, char *out);
+
+// Machine secrets: API keys, session tokens, UUIDs. A token is random
+// bytes taken from the stream in one piece and encoded, so its entropy is
+// exactly eight bits a byte (122 bits for a UUID) and its cost is mostly
+// the keystream itself.
+class TokenPlan : public PasswordSource
+{
+public:
+    TokenPlan();
+    explicit TokenPlan(const TokenSettings &settings);
+
+    bool isValid() const override { return true; }
+    size_t maxLength() const override { return m_length; }
+    size_t generate(RandomStream &random, char *out) const override;
+    double entropyBits() const override;
+
+    const TokenSettings &settings() const { return m_settings; }
+
+    // Random bytes per token: 16 for a UUID
+    int byteCount() const { return m_settings.bytes; }
+
+private:
+    TokenSettings m_settings;
+    size_t m_length;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_TOKEN_H
@@ -0,0 +1,148 @@
+#include "uniqueset.h"
+#include "random.h"
+#include "siphash.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace qenqey {
+
+namespace {
+
+// The default spill directory may not exist yet, nor its parents
+void makeCacheDirectory(const std::string &path)
+{
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0700);
+    }
+    mkdir(path.c_str(), 0700);
+}
+
+void *mapTemporaryFile(const std::string &directory, size_t size, std::string *error)
+{
+    std::string path = directory + "/qenqey-unique-XXXXXX";
+    const int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        if (error) {
+            *error = path + ": " + std::strerror(errno);
+        }
+        return nullptr;
+    }
+    // Nothing else ever needs the name, and the space is freed on exit
+    unlink(path.c_str());
+
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED && error) {
+        *error = std::string("temporary file: ") + std::strerror(errno);
+    }
+    close(fd);
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+} // namespace
+
+std::string defaultUniqueSpillDirectory()
+{
+    const char *cache = std::getenv("XDG_CACHE_HOME");
+    if (cache && *cache == '/') {
+        return std::string(cache) + "/qenqey";
+    }
+    const char *home = std::getenv("HOME");
+    if (home && *home == '/') {
+        return std::string(home) + "/.cache/qenqey";
+    }
+    return "/var/tmp";
+}
+
+FingerprintSet::~FingerprintSet()
+{
+    if (m_slots) {
+        munmap(m_slots, tableBytes());
+    }
+}
+
+bool FingerprintSet::reserve(uint64_t capacity, size_t memoryBudget, const std::string &spillDirectory,
+                             std::string *error)
+{
+    if (m_slots) {
+        munmap(m_slots, tableBytes());
+        m_slots = nullptr;
+    }
+
+    // Linear probing stays short below ~80% load
+    m_capacity = capacity;
+    m_slotCount = capacity + capacity / 3 + 64;
+    const size_t bytes = tableBytes();
+
+    m_fileBacked = bytes > memoryBudget;
+    void *data = nullptr;
+    if (m_fileBacked) {
+        std::string directory = spillDirectory;
+        if (directory.empty()) {
+            directory = defaultUniqueSpillDirectory();
+            makeCacheDirectory(directory);
+        }
+        data = mapTemporaryFile(directory, bytes, error);
+        if (data) {
+            madvise(data, bytes, MADV_RANDOM);
+        }
+    } else {
+        data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            if (error) {
+                *error = std::string("mmap: ") + std::strerror(errno);
+            }
+        } else {
+            // Every insert touches a random page; huge pages keep that
+            // from being a TLB miss as well as a cache miss
+            madvise(data, bytes, MADV_HUGEPAGE);
+        }
+    }
+    if (!data) {
+        m_slotCount = 0;
+        return false;
+    }
+
+    // Fresh mappings read as zero, which is the empty slot
+    m_slots = static_cast<std::atomic<uint64_t> *>(data);
+    RandomStream::forThread().fill(m_key, sizeof(m_key));
+    return true;
+}
+
+uint64_t FingerprintSet::fingerprint(std::string_view password) const
+{
+    const uint64_t hash = sipHash13(m_key, password.data(), password.size());
+    return hash ? hash : 1;
+}
+
+bool FingerprintSet::insertFingerprint(uint64_t hash)
+{
+    uint64_t slot = slotFor(hash);
+
+    for (;;) {
+        uint64_t current = m_slots[slot].load(std::memory_order_relaxed);
+        if (current == 0) {
+            if (m_slots[slot].compare_exchange_strong(current, hash, std::memory_order_relaxed)) {
+                return true;
+            }
+            // Lost the race; current now holds the winner
+        }
+        if (current == hash) {
+            return false;
+        }
+        if (++slot == m_slotCount) {
+            slot = 0;
+        }
+    }
+}
+
+} // namespace qenqey
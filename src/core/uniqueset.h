@@ -0,0 +1,80 @@
+#ifndef QENQEY_CORE_UNIQUESET_H
+#define QENQEY_CORE_UNIQUESET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace qenqey {
+
+// Table memory beyond which FingerprintSet moves to a file-backed mapping
+constexpr size_t DEFAULT_UNIQUE_MEMORY = size_t(512) << 20;
+
+// Regenerations allowed for one password before the batch is declared
+// impossible to keep unique
+constexpr int MAX_UNIQUE_RETRIES = 1000;
+
+// Where tables past the memory budget go by default: $XDG_CACHE_HOME/qenqey
+// or ~/.cache/qenqey, or /var/tmp without a home. Not /tmp, which is
+// tmpfs on most systems and would keep the table in memory after all.
+std::string defaultUniqueSpillDirectory();
+
+// Set of keyed 64-bit password fingerprints for de-duplicating a batch.
+// Sized once for the whole batch, so it never rehashes: a flat
+// linear-probing table at most ~77% full, inserted into lock-free by every
+// worker at once. Only fingerprints are stored, under a random per-set
+// SipHash key, so the table holds nothing that reveals a password.
+//
+// Tables larger than the memory budget live in an unlinked temporary file
+// mapped shared, which the kernel can write back instead of swapping or
+// failing. That only bounds memory when the file is on a disk, so the
+// directory is the caller's choice. A fingerprint collision can only
+// reject a fresh password, never let a duplicate through.
+class FingerprintSet
+{
+public:
+    FingerprintSet() = default;
+    ~FingerprintSet();
+
+    FingerprintSet(const FingerprintSet &) = delete;
+    FingerprintSet &operator=(const FingerprintSet &) = delete;
+
+    // Sizes the table for capacity entries, in a file in spillDirectory
+    // (defaultUniqueSpillDirectory() when empty, created if missing) past
+    // the budget. False if it cannot be mapped.
+    bool reserve(uint64_t capacity, size_t memoryBudget = DEFAULT_UNIQUE_MEMORY,
+                 const std::string &spillDirectory = std::string(), std::string *error = nullptr);
+
+    // True if the password was not in the set yet. Thread-safe; at most
+    // capacity() passwords may be inserted.
+    bool insert(std::string_view password) { return insertFingerprint(fingerprint(password)); }
+
+    // Split form for batching: hash, prefetch the slot, insert later once
+    // the cache line has arrived
+    uint64_t fingerprint(std::string_view password) const;
+    void prefetch(uint64_t fingerprint) const { __builtin_prefetch(&m_slots[slotFor(fingerprint)], 1); }
+    bool insertFingerprint(uint64_t fingerprint);
+
+    uint64_t capacity() const { return m_capacity; }
+    size_t tableBytes() const { return m_slotCount * sizeof(uint64_t); }
+    bool isFileBacked() const { return m_fileBacked; }
+
+private:
+    // Maps the hash onto the table without a division
+    uint64_t slotFor(uint64_t fingerprint) const
+    {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(fingerprint) * m_slotCount) >> 64);
+    }
+
+    std::atomic<uint64_t> *m_slots = nullptr;
+    uint64_t m_slotCount = 0;
+    uint64_t m_capacity = 0;
+    uint64_t m_key[2] = {0, 0};
+    bool m_fileBacked = false;
+};
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_UNIQUESET_H
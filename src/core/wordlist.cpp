@@ -0,0 +1,159 @@
+#include "wordlist.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+namespace qenqey {
+
+namespace {
+
+constexpr char MAGIC[4] = {'Q', 'Q', 'W', '1'};
+
+struct Header
+{
+    char magic[4];
+    uint32_t maxWordBytes;
+    uint64_t wordCount;
+    uint64_t textSize;
+};
+
+bool isValidWord(const std::string &word)
+{
+    if (word.empty() || word.size() > Wordlist::MAX_WORD_BYTES) {
+        return false;
+    }
+    for (char c : word) {
+        if (static_cast<unsigned char>(c) <= ' ' || c == 0x7f || std::strchr(PASSPHRASE_SEPARATORS, c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const Wordlist *Wordlist::shared()
+{
+    static Wordlist wordlist;
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        const std::string path = findDataFile("QENQEY_WORDLIST", "wordlist.qqw");
+        if (!path.empty()) {
+            wordlist.open(path);
+        }
+    });
+
+    return wordlist.isOpen() ? &wordlist : nullptr;
+}
+
+bool Wordlist::open(const std::string &path)
+{
+    m_offsets = nullptr;
+    m_count = 0;
+    if (!m_file.open(path, MappedFile::Random) || m_file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    const uint64_t available = m_file.size() - sizeof(Header);
+    // Words are picked with 32-bit bounded draws
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.wordCount == 0
+        || header.wordCount > UINT32_MAX || header.maxWordBytes > MAX_WORD_BYTES
+        || (header.wordCount + 1) * sizeof(uint64_t) > available
+        || header.textSize > available - (header.wordCount + 1) * sizeof(uint64_t)) {
+        m_file.close();
+        return false;
+    }
+
+    const auto *offsets = reinterpret_cast<const uint64_t *>(m_file.data() + sizeof(Header));
+    if (offsets[0] != 0 || offsets[header.wordCount] != header.textSize) {
+        m_file.close();
+        return false;
+    }
+
+    // word() trusts every offset, and callers copy words into buffers
+    // sized by maxWordBytes(), so a custom list is checked in full
+    for (uint64_t i = 0; i < header.wordCount; ++i) {
+        if (offsets[i + 1] < offsets[i] || offsets[i + 1] > header.textSize
+            || offsets[i + 1] - offsets[i] > header.maxWordBytes) {
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_offsets = offsets;
+    m_text = m_file.data() + sizeof(Header) + (header.wordCount + 1) * sizeof(uint64_t);
+    m_count = header.wordCount;
+    m_maxWordBytes = header.maxWordBytes;
+    return true;
+}
+
+bool writeWordlistIndex(const std::vector<std::string> &words, const std::string &path,
+                        std::string *error, size_t *skipped)
+{
+    std::unordered_set<std::string> seen;
+    std::vector<uint64_t> offsets{0};
+    std::string text;
+    size_t maxWordBytes = 0;
+    size_t dropped = 0;
+
+    for (const std::string &word : words) {
+        if (word.empty()) {
+            continue;
+        }
+        // Words that differ only in the case of their first letter would
+        // collide once a passphrase is capitalized
+        std::string key = word;
+        if (key[0] >= 'A' && key[0] <= 'Z') {
+            key[0] = static_cast<char>(key[0] - 'A' + 'a');
+        }
+        if (!isValidWord(word) || !seen.insert(key).second) {
+            ++dropped;
+            continue;
+        }
+        text += word;
+        offsets.push_back(text.size());
+        maxWordBytes = std::max(maxWordBytes, word.size());
+    }
+
+    if (skipped) {
+        *skipped = dropped;
+    }
+    if (offsets.size() < 2) {
+        if (error) {
+            *error = "no usable words";
+        }
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.maxWordBytes = static_cast<uint32_t>(maxWordBytes);
+    header.wordCount = offsets.size() - 1;
+    header.textSize = text.size();
+
+    FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        if (error) {
+            *error = "cannot open " + path + " for writing";
+        }
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+        && std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), out) == offsets.size()
+        && std::fwrite(text.data(), 1, text.size(), out) == text.size();
+    ok = std::fclose(out) == 0 && ok;
+
+    if (!ok && error) {
+        *error = "write to " + path + " failed";
+    }
+    return ok;
+}
+
+} // namespace qenqey
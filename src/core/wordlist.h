@@ -0,0 +1,64 @@
+#ifndef QENQEY_CORE_WORDLIST_H
+#define QENQEY_CORE_WORDLIST_H
+
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qenqey {
+
+// Characters that may separate passphrase words. Indexed wordlists never
+// contain them, so a passphrase splits back into its words unambiguously
+// and its entropy is exactly words * log2(size()).
+constexpr char PASSPHRASE_SEPARATORS[] = " -._";
+
+// Passphrase wordlist, memory-mapped from a .qqw index built by
+// qenqey-index: a header, a table of size() + 1 byte offsets and the
+// words back to back. word(i) is two loads, whatever the list size, and
+// opening only checks the offsets in one pass, so no word reaches past
+// the text or beyond maxWordBytes().
+class Wordlist
+{
+public:
+    // Longest word accepted into an index, in bytes
+    static constexpr size_t MAX_WORD_BYTES = 32;
+
+    Wordlist() = default;
+
+    // Installed list, mapped on first call from $QENQEY_WORDLIST or the
+    // data directories. nullptr when none is available.
+    static const Wordlist *shared();
+
+    bool open(const std::string &path);
+    bool isOpen() const { return m_offsets != nullptr; }
+
+    uint64_t size() const { return m_count; }
+    size_t maxWordBytes() const { return m_maxWordBytes; }
+
+    std::string_view word(uint64_t index) const
+    {
+        return std::string_view(reinterpret_cast<const char *>(m_text) + m_offsets[index],
+                                m_offsets[index + 1] - m_offsets[index]);
+    }
+
+private:
+    MappedFile m_file;
+    const uint64_t *m_offsets = nullptr;
+    const uint8_t *m_text = nullptr;
+    uint64_t m_count = 0;
+    size_t m_maxWordBytes = 0;
+};
+
+// Writes a .qqw index. Empty lines are skipped; words that are too long,
+// contain whitespace or a separator, or repeat an earlier word (ignoring
+// the case of the first letter) are dropped and counted in *skipped, so
+// every passphrase has exactly one spelling.
+bool writeWordlistIndex(const std::vector<std::string> &words, const std::string &path,
+                        std::string *error = nullptr, size_t *skipped = nullptr);
+
+} // namespace qenqey
+
+#endif // QENQEY_CORE_WORDLIST_H
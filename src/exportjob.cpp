@@ -0,0 +1,117 @@
+#include "exportjob.h"
+
+#include <QFile>
+#include <QMetaObject>
+#include <QThread>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+ExportJob::ExportJob(QObject *parent)
+    : QObject(parent)
+    , m_done(0)
+    , m_cancel(false)
+    , m_total(0)
+    , m_duplicates(0)
+    , m_breachExhausted(false)
+    , m_uniqueExhausted(false)
+    , m_running(false)
+{
+    m_timer.setInterval(PROGRESS_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, [this] {
+        emit progress(m_done.load(std::memory_order_relaxed), m_total);
+    });
+}
+
+ExportJob::~ExportJob()
+{
+    m_cancel = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool ExportJob::start(std::unique_ptr<qenqey::PasswordSource> source, const QString &path,
+                      const qenqey::BulkOptions &options, QString *error)
+{
+    if (m_running || !source) {
+        return false;
+    }
+
+    const int fd = open(QFile::encodeName(path).constData(),
+                        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        if (error) {
+            *error = QString::fromLocal8Bit(std::strerror(errno));
+        }
+        return false;
+    }
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_source = std::move(source);
+    m_path = path;
+    m_total = options.count;
+    m_error.clear();
+    m_duplicates = 0;
+    m_breachExhausted = false;
+    m_uniqueExhausted = false;
+    m_done = 0;
+    m_cancel = false;
+    m_running = true;
+
+    qenqey::BulkOptions jobOptions = options;
+    // Leave a core for the window
+    jobOptions.threads = static_cast<unsigned>(std::max(1, QThread::idealThreadCount() - 1));
+    jobOptions.progress = &m_done;
+    jobOptions.cancel = &m_cancel;
+
+    m_thread = std::thread([this, fd, jobOptions] {
+        qenqey::BulkEngine engine(*m_source, jobOptions);
+        bool ok = engine.run(fd);
+        if (close(fd) < 0) {
+            ok = false;
+        }
+        const bool cancelled = engine.wasCancelled();
+        const QString error = QString::fromStdString(engine.errorString());
+        const bool breachExhausted = engine.breachExhausted();
+        const bool uniqueExhausted = engine.uniqueExhausted();
+        quint64 duplicates = 0;
+        for (const qenqey::ThreadStats &stats : engine.threadStats()) {
+            duplicates += stats.duplicatesRejected;
+        }
+        QMetaObject::invokeMethod(this, [this, ok, cancelled, error, breachExhausted, uniqueExhausted, duplicates] {
+            m_error = error;
+            m_duplicates = duplicates;
+            m_breachExhausted = breachExhausted;
+            m_uniqueExhausted = uniqueExhausted;
+            finish(ok, cancelled);
+        }, Qt::QueuedConnection);
+    });
+    m_timer.start();
+    return true;
+}
+
+void ExportJob::cancel()
+{
+    m_cancel = true;
+}
+
+void ExportJob::finish(bool ok, bool cancelled)
+{
+    m_timer.stop();
+    m_thread.join();
+    m_source.reset();
+    m_running = false;
+
+    if (!ok) {
+        QFile::remove(m_path);
+    }
+    emit progress(m_done.load(std::memory_order_relaxed), m_total);
+    emit finished(ok, cancelled);
+}
@@ -0,0 +1,76 @@
+#ifndef QENQEY_EXPORTJOB_H
+#define QENQEY_EXPORTJOB_H
+
+#include "core/bulk.h"
+#include "core/source.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Streams a bulk export to a file on a background thread, so even a
+// 100M-password export never blocks the window. Passwords go through
+// BulkEngine chunk by chunk and are never held all at once. Progress is
+// polled a few times a second instead of being signalled per chunk.
+class ExportJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int PROGRESS_INTERVAL_MS = 100;
+
+    explicit ExportJob(QObject *parent = nullptr);
+
+    // Cancels a running export and waits for it
+    ~ExportJob() override;
+
+    bool isRunning() const { return m_running; }
+
+    // Takes ownership of source. options supplies the count, format and
+    // filters; threads, progress and cancellation are managed by the job.
+    // False, with the reason in error, when the file cannot be created. A
+    // file left by a failed or cancelled export is removed.
+    bool start(std::unique_ptr<qenqey::PasswordSource> source, const QString &path,
+               const qenqey::BulkOptions &options, QString *error = nullptr);
+
+    // Why the last export failed, when it was not a write error
+    QString errorString() const { return m_error; }
+
+    // Duplicates regenerated by the last unique export
+    quint64 duplicatesRejected() const { return m_duplicates; }
+
+    // The last export failed because nearly every password it drew was
+    // in the breach corpus
+    bool breachExhausted() const { return m_breachExhausted; }
+
+    // The last unique export failed because it ran out of new passwords
+    bool uniqueExhausted() const { return m_uniqueExhausted; }
+
+    void cancel();
+
+signals:
+    void progress(quint64 done, quint64 total);
+    void finished(bool ok, bool cancelled);
+
+private:
+    void finish(bool ok, bool cancelled);
+
+    std::unique_ptr<qenqey::PasswordSource> m_source;
+    std::thread m_thread;
+    std::atomic<uint64_t> m_done;
+    std::atomic<bool> m_cancel;
+    QTimer m_timer;
+    QString m_path;
+    QString m_error;
+    quint64 m_total;
+    quint64 m_duplicates;
+    bool m_breachExhausted;
+    bool m_uniqueExhausted;
+    bool m_running;
+};
+
+#endif // QENQEY_EXPORTJOB_H
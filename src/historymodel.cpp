@@ -0,0 +1,193 @@
+#include "historymodel.h"
+
+#include "core/settings.h"
+
+#include <QByteArray>
+#include <QDateTime>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+HistoryModel::HistoryModel(int limit, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_entries(std::clamp(limit, 1, MAX_LIMIT))
+    , m_passwords(qenqey::MAX_OUTPUT_BYTES)
+    , m_firstLogged(0)
+{
+}
+
+int HistoryModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return static_cast<int>(m_entries.size());
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    const Entry &entry = m_entries.at(index.row());
+    if (!entry.authentic) {
+        return role == Qt::DisplayRole ? QVariant(QString("[запись повреждена]")) : QVariant();
+    }
+    switch (role) {
+    case Qt::DisplayRole: {
+        // Entries from earlier days, which only the log brings back,
+        // also show the date
+        const QDateTime time = QDateTime::fromMSecsSinceEpoch(entry.time);
+        const QString stamp = time.toString(time.date() == QDate::currentDate() ? "hh:mm:ss" : "dd.MM.yyyy hh:mm:ss");
+        const QString text = password(entry);
+        return QString("[%1] %2 (длина: %3)").arg(stamp, text, QString::number(text.length()));
+    }
+    case Qt::ToolTipRole:
+    case Qt::EditRole:
+        return password(entry);
+    }
+    return QVariant();
+}
+
+QString HistoryModel::password(const Entry &entry) const
+{
+    return QString::fromUtf8(entry.password, static_cast<qsizetype>(entry.size));
+}
+
+bool HistoryModel::openLog(const QString &logPath, const QString &keyPath, QString *error)
+{
+    std::string message;
+    if (!m_log.open(logPath.toStdString(), keyPath.toStdString(), &message)) {
+        if (error) {
+            *error = QString::fromStdString(message);
+        }
+        return false;
+    }
+    m_firstLogged = m_log.size();
+    loadOlder();
+    return true;
+}
+
+bool HistoryModel::canLoadOlder() const
+{
+    return m_log.isOpen() && m_firstLogged > 0 && !m_entries.isFull();
+}
+
+int HistoryModel::loadOlder()
+{
+    if (!canLoadOlder()) {
+        return 0;
+    }
+
+    const quint64 room = m_entries.capacity() - m_entries.size();
+    const quint64 count = std::min<quint64>({qenqey::HistoryLog::PAGE_RECORDS, m_firstLogged, room});
+    const quint64 first = m_firstLogged - count;
+
+    // Decrypted straight into locked slots
+    std::vector<Entry> loaded;
+    loaded.reserve(count);
+    bool ok = m_log.read(first, count, [&](uint64_t, int64_t timeMs, const char *utf8, size_t size) {
+        Entry entry{timeMs, m_passwords.allocate(), 0, utf8 != nullptr};
+        if (entry.password && utf8) {
+            entry.size = std::min(size, m_passwords.slotSize());
+            std::memcpy(entry.password, utf8, entry.size);
+        }
+        loaded.push_back(entry);
+    });
+    ok = ok && loaded.size() == count
+         && std::all_of(loaded.begin(), loaded.end(), [](const Entry &entry) { return entry.password; });
+    if (!ok) {
+        for (const Entry &entry : loaded) {
+            if (entry.password) {
+                m_passwords.release(entry.password);
+            }
+        }
+        return 0;
+    }
+
+    beginInsertRows(QModelIndex(), 0, static_cast<int>(count) - 1);
+    for (auto it = loaded.rbegin(); it != loaded.rend(); ++it) {
+        m_entries.pushFront(*it);
+    }
+    m_firstLogged = first;
+    endInsertRows();
+    return static_cast<int>(count);
+}
+
+void HistoryModel::dropOldest(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        m_passwords.release(m_entries.at(0).password);
+        m_entries.popFront();
+    }
+    m_firstLogged += count;
+}
+
+void HistoryModel::append(const QString &password)
+{
+    QByteArray utf8 = password.toUtf8();
+    append(utf8.constData(), static_cast<size_t>(utf8.size()));
+    qenqey::secureZero(utf8.data(), static_cast<size_t>(utf8.size()));
+}
+
+void HistoryModel::append(const char *utf8, size_t size)
+{
+    if (m_entries.isFull()) {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        dropOldest(1);
+        endRemoveRows();
+    }
+
+    Entry entry{QDateTime::currentMSecsSinceEpoch(), m_passwords.allocate(), 0};
+    if (!entry.password) {
+        return;
+    }
+    entry.size = std::min(size, m_passwords.slotSize());
+    std::memcpy(entry.password, utf8, entry.size);
+
+    if (m_log.isOpen() && !m_log.append(entry.time, entry.password, entry.size)) {
+        // Rows and log indices would no longer line up, so stop logging
+        m_log.close();
+        m_firstLogged = 0;
+        emit logFailed("не удалось записать журнал истории");
+    }
+
+    const int row = rowCount();
+    beginInsertRows(QModelIndex(), row, row);
+    m_entries.push(entry);
+    endInsertRows();
+}
+
+void HistoryModel::clear()
+{
+    beginResetModel();
+    m_entries.clear();
+    m_passwords.reset();
+    m_firstLogged = m_log.size();
+    endResetModel();
+}
+
+int HistoryModel::limit() const
+{
+    return static_cast<int>(m_entries.capacity());
+}
+
+void HistoryModel::setLimit(int limit)
+{
+    limit = std::clamp(limit, 1, MAX_LIMIT);
+    if (limit == this->limit()) {
+        return;
+    }
+
+    const int excess = rowCount() - limit;
+    if (excess > 0) {
+        beginRemoveRows(QModelIndex(), 0, excess - 1);
+        dropOldest(excess);
+        m_entries.setCapacity(limit);
+        endRemoveRows();
+    } else {
+        m_entries.setCapacity(limit);
+    }
+}
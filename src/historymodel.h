@@ -0,0 +1,77 @@
+#ifndef QENQEY_HISTORYMODEL_H
+#define QENQEY_HISTORYMODEL_H
+
+#include "core/historylog.h"
+#include "core/ringbuffer.h"
+#include "core/securememory.h"
+
+#include <QAbstractListModel>
+#include <QString>
+
+// Password history bounded to limit() entries. Backed by a ring buffer,
+// so appending is O(1) however long the session runs, and the display
+// text is only formatted for rows the view actually paints. Passwords
+// live in locked slots of a SecurePool and are wiped when they drop out
+// of the history; only the transient display strings are QStrings.
+//
+// With a log open, every appended password is also written to it, and
+// entries from earlier sessions are read back one page at a time by
+// loadOlder(), up to limit() entries in memory.
+class HistoryModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_LIMIT = 1000;
+    static constexpr int MAX_LIMIT = 1000000;
+
+    explicit HistoryModel(int limit = DEFAULT_LIMIT, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // Opens the persistent log and loads its newest page. Call before
+    // anything is appended.
+    bool openLog(const QString &logPath, const QString &keyPath, QString *error = nullptr);
+    bool isPersistent() const { return m_log.isOpen(); }
+
+    bool canLoadOlder() const;
+
+    // Prepends up to one page of older entries from the log; returns the
+    // number of rows added
+    int loadOlder();
+
+    void append(const QString &password);
+    void append(const char *utf8, size_t size);
+
+    // Empties the view only; the log is append-only
+    void clear();
+
+    int limit() const;
+    void setLimit(int limit);
+
+signals:
+    // Writing to the log failed; it is closed for the rest of the session
+    void logFailed(const QString &message);
+
+private:
+    struct Entry
+    {
+        qint64 time = 0;
+        char *password = nullptr;
+        size_t size = 0;
+        bool authentic = true;
+    };
+
+    QString password(const Entry &entry) const;
+    void dropOldest(int count);
+
+    qenqey::RingBuffer<Entry> m_entries;
+    qenqey::SecurePool m_passwords;
+    qenqey::HistoryLog m_log;
+
+    // Log index of row 0; rows before it are only on disk
+    quint64 m_firstLogged;
+};
+
+#endif // QENQEY_HISTORYMODEL_H
@@ -9,8 +9,10 @@
 #include <QPushButton>
 #include <QSpinBox>
 #include <QCheckBox>
+#include <QComboBox>
+#include <QStackedWidget>
 #include <QGroupBox>
-#include <QTextEdit>
+#include <QListView>
 #include <QClipboard>
 #include <QMessageBox>
 #include <QProgressBar>
@@ -20,11 +22,66 @@
 #include <QAction>
 #include <QIcon>
 #include <QFont>
-#include <QRandomGenerator>
-#include <QDateTime>
-#include <QTextCursor>
 #include <QKeySequence>
 #include <QShortcut>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPalette>
+#include <QEvent>
+#include <QShowEvent>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QFileDialog>
+#include <QScrollBar>
+#include <QStandardPaths>
+#include <QDir>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLocale>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "auditjob.h"
+#include "cli.h"
+#include "exportjob.h"
+#include "historymodel.h"
+#include "startuptrace.h"
+#include "strength.h"
+#include "strengthevaluator.h"
+#include "core/breach.h"
+#include "core/constrained.h"
+#include "core/generator.h"
+#include "core/markov.h"
+#include "core/metrics.h"
+#include "core/passphrase.h"
+#include "core/policy.h"
+#include "core/pronounceable.h"
+#include "core/random.h"
+#include "core/securememory.h"
+#include "core/template.h"
+#include "core/token.h"
+#include "core/wordlist.h"
+
+// Strength bar tiers: scores below the bound get this label and colour
+struct StrengthTier
+{
+    int below;
+    const char *label;
+    QRgb color;
+};
+
+static const StrengthTier STRENGTH_TIERS[] = {
+    {25, "Очень слабый", 0xd32f2f},
+    {50, "Слабый", 0xf57c00},
+    {75, "Средний", 0xfbc02d},
+    {90, "Хороший", 0x689f38},
+    {101, "Отличный", 0x388e3c},
+};
+static const int STRENGTH_TIER_COUNT = sizeof(STRENGTH_TIERS) / sizeof(STRENGTH_TIERS[0]);
 
 class QenQeyMainWindow : public QMainWindow
 {
@@ -34,27 +91,63 @@ public:
     QenQeyMainWindow(QWidget *parent = nullptr);
     ~QenQeyMainWindow();
 
+protected:
+    void showEvent(QShowEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void generatePassword();
     void copyToClipboard();
     void lengthSliderChanged(int value);
     void lengthSpinChanged(int value);
     void updatePasswordStrength();
+    void showStrength(const StrengthEvaluator::Result &result);
     void showAbout();
+    void showStatistics();
     void clearPassword();
     void onCharacterTypeChanged();
+    void onModeChanged(int index);
+    void onTemplateChanged();
+    void flushUpdates();
+    void commitPreview();
+    void loadOlderHistory(int scrollValue);
+    void historyLimitChanged(int value);
+    void finishStartup();
+    void exportPasswords();
+    void showExportProgress(quint64 done, quint64 total);
+    void exportFinished(bool ok, bool cancelled);
+    void auditPasswordFile();
+    void showAuditProgress(quint64 done, quint64 total);
+    void auditFinished(bool ok, bool cancelled);
 
 private:
     void setupUI();
     void setupMenuBar();
     void setupShortcuts();
-    QString generateRandomPassword();
-    int calculatePasswordStrength(const QString &password);
+    void setupHistory();
+    void openHistoryLog();
+    void loadIcons();
+    size_t generateRandomPassword();
+    size_t showNewPassword();
+    void commitPassword(size_t length);
+    void scheduleUpdate(unsigned updates);
     void updateStrengthIndicator(int strength);
+    qenqey::GeneratorSettings currentSettings() const;
+    qenqey::CharacterRules currentRules() const;
+    qenqey::PassphraseSettings currentPassphraseSettings() const;
+    qenqey::PronounceableSettings currentPronounceableSettings() const;
+    qenqey::TokenSettings currentTokenSettings() const;
+    const qenqey::PasswordSource &currentSource() const;
+    qenqey::Policy currentPolicy() const;
+    void updatePlan();
+    void updateTemplatePlan();
+    void updateConstrainedPlan();
+    void showAuditReport(const qenqey::AuditReport &report);
 
     
     // UI Elements
     QWidget *m_centralWidget;
+    QVBoxLayout *m_mainLayout;
     QLineEdit *m_passwordLineEdit;
     QPushButton *m_generateButton;
     QPushButton *m_copyButton;
@@ -66,44 +159,129 @@ private:
     QCheckBox *m_numbersCheckBox;
     QCheckBox *m_symbolsCheckBox;
     QCheckBox *m_excludeSimilarCheckBox;
+    QGroupBox *m_rulesGroup;
+    QSpinBox *m_minimumSpinBoxes[qenqey::CLASS_COUNT];
+    QSpinBox *m_maxRepeatSpinBox;
+    QSpinBox *m_maxSequenceSpinBox;
+    QLineEdit *m_bannedFirstLineEdit;
+    QLabel *m_rulesErrorLabel;
+    QComboBox *m_modeComboBox;
+    QStackedWidget *m_modeStack;
+    QSpinBox *m_wordsSpinBox;
+    QComboBox *m_separatorComboBox;
+    QCheckBox *m_capitalizeCheckBox;
+    QLineEdit *m_templateLineEdit;
+    QLabel *m_templateErrorLabel;
+    QSpinBox *m_pronounceableLengthSpinBox;
+    QComboBox *m_tokenEncodingComboBox;
+    QSpinBox *m_tokenBytesSpinBox;
+    QLabel *m_entropyLabel;
     QProgressBar *m_strengthBar;
     QLabel *m_strengthLabel;
-    QTextEdit *m_historyTextEdit;
+    QLabel *m_breachLabel;
+    QLabel *m_passwordEntropyLabel;
+    StrengthEvaluator *m_strengthEvaluator;
+    QListView *m_historyView;
+    HistoryModel *m_historyModel;
+    QSpinBox *m_historyLimitSpinBox;
     QLabel *m_lengthLabel;
     
     // Menu and actions
     QAction *m_aboutAction;
+    QAction *m_statisticsAction;
     QAction *m_exitAction;
     QAction *m_generateAction;
     QAction *m_copyAction;
     QAction *m_clearAction;
-    
-    // Password generation settings
-    static const QString UPPERCASE_CHARS;
-    static const QString LOWERCASE_CHARS;
-    static const QString NUMBER_CHARS;
-    static const QString SYMBOL_CHARS;
-    static const QString SIMILAR_CHARS;
-};
+    QAction *m_exportAction;
+    QAction *m_auditAction;
 
-const QString QenQeyMainWindow::UPPERCASE_CHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-const QString QenQeyMainWindow::LOWERCASE_CHARS = "abcdefghijklmnopqrstuvwxyz";
-const QString QenQeyMainWindow::NUMBER_CHARS = "0123456789";
-const QString QenQeyMainWindow::SYMBOL_CHARS = "!@#$%^&*()_+-=[]{}|;:,.<>?";
-const QString QenQeyMainWindow::SIMILAR_CHARS = "il1Lo0O";
+    // Background export and its status bar controls, created on first use
+    ExportJob *m_exportJob;
+    QProgressBar *m_exportProgress;
+    QPushButton *m_exportCancelButton;
+
+    // Background file audit, likewise created on first use
+    AuditJob *m_auditJob;
+    QProgressBar *m_auditProgress;
+    QPushButton *m_auditCancelButton;
+    
+    // Settings changes are coalesced into at most one plan rebuild and
+    // regeneration per frame; see scheduleUpdate()
+    enum PendingUpdate : unsigned {
+        PlanUpdate = 1,
+        RegenerateUpdate = 2,
+    };
+    static constexpr int FRAME_MS = 16;
+    QTimer m_updateTimer;
+    QElapsedTimer m_sinceUpdate;
+    unsigned m_pendingUpdates;
+
+    // Length of a password shown while the slider is dragged; it goes to
+    // history only once the slider is released
+    size_t m_previewLength;
+
+    // Built once, so a tier change swaps a palette instead of parsing and
+    // re-polishing a style sheet
+    QPalette m_strengthPalettes[STRENGTH_TIER_COUNT];
+    int m_strengthTier;
+    QPalette m_breachPalettes[2];
+    int m_breachState;
+
+    // Password generation; the plan is rebuilt only when settings change
+    qenqey::CharsetPlan m_plan;
+    qenqey::ConstrainedPlan m_constrained;
+    qenqey::PassphrasePlan m_passphrase;
+    qenqey::TemplatePlan m_template;
+    qenqey::PronounceablePlan m_pronounceable;
+    qenqey::TokenPlan m_token;
+
+    // Locked scratch buffer the generator writes into; wiped after use
+    qenqey::SecureArena m_secrets;
+    char *m_passwordBuffer;
+
+    // The last generation gave up because every candidate was breached
+    bool m_breachExhausted;
+
+    // Menus, history view and icons are built after the first show
+    bool m_startupFinished;
+};
 
 QenQeyMainWindow::QenQeyMainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_centralWidget(nullptr)
+    , m_mainLayout(nullptr)
+    , m_historyView(nullptr)
+    , m_historyLimitSpinBox(nullptr)
+    , m_exportJob(nullptr)
+    , m_exportProgress(nullptr)
+    , m_exportCancelButton(nullptr)
+    , m_auditJob(nullptr)
+    , m_auditProgress(nullptr)
+    , m_auditCancelButton(nullptr)
+    , m_pendingUpdates(0)
+    , m_previewLength(0)
+    , m_strengthTier(-1)
+    , m_breachState(-1)
+    , m_secrets(qenqey::MAX_OUTPUT_BYTES)
+    , m_passwordBuffer(m_secrets.allocate(qenqey::MAX_OUTPUT_BYTES))
+    , m_breachExhausted(false)
+    , m_startupFinished(false)
 {
     setWindowTitle("QenQey - Генератор паролей");
-    setWindowIcon(QIcon::fromTheme("preferences-system-privacy"));
     setMinimumSize(500, 650);
     resize(600, 750);
     
-    setupMenuBar();
+    // Only what the first password needs is built before the window is
+    // shown; see finishStartup() for the rest
     setupUI();
     setupShortcuts();
+    StartupTrace::mark("окно: интерфейс");
+    openHistoryLog();
+    StartupTrace::mark("окно: журнал истории");
+
+    m_strengthEvaluator = new StrengthEvaluator(this);
+    connect(m_strengthEvaluator, &StrengthEvaluator::evaluated, this, &QenQeyMainWindow::showStrength);
     
     // Connect signals
     connect(m_generateButton, &QPushButton::clicked, this, &QenQeyMainWindow::generatePassword);
@@ -111,6 +289,7 @@ QenQeyMainWindow::QenQeyMainWindow(QWidget *parent)
     connect(m_clearButton, &QPushButton::clicked, this, &QenQeyMainWindow::clearPassword);
     connect(m_lengthSlider, &QSlider::valueChanged, this, &QenQeyMainWindow::lengthSliderChanged);
     connect(m_lengthSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::lengthSpinChanged);
+    connect(m_lengthSlider, &QSlider::sliderReleased, this, &QenQeyMainWindow::commitPreview);
     connect(m_passwordLineEdit, &QLineEdit::textChanged, this, &QenQeyMainWindow::updatePasswordStrength);
     
     // Connect character type checkboxes
@@ -119,6 +298,27 @@ QenQeyMainWindow::QenQeyMainWindow(QWidget *parent)
     connect(m_numbersCheckBox, &QCheckBox::toggled, this, &QenQeyMainWindow::onCharacterTypeChanged);
     connect(m_symbolsCheckBox, &QCheckBox::toggled, this, &QenQeyMainWindow::onCharacterTypeChanged);
     connect(m_excludeSimilarCheckBox, &QCheckBox::toggled, this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_rulesGroup, &QGroupBox::toggled, this, &QenQeyMainWindow::onCharacterTypeChanged);
+    for (QSpinBox *spinBox : m_minimumSpinBoxes) {
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    }
+    connect(m_maxRepeatSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_maxSequenceSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_bannedFirstLineEdit, &QLineEdit::textChanged, this, &QenQeyMainWindow::onCharacterTypeChanged);
+
+    // Passphrase options rebuild the plan the same way
+    connect(m_modeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QenQeyMainWindow::onModeChanged);
+    connect(m_wordsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_separatorComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_capitalizeCheckBox, &QCheckBox::toggled, this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_templateLineEdit, &QLineEdit::textChanged, this, &QenQeyMainWindow::onTemplateChanged);
+    connect(m_pronounceableLengthSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_tokenEncodingComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+    connect(m_tokenBytesSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::onCharacterTypeChanged);
+
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_updateTimer, &QTimer::timeout, this, &QenQeyMainWindow::flushUpdates);
     
     // Set initial values
     m_lengthSlider->setValue(16);
@@ -130,14 +330,73 @@ QenQeyMainWindow::QenQeyMainWindow(QWidget *parent)
     m_symbolsCheckBox->setChecked(false);
     m_excludeSimilarCheckBox->setChecked(false);
     
-    // Generate initial password
+    // Generate initial password; the updates queued by the initial
+    // values above are covered by it
+    m_updateTimer.stop();
+    m_pendingUpdates = 0;
+    updatePlan();
     generatePassword();
+    StartupTrace::mark("окно: первый пароль");
+
+    if (StartupTrace::isEnabled()) {
+        m_passwordLineEdit->installEventFilter(this);
+    }
 }
 
 QenQeyMainWindow::~QenQeyMainWindow()
 {
 }
 
+void QenQeyMainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+
+    // Queued behind the first paint, so the password is on screen before
+    // the deferred parts are built
+    if (!m_startupFinished) {
+        QTimer::singleShot(0, this, &QenQeyMainWindow::finishStartup);
+    }
+}
+
+bool QenQeyMainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_passwordLineEdit && event->type() == QEvent::Paint) {
+        StartupTrace::mark("первая отрисовка");
+        m_passwordLineEdit->removeEventFilter(this);
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void QenQeyMainWindow::finishStartup()
+{
+    if (m_startupFinished) {
+        return;
+    }
+    m_startupFinished = true;
+
+    setupMenuBar();
+    StartupTrace::mark("отложено: меню");
+    setupHistory();
+    StartupTrace::mark("отложено: история");
+    loadIcons();
+    StartupTrace::mark("отложено: значки");
+}
+
+void QenQeyMainWindow::loadIcons()
+{
+    // Theme lookups read the icon theme index from disk, so none of them
+    // happen before the first password is shown
+    setWindowIcon(QIcon::fromTheme("preferences-system-privacy"));
+    m_generateButton->setIcon(QIcon::fromTheme("view-refresh"));
+    m_copyButton->setIcon(QIcon::fromTheme("edit-copy"));
+    m_clearButton->setIcon(QIcon::fromTheme("edit-clear"));
+    m_generateAction->setIcon(m_generateButton->icon());
+    m_copyAction->setIcon(m_copyButton->icon());
+    m_clearAction->setIcon(m_clearButton->icon());
+    m_exitAction->setIcon(QIcon::fromTheme("application-exit"));
+    m_aboutAction->setIcon(QIcon::fromTheme("help-about"));
+}
+
 void QenQeyMainWindow::setupMenuBar()
 {
     QMenuBar *menuBar = this->menuBar();
@@ -147,13 +406,11 @@ void QenQeyMainWindow::setupMenuBar()
     
     m_generateAction = new QAction("&Сгенерировать пароль", this);
     m_generateAction->setShortcut(QKeySequence("Ctrl+G"));
-    m_generateAction->setIcon(QIcon::fromTheme("view-refresh"));
     connect(m_generateAction, &QAction::triggered, this, &QenQeyMainWindow::generatePassword);
     fileMenu->addAction(m_generateAction);
     
     m_copyAction = new QAction("&Копировать пароль", this);
     m_copyAction->setShortcut(QKeySequence::Copy);
-    m_copyAction->setIcon(QIcon::fromTheme("edit-copy"));
     connect(m_copyAction, &QAction::triggered, this, &QenQeyMainWindow::copyToClipboard);
     fileMenu->addAction(m_copyAction);
     
@@ -161,15 +418,25 @@ void QenQeyMainWindow::setupMenuBar()
     
     m_clearAction = new QAction("&Очистить историю", this);
     m_clearAction->setShortcut(QKeySequence("Ctrl+L"));
-    m_clearAction->setIcon(QIcon::fromTheme("edit-clear"));
     connect(m_clearAction, &QAction::triggered, this, &QenQeyMainWindow::clearPassword);
     fileMenu->addAction(m_clearAction);
     
     fileMenu->addSeparator();
     
+    m_exportAction = new QAction("&Экспорт паролей в файл...", this);
+    m_exportAction->setShortcut(QKeySequence("Ctrl+E"));
+    connect(m_exportAction, &QAction::triggered, this, &QenQeyMainWindow::exportPasswords);
+    fileMenu->addAction(m_exportAction);
+    
+    m_auditAction = new QAction("&Аудит файла паролей...", this);
+    m_auditAction->setShortcut(QKeySequence("Ctrl+Shift+A"));
+    connect(m_auditAction, &QAction::triggered, this, &QenQeyMainWindow::auditPasswordFile);
+    fileMenu->addAction(m_auditAction);
+    
+    fileMenu->addSeparator();
+    
     m_exitAction = new QAction("&Выход", this);
     m_exitAction->setShortcut(QKeySequence::Quit);
-    m_exitAction->setIcon(QIcon::fromTheme("application-exit"));
     connect(m_exitAction, &QAction::triggered, this, &QWidget::close);
     fileMenu->addAction(m_exitAction);
     
@@ -177,9 +444,14 @@ void QenQeyMainWindow::setupMenuBar()
     QMenu *helpMenu = menuBar->addMenu("&Помощь");
     
     m_aboutAction = new QAction("&О программе", this);
-    m_aboutAction->setIcon(QIcon::fromTheme("help-about"));
     connect(m_aboutAction, &QAction::triggered, this, &QenQeyMainWindow::showAbout);
     helpMenu->addAction(m_aboutAction);
+    
+    // Diagnostics; not mentioned anywhere else in the interface
+    m_statisticsAction = new QAction("&Статистика...", this);
+    m_statisticsAction->setShortcut(QKeySequence("Ctrl+Shift+F12"));
+    connect(m_statisticsAction, &QAction::triggered, this, &QenQeyMainWindow::showStatistics);
+    helpMenu->addAction(m_statisticsAction);
 }
 
 void QenQeyMainWindow::setupShortcuts()
@@ -197,9 +469,9 @@ void QenQeyMainWindow::setupUI()
     m_centralWidget = new QWidget;
     setCentralWidget(m_centralWidget);
     
-    QVBoxLayout *mainLayout = new QVBoxLayout(m_centralWidget);
-    mainLayout->setSpacing(16);
-    mainLayout->setContentsMargins(16, 16, 16, 16);
+    m_mainLayout = new QVBoxLayout(m_centralWidget);
+    m_mainLayout->setSpacing(16);
+    m_mainLayout->setContentsMargins(16, 16, 16, 16);
     
     // Title section
     QWidget *titleWidget = new QWidget;
@@ -220,7 +492,7 @@ void QenQeyMainWindow::setupUI()
     subtitleLabel->setStyleSheet("color: #666; font-size: 14px; margin-bottom: 8px;");
     titleLayout->addWidget(subtitleLabel);
     
-    mainLayout->addWidget(titleWidget);
+    m_mainLayout->addWidget(titleWidget);
     
     // Password output section
     QGroupBox *passwordGroup = new QGroupBox("Сгенерированный пароль");
@@ -247,11 +519,33 @@ void QenQeyMainWindow::setupUI()
     m_strengthBar->setTextVisible(false);
     m_strengthBar->setMinimumHeight(20);
     strengthLayout->addWidget(m_strengthBar);
+    for (int tier = 0; tier < STRENGTH_TIER_COUNT; ++tier) {
+        m_strengthPalettes[tier] = m_strengthBar->palette();
+        m_strengthPalettes[tier].setColor(QPalette::Highlight, QColor(STRENGTH_TIERS[tier].color));
+    }
     
     m_strengthLabel = new QLabel("Отлично");
     m_strengthLabel->setMinimumWidth(80);
     m_strengthLabel->setAlignment(Qt::AlignCenter);
     strengthLayout->addWidget(m_strengthLabel);
+
+    // Only shown when a breach corpus is installed
+    m_breachLabel = new QLabel;
+    m_breachLabel->setAlignment(Qt::AlignCenter);
+    m_breachLabel->setVisible(false);
+    strengthLayout->addWidget(m_breachLabel);
+    m_breachPalettes[0] = m_breachLabel->palette();
+    m_breachPalettes[0].setColor(QPalette::WindowText, QColor(0x388e3c));
+    m_breachPalettes[1] = m_breachLabel->palette();
+    m_breachPalettes[1].setColor(QPalette::WindowText, QColor(0xd32f2f));
+
+    // Exact information content of a pronounceable password, which the
+    // bar's estimate cannot know; only shown in that mode
+    m_passwordEntropyLabel = new QLabel;
+    m_passwordEntropyLabel->setAlignment(Qt::AlignCenter);
+    m_passwordEntropyLabel->setStyleSheet("color: #666;");
+    m_passwordEntropyLabel->setVisible(false);
+    strengthLayout->addWidget(m_passwordEntropyLabel);
     
     passwordLayout->addLayout(strengthLayout);
     
@@ -262,28 +556,51 @@ void QenQeyMainWindow::setupUI()
     m_generateButton = new QPushButton("Сгенерировать");
     m_generateButton->setDefault(true);
     m_generateButton->setMinimumHeight(40);
-    m_generateButton->setIcon(QIcon::fromTheme("view-refresh"));
     
     m_copyButton = new QPushButton("Копировать");
     m_copyButton->setMinimumHeight(40);
-    m_copyButton->setIcon(QIcon::fromTheme("edit-copy"));
     
     m_clearButton = new QPushButton("Очистить");
     m_clearButton->setMinimumHeight(40);
-    m_clearButton->setIcon(QIcon::fromTheme("edit-clear"));
     
     buttonLayout->addWidget(m_generateButton);
     buttonLayout->addWidget(m_copyButton);
     buttonLayout->addWidget(m_clearButton);
     
     passwordLayout->addLayout(buttonLayout);
-    mainLayout->addWidget(passwordGroup);
+    m_mainLayout->addWidget(passwordGroup);
     
     // Settings section
     QGroupBox *settingsGroup = new QGroupBox("Настройки генерации");
     QVBoxLayout *settingsLayout = new QVBoxLayout(settingsGroup);
     settingsLayout->setSpacing(12);
     
+    // Generation mode; each mode has its own page of options
+    QHBoxLayout *modeLayout = new QHBoxLayout;
+    modeLayout->setSpacing(8);
+    
+    QLabel *modeTextLabel = new QLabel("Режим:");
+    modeTextLabel->setMinimumWidth(100);
+    modeLayout->addWidget(modeTextLabel);
+    
+    m_modeComboBox = new QComboBox;
+    m_modeComboBox->addItem("Символы");
+    m_modeComboBox->addItem("Парольная фраза");
+    m_modeComboBox->addItem("Шаблон");
+    m_modeComboBox->addItem("Произносимый");
+    m_modeComboBox->addItem("Токен");
+    modeLayout->addWidget(m_modeComboBox);
+    modeLayout->addStretch();
+    
+    settingsLayout->addLayout(modeLayout);
+    
+    m_modeStack = new QStackedWidget;
+    
+    QWidget *charsetPage = new QWidget;
+    QVBoxLayout *charsetLayout = new QVBoxLayout(charsetPage);
+    charsetLayout->setSpacing(12);
+    charsetLayout->setContentsMargins(0, 0, 0, 0);
+    
     // Length settings
     QHBoxLayout *lengthLayout = new QHBoxLayout;
     lengthLayout->setSpacing(8);
@@ -308,7 +625,7 @@ void QenQeyMainWindow::setupUI()
     m_lengthLabel->setAlignment(Qt::AlignCenter);
     lengthLayout->addWidget(m_lengthLabel);
     
-    settingsLayout->addLayout(lengthLayout);
+    charsetLayout->addLayout(lengthLayout);
     
     // Character type checkboxes
     QGridLayout *checkboxLayout = new QGridLayout;
@@ -326,139 +643,873 @@ void QenQeyMainWindow::setupUI()
     checkboxLayout->addWidget(m_symbolsCheckBox, 1, 1);
     checkboxLayout->addWidget(m_excludeSimilarCheckBox, 2, 0, 1, 2);
     
-    settingsLayout->addLayout(checkboxLayout);
-    mainLayout->addWidget(settingsGroup);
-    
-    // History section
-    QGroupBox *historyGroup = new QGroupBox("История паролей");
-    QVBoxLayout *historyLayout = new QVBoxLayout(historyGroup);
-    
-    m_historyTextEdit = new QTextEdit;
-    m_historyTextEdit->setMaximumHeight(120);
-    m_historyTextEdit->setReadOnly(true);
-    m_historyTextEdit->setFont(QFont("monospace", 9));
-    m_historyTextEdit->setStyleSheet("QTextEdit { border: 1px solid #ddd; border-radius: 4px; }");
-    historyLayout->addWidget(m_historyTextEdit);
-    
-    mainLayout->addWidget(historyGroup);
+    charsetLayout->addLayout(checkboxLayout);
+    
+    // Optional rules; with them on, passwords come from the constrained plan
+    m_rulesGroup = new QGroupBox("Дополнительные правила");
+    m_rulesGroup->setCheckable(true);
+    m_rulesGroup->setChecked(false);
+    QGridLayout *rulesLayout = new QGridLayout(m_rulesGroup);
+    rulesLayout->setSpacing(8);
+    
+    rulesLayout->addWidget(new QLabel("Минимум символов:"), 0, 0);
+    const char *const minimumPrefixes[qenqey::CLASS_COUNT] = {"A-Z: ", "a-z: ", "0-9: ", "!@#: "};
+    QHBoxLayout *minimumLayout = new QHBoxLayout;
+    minimumLayout->setSpacing(8);
+    for (int cls = 0; cls < qenqey::CLASS_COUNT; ++cls) {
+        m_minimumSpinBoxes[cls] = new QSpinBox;
+        m_minimumSpinBoxes[cls]->setRange(0, qenqey::MAX_PASSWORD_LENGTH);
+        m_minimumSpinBoxes[cls]->setValue(1);
+        m_minimumSpinBoxes[cls]->setPrefix(minimumPrefixes[cls]);
+        minimumLayout->addWidget(m_minimumSpinBoxes[cls]);
+    }
+    minimumLayout->addStretch();
+    rulesLayout->addLayout(minimumLayout, 0, 1);
+    
+    rulesLayout->addWidget(new QLabel("Одинаковых подряд, не больше:"), 1, 0);
+    m_maxRepeatSpinBox = new QSpinBox;
+    m_maxRepeatSpinBox->setRange(0, qenqey::MAX_RULE_RUN);
+    m_maxRepeatSpinBox->setSpecialValueText("без ограничения");
+    rulesLayout->addWidget(m_maxRepeatSpinBox, 1, 1, Qt::AlignLeft);
+    
+    rulesLayout->addWidget(new QLabel("По возрастанию подряд (abc, 123), не больше:"), 2, 0);
+    m_maxSequenceSpinBox = new QSpinBox;
+    m_maxSequenceSpinBox->setRange(0, qenqey::MAX_RULE_RUN);
+    m_maxSequenceSpinBox->setSpecialValueText("без ограничения");
+    rulesLayout->addWidget(m_maxSequenceSpinBox, 2, 1, Qt::AlignLeft);
+    
+    rulesLayout->addWidget(new QLabel("Не начинать с:"), 3, 0);
+    m_bannedFirstLineEdit = new QLineEdit;
+    m_bannedFirstLineEdit->setFont(QFont("monospace", 10));
+    m_bannedFirstLineEdit->setPlaceholderText("например 0!");
+    rulesLayout->addWidget(m_bannedFirstLineEdit, 3, 1);
+    
+    m_rulesErrorLabel = new QLabel;
+    m_rulesErrorLabel->setStyleSheet("color: #c62828;");
+    m_rulesErrorLabel->hide();
+    rulesLayout->addWidget(m_rulesErrorLabel, 4, 0, 1, 2);
+    
+    charsetLayout->addWidget(m_rulesGroup);
+    m_modeStack->addWidget(charsetPage);
+    
+    // Passphrase settings
+    QWidget *passphrasePage = new QWidget;
+    QGridLayout *passphraseLayout = new QGridLayout(passphrasePage);
+    passphraseLayout->setSpacing(8);
+    passphraseLayout->setContentsMargins(0, 0, 0, 0);
+    
+    QLabel *wordsTextLabel = new QLabel("Количество слов:");
+    wordsTextLabel->setMinimumWidth(100);
+    passphraseLayout->addWidget(wordsTextLabel, 0, 0);
+    
+    m_wordsSpinBox = new QSpinBox;
+    m_wordsSpinBox->setRange(qenqey::MIN_PASSPHRASE_WORDS, qenqey::MAX_PASSPHRASE_WORDS);
+    m_wordsSpinBox->setValue(qenqey::PassphraseSettings().words);
+    passphraseLayout->addWidget(m_wordsSpinBox, 0, 1);
+    
+    passphraseLayout->addWidget(new QLabel("Разделитель:"), 1, 0);
+    m_separatorComboBox = new QComboBox;
+    m_separatorComboBox->addItem("Дефис (-)", QChar('-'));
+    m_separatorComboBox->addItem("Пробел", QChar(' '));
+    m_separatorComboBox->addItem("Точка (.)", QChar('.'));
+    m_separatorComboBox->addItem("Подчёркивание (_)", QChar('_'));
+    passphraseLayout->addWidget(m_separatorComboBox, 1, 1);
+    
+    m_capitalizeCheckBox = new QCheckBox("Слова с заглавной буквы");
+    passphraseLayout->addWidget(m_capitalizeCheckBox, 2, 0, 1, 2);
+    passphraseLayout->setColumnStretch(2, 1);
+    m_modeStack->addWidget(passphrasePage);
+    
+    // Template settings
+    QWidget *templatePage = new QWidget;
+    QVBoxLayout *templateLayout = new QVBoxLayout(templatePage);
+    templateLayout->setSpacing(8);
+    templateLayout->setContentsMargins(0, 0, 0, 0);
+    
+    QHBoxLayout *patternLayout = new QHBoxLayout;
+    patternLayout->setSpacing(8);
+    QLabel *patternTextLabel = new QLabel("Шаблон:");
+    patternTextLabel->setMinimumWidth(100);
+    patternLayout->addWidget(patternTextLabel);
+    
+    m_templateLineEdit = new QLineEdit(qenqey::DEFAULT_TEMPLATE);
+    m_templateLineEdit->setFont(QFont("monospace", 10));
+    m_templateLineEdit->setMaxLength(static_cast<int>(qenqey::MAX_OUTPUT_BYTES));
+    patternLayout->addWidget(m_templateLineEdit);
+    templateLayout->addLayout(patternLayout);
+    
+    QLabel *syntaxLabel = new QLabel("A - заглавная, a - строчная, 9 - цифра, s - символ, x - буква или цифра, "
+                                     "* - любой, [abc] или [0-9a-f] - из набора, w/W - слово, {n} - повторить, "
+                                     "\\c - сам символ c; остальные символы выводятся как есть");
+    syntaxLabel->setWordWrap(true);
+    syntaxLabel->setStyleSheet("color: #666;");
+    templateLayout->addWidget(syntaxLabel);
+    
+    m_templateErrorLabel = new QLabel;
+    m_templateErrorLabel->setStyleSheet("color: #c62828;");
+    m_templateErrorLabel->hide();
+    templateLayout->addWidget(m_templateErrorLabel);
+    m_modeStack->addWidget(templatePage);
+    
+    // Pronounceable settings
+    QWidget *pronounceablePage = new QWidget;
+    QGridLayout *pronounceableLayout = new QGridLayout(pronounceablePage);
+    pronounceableLayout->setSpacing(8);
+    pronounceableLayout->setContentsMargins(0, 0, 0, 0);
+    
+    QLabel *lettersTextLabel = new QLabel("Количество букв:");
+    lettersTextLabel->setMinimumWidth(100);
+    pronounceableLayout->addWidget(lettersTextLabel, 0, 0);
+    
+    m_pronounceableLengthSpinBox = new QSpinBox;
+    m_pronounceableLengthSpinBox->setRange(qenqey::MIN_PASSWORD_LENGTH, qenqey::MAX_PASSWORD_LENGTH);
+    m_pronounceableLengthSpinBox->setValue(qenqey::PronounceableSettings().length);
+    pronounceableLayout->addWidget(m_pronounceableLengthSpinBox, 0, 1);
+    
+    QLabel *pronounceableHintLabel = new QLabel("Строчные буквы, следующие друг за другом как в словах. "
+                                                "Буква несёт около трёх бит, поэтому пароль длиннее обычного.");
+    pronounceableHintLabel->setWordWrap(true);
+    pronounceableHintLabel->setStyleSheet("color: #666;");
+    pronounceableLayout->addWidget(pronounceableHintLabel, 1, 0, 1, 3);
+    pronounceableLayout->setColumnStretch(2, 1);
+    m_modeStack->addWidget(pronounceablePage);
+    
+    // Token settings
+    QWidget *tokenPage = new QWidget;
+    QGridLayout *tokenLayout = new QGridLayout(tokenPage);
+    tokenLayout->setSpacing(8);
+    tokenLayout->setContentsMargins(0, 0, 0, 0);
+    
+    QLabel *encodingTextLabel = new QLabel("Кодировка:");
+    encodingTextLabel->setMinimumWidth(100);
+    tokenLayout->addWidget(encodingTextLabel, 0, 0);
+    
+    m_tokenEncodingComboBox = new QComboBox;
+    m_tokenEncodingComboBox->addItem("Hex", static_cast<int>(qenqey::TokenEncoding::Hex));
+    m_tokenEncodingComboBox->addItem("Base64url", static_cast<int>(qenqey::TokenEncoding::Base64Url));
+    m_tokenEncodingComboBox->addItem("Base32", static_cast<int>(qenqey::TokenEncoding::Base32));
+    m_tokenEncodingComboBox->addItem("Base32 (Crockford)", static_cast<int>(qenqey::TokenEncoding::Crockford));
+    m_tokenEncodingComboBox->addItem("UUID v4", static_cast<int>(qenqey::TokenEncoding::Uuid));
+    tokenLayout->addWidget(m_tokenEncodingComboBox, 0, 1);
+    
+    tokenLayout->addWidget(new QLabel("Случайных байт:"), 1, 0);
+    m_tokenBytesSpinBox = new QSpinBox;
+    m_tokenBytesSpinBox->setRange(qenqey::MIN_TOKEN_BYTES, qenqey::MAX_TOKEN_BYTES);
+    m_tokenBytesSpinBox->setValue(qenqey::TokenSettings().bytes);
+    tokenLayout->addWidget(m_tokenBytesSpinBox, 1, 1);
+    tokenLayout->setColumnStretch(2, 1);
+    m_modeStack->addWidget(tokenPage);
+    
+    settingsLayout->addWidget(m_modeStack);
+    
+    m_entropyLabel = new QLabel;
+    m_entropyLabel->setStyleSheet("color: #666;");
+    settingsLayout->addWidget(m_entropyLabel);
+    
+    m_mainLayout->addWidget(settingsGroup);
+    
+    // The model exists from the start so early passwords are kept; its
+    // view is built by setupHistory() once the window is shown
+    m_historyModel = new HistoryModel(HistoryModel::DEFAULT_LIMIT, this);
     
     // Status bar
     statusBar()->showMessage("Готов к генерации паролей");
     statusBar()->setStyleSheet("QStatusBar { border-top: 1px solid #ddd; }");
 }
 
-void QenQeyMainWindow::generatePassword()
+void QenQeyMainWindow::openHistoryLog()
 {
-    QString password = generateRandomPassword();
-    
-    if (password.isEmpty()) {
-        QMessageBox::warning(this, "Предупреждение", 
-                           "Необходимо выбрать хотя бы один тип символов!");
+    // QENQEY_HISTORY_DIR keeps everything in one place, e.g. for tests;
+    // otherwise the key sits apart from the log, so a copy of the data
+    // directory alone does not reveal the passwords
+    QString logDir = qEnvironmentVariable("QENQEY_HISTORY_DIR");
+    QString keyDir = logDir;
+    if (logDir.isEmpty()) {
+        logDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        keyDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    }
+    QString error;
+    if (!QDir().mkpath(logDir) || !QDir().mkpath(keyDir)
+        || !m_historyModel->openLog(logDir + "/history.qqh", keyDir + "/history.key", &error)) {
+        statusBar()->showMessage("История не сохраняется между запусками: " + error, 10000);
+    }
+    connect(m_historyModel, &HistoryModel::logFailed, this, [this](const QString &message) {
+        statusBar()->showMessage("История не сохраняется: " + message, 10000);
+    });
+}
+
+void QenQeyMainWindow::loadOlderHistory(int scrollValue)
+{
+    if (scrollValue != m_historyView->verticalScrollBar()->minimum() || !m_historyModel->canLoadOlder()) {
         return;
     }
     
-    m_passwordLineEdit->setText(password);
-    
-    // Add to history
-    QString timestamp = QDateTime::currentDateTime().toString("hh:mm:ss");
-    QString historyEntry = QString("[%1] %2 (длина: %3)")
-                          .arg(timestamp, password, QString::number(password.length()));
-    m_historyTextEdit->append(historyEntry);
+    // Keeps the row that was at the top in place above the new ones
+    const int loaded = m_historyModel->loadOlder();
+    if (loaded > 0) {
+        m_historyView->scrollTo(m_historyModel->index(loaded), QAbstractItemView::PositionAtTop);
+    }
+}
+
+void QenQeyMainWindow::setupHistory()
+{
+    QGroupBox *historyGroup = new QGroupBox("История паролей");
+    QVBoxLayout *historyLayout = new QVBoxLayout(historyGroup);
     
-    // Scroll to bottom
-    QTextCursor cursor = m_historyTextEdit->textCursor();
-    cursor.movePosition(QTextCursor::End);
-    m_historyTextEdit->setTextCursor(cursor);
+    // Only the visible rows are laid out and painted, so the view costs
+    // the same with ten entries or a million
+    m_historyView = new QListView;
+    m_historyView->setModel(m_historyModel);
+    m_historyView->setUniformItemSizes(true);
+    m_historyView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_historyView->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_historyView->setMaximumHeight(120);
+    m_historyView->setFont(QFont("monospace", 9));
+    m_historyView->setStyleSheet("QListView { border: 1px solid #ddd; border-radius: 4px; }");
+    historyLayout->addWidget(m_historyView);
+    
+    QHBoxLayout *historyLimitLayout = new QHBoxLayout;
+    historyLimitLayout->setSpacing(8);
+    
+    QLabel *historyLimitLabel = new QLabel("Хранить записей:");
+    historyLimitLayout->addWidget(historyLimitLabel);
+    
+    m_historyLimitSpinBox = new QSpinBox;
+    m_historyLimitSpinBox->setRange(10, HistoryModel::MAX_LIMIT);
+    m_historyLimitSpinBox->setValue(HistoryModel::DEFAULT_LIMIT);
+    m_historyLimitSpinBox->setSingleStep(100);
+    m_historyLimitSpinBox->setMinimumWidth(90);
+    historyLimitLayout->addWidget(m_historyLimitSpinBox);
+    historyLimitLayout->addStretch();
+    
+    historyLayout->addLayout(historyLimitLayout);
+    
+    m_mainLayout->addWidget(historyGroup);
+    connect(m_historyLimitSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &QenQeyMainWindow::historyLimitChanged);
+    m_historyView->scrollToBottom();
+    
+    // Older entries are read from the log a page at a time once the view
+    // is scrolled to the top
+    connect(m_historyView->verticalScrollBar(), &QScrollBar::valueChanged, this, &QenQeyMainWindow::loadOlderHistory);
+}
+
+void QenQeyMainWindow::generatePassword()
+{
+    const size_t length = showNewPassword();
+    if (length == 0) {
+        const bool badRules = &currentSource() == &m_constrained && m_constrained.error() != qenqey::RuleError::NoClasses;
+        QMessageBox::warning(this, "Предупреждение", 
+                           m_breachExhausted                     ? "Почти все пароли с такими настройками есть в базе утечек!"
+                           : badRules                            ? "Правила невыполнимы!"
+                           : m_modeComboBox->currentIndex() == 0 ? "Необходимо выбрать хотя бы один тип символов!"
+                           : m_modeComboBox->currentIndex() == 1 ? "Список слов для парольных фраз не найден!"
+                           : m_modeComboBox->currentIndex() == 3 ? "Модель букв не найдена!"
+                                                                 : "Шаблон содержит ошибку!");
+        return;
+    }
     
+    commitPassword(length);
     statusBar()->showMessage("Пароль сгенерирован", 3000);
 }
 
-QString QenQeyMainWindow::generateRandomPassword()
+// Generates into the scratch buffer and shows the result, without adding
+// it to history; returns 0 when the current settings cannot generate
+size_t QenQeyMainWindow::showNewPassword()
 {
-    QString charset;
+    // A pending settings change must apply to this password
+    if (m_pendingUpdates & PlanUpdate) {
+        m_pendingUpdates &= ~PlanUpdate;
+        updatePlan();
+    }
+    if (m_previewLength > 0) {
+        qenqey::secureZero(m_passwordBuffer, m_previewLength);
+        m_previewLength = 0;
+    }
     
-    if (m_uppercaseCheckBox->isChecked()) {
-        charset += UPPERCASE_CHARS;
+    const size_t length = generateRandomPassword();
+    if (length > 0) {
+        const qenqey::ScopedTimer timer(qenqey::Metrics::UiUpdate);
+        m_passwordLineEdit->setText(QString::fromUtf8(m_passwordBuffer, static_cast<qsizetype>(length)));
     }
-    if (m_lowercaseCheckBox->isChecked()) {
-        charset += LOWERCASE_CHARS;
+    return length;
+}
+
+void QenQeyMainWindow::commitPassword(size_t length)
+{
+    // The model copies the bytes into its own locked slot
+    {
+        const qenqey::ScopedTimer timer(qenqey::Metrics::HistoryAppend);
+        m_historyModel->append(m_passwordBuffer, length);
     }
-    if (m_numbersCheckBox->isChecked()) {
-        charset += NUMBER_CHARS;
+    qenqey::secureZero(m_passwordBuffer, length);
+    m_previewLength = 0;
+    if (m_historyView) {
+        m_historyView->scrollToBottom();
     }
-    if (m_symbolsCheckBox->isChecked()) {
-        charset += SYMBOL_CHARS;
+}
+
+void QenQeyMainWindow::commitPreview()
+{
+    // A step still waiting for its frame is generated now, with the
+    // slider up, so it is the one that is kept
+    if (m_updateTimer.isActive()) {
+        m_updateTimer.stop();
+        flushUpdates();
+    } else if (m_previewLength > 0) {
+        commitPassword(m_previewLength);
     }
-    
-    if (m_excludeSimilarCheckBox->isChecked()) {
-        for (const QChar &c : SIMILAR_CHARS) {
-            charset.remove(c);
-        }
+}
+
+void QenQeyMainWindow::scheduleUpdate(unsigned updates)
+{
+    m_pendingUpdates |= updates;
+    if (!m_updateTimer.isActive()) {
+        // Next pass of the event loop, but no sooner than a frame after
+        // the previous update, so a burst of changes costs one update
+        const qint64 wait = m_sinceUpdate.isValid() ? FRAME_MS - m_sinceUpdate.elapsed() : 0;
+        m_updateTimer.start(static_cast<int>(std::max<qint64>(0, wait)));
     }
+}
+
+void QenQeyMainWindow::flushUpdates()
+{
+    const unsigned updates = m_pendingUpdates;
+    m_pendingUpdates = 0;
+    m_sinceUpdate.restart();
     
-    if (charset.isEmpty()) {
-        return QString();
+    if (updates & PlanUpdate) {
+        updatePlan();
+    }
+    if (!(updates & RegenerateUpdate) || m_passwordLineEdit->text().isEmpty()) {
+        return;
     }
     
-    QString password;
-    int length = m_lengthSpinBox->value();
+    // An unfinished template or impossible rules are explained by their
+    // error labels
+    if ((&currentSource() == &m_template || &currentSource() == &m_constrained) && !currentSource().isValid()) {
+        return;
+    }
     
-    // Ensure we have at least one character from each selected type
-    QStringList requiredSets;
+    // While the slider is held each step only previews a password
+    if (m_lengthSlider->isSliderDown()) {
+        m_previewLength = showNewPassword();
+    } else {
+        generatePassword();
+    }
+}
+
+qenqey::GeneratorSettings QenQeyMainWindow::currentSettings() const
+{
+    qenqey::GeneratorSettings settings;
+    settings.length = m_lengthSpinBox->value();
+    settings.classes = 0;
     if (m_uppercaseCheckBox->isChecked()) {
-        QString set = UPPERCASE_CHARS;
-        if (m_excludeSimilarCheckBox->isChecked()) {
-            for (const QChar &c : SIMILAR_CHARS) {
-                set.remove(c);
-            }
-        }
-        requiredSets.append(set);
+        settings.classes |= qenqey::Uppercase;
     }
     if (m_lowercaseCheckBox->isChecked()) {
-        QString set = LOWERCASE_CHARS;
-        if (m_excludeSimilarCheckBox->isChecked()) {
-            for (const QChar &c : SIMILAR_CHARS) {
-                set.remove(c);
-            }
-        }
-        requiredSets.append(set);
+        settings.classes |= qenqey::Lowercase;
     }
     if (m_numbersCheckBox->isChecked()) {
-        QString set = NUMBER_CHARS;
-        if (m_excludeSimilarCheckBox->isChecked()) {
-            for (const QChar &c : SIMILAR_CHARS) {
-                set.remove(c);
-            }
-        }
-        requiredSets.append(set);
+        settings.classes |= qenqey::Numbers;
     }
     if (m_symbolsCheckBox->isChecked()) {
-        requiredSets.append(SYMBOL_CHARS);
+        settings.classes |= qenqey::Symbols;
     }
-    
-    // Add required characters first
-    for (const QString &set : requiredSets) {
-        if (!set.isEmpty() && password.length() < length) {
-            int index = QRandomGenerator::global()->bounded(set.length());
-            password.append(set.at(index));
-        }
+    settings.excludeSimilar = m_excludeSimilarCheckBox->isChecked();
+    return settings;
+}
+
+// Minimums of unselected classes are left at zero rather than refused
+qenqey::CharacterRules QenQeyMainWindow::currentRules() const
+{
+    const unsigned classes = currentSettings().classes;
+    qenqey::CharacterRules rules;
+    for (int cls = 0; cls < qenqey::CLASS_COUNT; ++cls) {
+        rules.minimum[cls] = (classes & (1u << cls)) ? m_minimumSpinBoxes[cls]->value() : 0;
     }
-    
-    // Fill remaining positions randomly
-    for (int i = password.length(); i < length; ++i) {
-        int index = QRandomGenerator::global()->bounded(charset.length());
-        password.append(charset.at(index));
+    rules.maxRepeat = m_maxRepeatSpinBox->value();
+    rules.maxSequence = m_maxSequenceSpinBox->value();
+    rules.bannedFirst = m_bannedFirstLineEdit->text().toStdString();
+    return rules;
+}
+
+qenqey::PassphraseSettings QenQeyMainWindow::currentPassphraseSettings() const
+{
+    qenqey::PassphraseSettings settings;
+    settings.words = m_wordsSpinBox->value();
+    settings.separator = m_separatorComboBox->currentData().toChar().toLatin1();
+    settings.capitalize = m_capitalizeCheckBox->isChecked();
+    return settings;
+}
+
+qenqey::PronounceableSettings QenQeyMainWindow::currentPronounceableSettings() const
+{
+    qenqey::PronounceableSettings settings;
+    settings.length = m_pronounceableLengthSpinBox->value();
+    return settings;
+}
+
+qenqey::TokenSettings QenQeyMainWindow::currentTokenSettings() const
+{
+    qenqey::TokenSettings settings;
+    settings.encoding = static_cast<qenqey::TokenEncoding>(m_tokenEncodingComboBox->currentData().toInt());
+    settings.bytes = m_tokenBytesSpinBox->value();
+    return settings;
+}
+
+const qenqey::PasswordSource &QenQeyMainWindow::currentSource() const
+{
+    switch (m_modeComboBox->currentIndex()) {
+    case 1:
+        return m_passphrase;
+    case 2:
+        return m_template;
+    case 3:
+        return m_pronounceable;
+    case 4:
+        return m_token;
+    default:
+        return m_rulesGroup->isChecked() ? static_cast<const qenqey::PasswordSource &>(m_constrained) : m_plan;
+    }
+}
+
+qenqey::Policy QenQeyMainWindow::currentPolicy() const
+{
+    qenqey::Policy policy;
+    switch (m_modeComboBox->currentIndex()) {
+    case 1:
+        policy.mode = qenqey::Policy::Mode::Passphrase;
+        break;
+    case 2:
+        policy.mode = qenqey::Policy::Mode::Template;
+        break;
+    case 3:
+        policy.mode = qenqey::Policy::Mode::Pronounceable;
+        break;
+    case 4:
+        policy.mode = qenqey::Policy::Mode::Token;
+        break;
+    default:
+        policy.mode = qenqey::Policy::Mode::Characters;
+        break;
+    }
+    policy.characters = currentSettings();
+    if (m_rulesGroup->isChecked()) {
+        policy.rules = currentRules();
+    }
+    policy.passphrase = currentPassphraseSettings();
+    policy.pattern = m_templateLineEdit->text().toStdString();
+    policy.pronounceable = currentPronounceableSettings();
+    policy.token = currentTokenSettings();
+    return policy;
+}
+
+void QenQeyMainWindow::updatePlan()
+{
+    // The wordlist and letter model are only mapped once a mode that
+    // needs them is first used
+    switch (m_modeComboBox->currentIndex()) {
+    case 1:
+        m_passphrase = qenqey::PassphrasePlan(qenqey::Wordlist::shared(), currentPassphraseSettings());
+        break;
+    case 2:
+        updateTemplatePlan();
+        break;
+    case 3:
+        m_pronounceable = qenqey::PronounceablePlan(qenqey::MarkovModel::shared(), currentPronounceableSettings());
+        break;
+    case 4:
+        m_token = qenqey::TokenPlan(currentTokenSettings());
+        // A UUID always takes 16 bytes
+        m_tokenBytesSpinBox->setEnabled(m_token.settings().encoding != qenqey::TokenEncoding::Uuid);
+        break;
+    default:
+        m_plan = qenqey::CharsetPlan(currentSettings());
+        updateConstrainedPlan();
+        break;
+    }
+
+    const qenqey::PasswordSource &source = currentSource();
+    if (!source.isValid()) {
+        m_entropyLabel->clear();
+    } else if (&source == &m_template && !m_template.isEntropyExact()) {
+        m_entropyLabel->setText(QString("Энтропия: до %1 бит").arg(source.entropyBits(), 0, 'f', 1));
+    } else if (&source == &m_template || &source == &m_constrained || &source == &m_pronounceable
+               || &source == &m_token) {
+        m_entropyLabel->setText(QString("Энтропия: %1 бит").arg(source.entropyBits(), 0, 'f', 1));
+    } else if (&source == &m_passphrase) {
+        m_entropyLabel->setText(QString("Энтропия: %1 бит (словарь: %2 слов)")
+                                    .arg(source.entropyBits(), 0, 'f', 1)
+                                    .arg(qenqey::Wordlist::shared()->size()));
+    } else {
+        m_entropyLabel->setText(QString("Энтропия: до %1 бит").arg(source.entropyBits(), 0, 'f', 1));
+    }
+}
+
+void QenQeyMainWindow::updateTemplatePlan()
+{
+    // Words are the only part of a template that needs the wordlist
+    const std::string pattern = m_templateLineEdit->text().toStdString();
+    const bool needsWords = pattern.find_first_of("wW") != std::string::npos;
+    m_template = qenqey::TemplatePlan(pattern, needsWords ? qenqey::Wordlist::shared() : nullptr);
+
+    QString message;
+    switch (m_template.error()) {
+    case qenqey::TemplateError::None:
+        break;
+    case qenqey::TemplateError::Empty:
+        message = "Шаблон пуст";
+        break;
+    case qenqey::TemplateError::UnclosedSet:
+        message = "Не закрыта скобка [";
+        break;
+    case qenqey::TemplateError::BadSet:
+        message = "Неверный набор символов в [ ]";
+        break;
+    case qenqey::TemplateError::BadRepeat:
+        message = "Неверное число повторов в { }";
+        break;
+    case qenqey::TemplateError::TooLong:
+        message = "Слишком длинный результат";
+        break;
+    case qenqey::TemplateError::NoWordlist:
+        message = "Список слов не найден";
+        break;
+    case qenqey::TemplateError::BadLiteral:
+        message = "Допустимы только печатные символы ASCII";
+        break;
+    }
+    if (!message.isEmpty()) {
+        message += QString(" (позиция %1)").arg(m_template.errorPosition() + 1);
+    }
+    m_templateErrorLabel->setText(message);
+    m_templateErrorLabel->setVisible(!message.isEmpty());
+}
+
+void QenQeyMainWindow::updateConstrainedPlan()
+{
+    const unsigned classes = currentSettings().classes;
+    for (int cls = 0; cls < qenqey::CLASS_COUNT; ++cls) {
+        m_minimumSpinBoxes[cls]->setEnabled((classes & (1u << cls)) != 0);
     }
     
-    // Shuffle the password to avoid predictable patterns
-    for (int i = password.length() - 1; i > 0; --i) {
-        int j = QRandomGenerator::global()->bounded(i + 1);
-        QChar temp = password[i];
-        password[i] = password[j];
-        password[j] = temp;
+    // The count table is only worth its memory while the rules are on
+    if (!m_rulesGroup->isChecked()) {
+        m_constrained = qenqey::ConstrainedPlan();
+        m_rulesErrorLabel->hide();
+        return;
+    }
+    m_constrained = qenqey::ConstrainedPlan(currentSettings(), currentRules());
+    
+    QString message;
+    switch (m_constrained.error()) {
+    case qenqey::RuleError::None:
+    case qenqey::RuleError::NoClasses:
+        break;
+    case qenqey::RuleError::UnselectedMinimum:
+    case qenqey::RuleError::BadLimit:
+        message = "Неверные правила";
+        break;
+    case qenqey::RuleError::Impossible:
+        message = "Ни один пароль такой длины не подходит под правила";
+        break;
+    case qenqey::RuleError::TooComplex:
+        message = "Слишком сложные правила для такой длины";
+        break;
+    }
+    m_rulesErrorLabel->setText(message);
+    m_rulesErrorLabel->setVisible(!message.isEmpty());
+}
+
+size_t QenQeyMainWindow::generateRandomPassword()
+{
+    const qenqey::PasswordSource &source = currentSource();
+    m_breachExhausted = false;
+    if (!source.isValid() || !m_passwordBuffer) {
+        return 0;
     }
     
-    return password;
+    const qenqey::ScopedTimer timer(qenqey::Metrics::Generation);
+    qenqey::Metrics::add(qenqey::Metrics::Passwords, 1);
+    char *buffer = m_passwordBuffer;
+    qenqey::RandomStream &random = qenqey::RandomStream::forThread();
+    size_t length = source.generate(random, buffer);
+
+    // Never hand out a password that is already in a breach list, not
+    // even when the settings leave almost nothing else
+    if (const qenqey::BreachCorpus *corpus = qenqey::BreachCorpus::shared()) {
+        for (int attempt = 0; corpus->containsPassword(std::string_view(buffer, length)); ++attempt) {
+            if (attempt + 1 == qenqey::MAX_BREACH_RETRIES) {
+                qenqey::secureZero(buffer, length);
+                m_breachExhausted = true;
+                return 0;
+            }
+            length = source.generate(random, buffer);
+        }
+    }
+    return length;
+}
+
+void QenQeyMainWindow::exportPasswords()
+{
+    if (m_exportJob && m_exportJob->isRunning()) {
+        statusBar()->showMessage("Экспорт уже выполняется", 3000);
+        return;
+    }
+
+    // The export gets its own copy of the current settings, so changing
+    // them while it runs does not affect the file
+    std::unique_ptr<qenqey::PasswordSource> source =
+        qenqey::makeSource(currentPolicy(), qenqey::Wordlist::shared());
+    if (!source) {
+        QMessageBox::warning(this, "Экспорт", "Текущие настройки не позволяют сгенерировать пароль.");
+        return;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("Экспорт паролей");
+    QFormLayout *form = new QFormLayout(&dialog);
+
+    QSpinBox *countSpinBox = new QSpinBox;
+    countSpinBox->setRange(1, 1000000000);
+    countSpinBox->setValue(1000);
+    countSpinBox->setGroupSeparatorShown(true);
+    form->addRow("Количество паролей:", countSpinBox);
+
+    QComboBox *formatComboBox = new QComboBox;
+    formatComboBox->addItem("Текст, по паролю в строке", static_cast<int>(qenqey::ExportFormat::Plain));
+    formatComboBox->addItem("CSV", static_cast<int>(qenqey::ExportFormat::Csv));
+    formatComboBox->addItem("JSON Lines", static_cast<int>(qenqey::ExportFormat::Jsonl));
+    formatComboBox->addItem("Двоичный (длина и пароль)", static_cast<int>(qenqey::ExportFormat::Binary));
+    form->addRow("Формат:", formatComboBox);
+
+    QCheckBox *uniqueCheckBox = new QCheckBox("Без повторов");
+    uniqueCheckBox->setToolTip("Гарантировать, что ни один пароль в файле не повторяется");
+    form->addRow(uniqueCheckBox);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(buttons);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    const auto format = static_cast<qenqey::ExportFormat>(formatComboBox->currentData().toInt());
+    static const char *const FILTERS[] = {
+        "Текстовые файлы (*.txt)", "CSV (*.csv)", "JSON Lines (*.jsonl)", "Двоичные файлы (*.bin)",
+    };
+    const QString path = QFileDialog::getSaveFileName(this, "Экспорт паролей", QString(),
+                                                      FILTERS[static_cast<int>(format)]);
+    if (path.isEmpty()) {
+        return;
+    }
+
+    if (!m_exportJob) {
+        m_exportJob = new ExportJob(this);
+        connect(m_exportJob, &ExportJob::progress, this, &QenQeyMainWindow::showExportProgress);
+        connect(m_exportJob, &ExportJob::finished, this, &QenQeyMainWindow::exportFinished);
+
+        m_exportProgress = new QProgressBar;
+        m_exportProgress->setMaximumWidth(200);
+        m_exportProgress->setRange(0, 1000);
+        m_exportCancelButton = new QPushButton("Отмена");
+        connect(m_exportCancelButton, &QPushButton::clicked, m_exportJob, &ExportJob::cancel);
+        statusBar()->addPermanentWidget(m_exportProgress);
+        statusBar()->addPermanentWidget(m_exportCancelButton);
+    }
+
+    qenqey::BulkOptions options;
+    options.count = static_cast<uint64_t>(countSpinBox->value());
+    options.format = format;
+    options.rejectBreached = qenqey::BreachCorpus::shared();
+    options.unique = uniqueCheckBox->isChecked();
+    if (options.unique && std::log2(static_cast<double>(options.count)) > source->entropyBits()) {
+        QMessageBox::warning(this, "Экспорт",
+                             "При текущих настройках различных паролей меньше, чем запрошено.");
+        return;
+    }
+
+    QString error;
+    if (!m_exportJob->start(std::move(source), path, options, &error)) {
+        QMessageBox::warning(this, "Экспорт", QString("Не удалось создать файл:\n%1").arg(error));
+        return;
+    }
+
+    m_exportProgress->setValue(0);
+    m_exportProgress->setVisible(true);
+    m_exportCancelButton->setVisible(true);
+    m_exportAction->setEnabled(false);
+    statusBar()->showMessage("Экспорт паролей...");
+}
+
+void QenQeyMainWindow::showExportProgress(quint64 done, quint64 total)
+{
+    // Permille keeps the bar's int range safe for any count
+    m_exportProgress->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    m_exportProgress->setFormat(QString("%1 из %2").arg(done).arg(total));
+}
+
+void QenQeyMainWindow::exportFinished(bool ok, bool cancelled)
+{
+    m_exportProgress->setVisible(false);
+    m_exportCancelButton->setVisible(false);
+    m_exportAction->setEnabled(true);
+
+    if (ok && m_exportJob->duplicatesRejected() > 0) {
+        statusBar()->showMessage(QString("Экспорт завершён, повторов заменено: %1")
+                                     .arg(m_exportJob->duplicatesRejected()), 5000);
+    } else if (ok) {
+        statusBar()->showMessage("Экспорт завершён", 5000);
+    } else if (cancelled) {
+        statusBar()->showMessage("Экспорт отменён", 5000);
+    } else if (m_exportJob->breachExhausted()) {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, "Экспорт", "Почти все пароли с такими настройками есть в базе утечек, "
+                                              "экспорт прерван. Увеличьте длину или добавьте типы символов.");
+    } else if (m_exportJob->uniqueExhausted()) {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, "Экспорт", "Не удалось получить достаточно различных паролей, "
+                                              "экспорт прерван. Увеличьте длину или добавьте типы символов.");
+    } else if (!m_exportJob->errorString().isEmpty()) {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, "Экспорт", QString("Экспорт прерван:\n%1").arg(m_exportJob->errorString()));
+    } else {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, "Экспорт", "Ошибка записи в файл, экспорт прерван.");
+    }
+}
+
+void QenQeyMainWindow::auditPasswordFile()
+{
+    if (m_auditJob && m_auditJob->isRunning()) {
+        statusBar()->showMessage("Аудит уже выполняется", 3000);
+        return;
+    }
+
+    const QString path = QFileDialog::getOpenFileName(this, "Аудит паролей", QString(),
+                                                      "Текстовые файлы (*.txt);;Все файлы (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    if (!m_auditJob) {
+        m_auditJob = new AuditJob(this);
+        connect(m_auditJob, &AuditJob::progress, this, &QenQeyMainWindow::showAuditProgress);
+        connect(m_auditJob, &AuditJob::finished, this, &QenQeyMainWindow::auditFinished);
+
+        m_auditProgress = new QProgressBar;
+        m_auditProgress->setMaximumWidth(200);
+        m_auditProgress->setRange(0, 1000);
+        m_auditCancelButton = new QPushButton("Отмена");
+        connect(m_auditCancelButton, &QPushButton::clicked, m_auditJob, &AuditJob::cancel);
+        statusBar()->addPermanentWidget(m_auditProgress);
+        statusBar()->addPermanentWidget(m_auditCancelButton);
+    }
+
+    m_auditJob->start(path, qenqey::DEFAULT_AUDIT_WEAKEST);
+    m_auditProgress->setValue(0);
+    m_auditProgress->setVisible(true);
+    m_auditCancelButton->setVisible(true);
+    m_auditAction->setEnabled(false);
+    statusBar()->showMessage("Аудит паролей...");
+}
+
+void QenQeyMainWindow::showAuditProgress(quint64 done, quint64 total)
+{
+    m_auditProgress->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    m_auditProgress->setFormat(QString("%1 из %2").arg(QLocale().formattedDataSize(done),
+                                                       QLocale().formattedDataSize(total)));
+}
+
+void QenQeyMainWindow::auditFinished(bool ok, bool cancelled)
+{
+    m_auditProgress->setVisible(false);
+    m_auditCancelButton->setVisible(false);
+    m_auditAction->setEnabled(true);
+
+    if (ok) {
+        statusBar()->showMessage("Аудит завершён", 5000);
+        showAuditReport(m_auditJob->report());
+    } else if (cancelled) {
+        statusBar()->showMessage("Аудит отменён", 5000);
+    } else {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, "Аудит", QString("Не удалось прочитать файл:\n%1").arg(m_auditJob->errorString()));
+    }
+}
+
+void QenQeyMainWindow::showAuditReport(const qenqey::AuditReport &report)
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Аудит паролей");
+    dialog.resize(640, 560);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    layout->addWidget(new QLabel(QString("Записей: %1, пустых строк: %2, время: %3 с")
+                                     .arg(QLocale().toString(static_cast<qulonglong>(report.entries)),
+                                          QLocale().toString(static_cast<qulonglong>(report.emptyLines)),
+                                          QLocale().toString(report.seconds, 'f', 2))));
+
+    // One bar per band of ten points, coloured like the strength bar
+    QGroupBox *histogramGroup = new QGroupBox("Распределение оценок");
+    QGridLayout *histogram = new QGridLayout(histogramGroup);
+    uint64_t largest = 1;
+    for (uint64_t count : report.bands) {
+        largest = std::max(largest, count);
+    }
+    for (int b = 0; b < qenqey::AUDIT_BANDS; ++b) {
+        const int low = b * 10;
+        const int high = b == qenqey::AUDIT_BANDS - 1 ? 100 : low + 9;
+        int tier = 0;
+        while (tier + 1 < STRENGTH_TIER_COUNT && low >= STRENGTH_TIERS[tier].below) {
+            ++tier;
+        }
+
+        QProgressBar *bar = new QProgressBar;
+        // Permille of the largest band keeps the int range safe
+        bar->setRange(0, 1000);
+        bar->setValue(static_cast<int>(report.bands[b] * 1000 / largest));
+        bar->setFormat(QLocale().toString(static_cast<qulonglong>(report.bands[b])));
+        bar->setPalette(m_strengthPalettes[tier]);
+        histogram->addWidget(new QLabel(QString("%1-%2").arg(low).arg(high)), b, 0);
+        histogram->addWidget(bar, b, 1);
+    }
+    layout->addWidget(histogramGroup);
+
+    layout->addWidget(new QLabel("Самые слабые пароли:"));
+    QTableWidget *table = new QTableWidget(static_cast<int>(report.weakest.size()), 4);
+    table->setHorizontalHeaderLabels({"Строка", "Оценка", "Энтропия", "Пароль"});
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->horizontalHeader()->setStretchLastSection(true);
+    for (int row = 0; row < table->rowCount(); ++row) {
+        const qenqey::AuditFinding &finding = report.weakest[row];
+        const QString cells[] = {
+            QLocale().toString(static_cast<qulonglong>(finding.line)),
+            QString::number(finding.estimate.score),
+            QString("%1 бит").arg(finding.estimate.bits, 0, 'f', 1),
+            QString::fromUtf8(finding.password.data(), static_cast<int>(finding.password.size())),
+        };
+        for (int column = 0; column < 4; ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells[column]);
+            if (column < 3) {
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            if (column == 3) {
+                item->setToolTip(qenqey::describeStrength(finding.estimate));
+            }
+            table->setItem(row, column, item);
+        }
+    }
+    layout->addWidget(table);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    dialog.exec();
 }
 
 void QenQeyMainWindow::copyToClipboard()
@@ -476,7 +1527,7 @@ void QenQeyMainWindow::copyToClipboard()
 void QenQeyMainWindow::clearPassword()
 {
     m_passwordLineEdit->clear();
-    m_historyTextEdit->clear();
+    m_historyModel->clear();
     statusBar()->showMessage("История очищена", 2000);
 }
 
@@ -490,87 +1541,99 @@ void QenQeyMainWindow::lengthSpinChanged(int value)
 {
     m_lengthSlider->setValue(value);
     m_lengthLabel->setText(QString::number(value));
+    scheduleUpdate(PlanUpdate | RegenerateUpdate);
+}
+
+void QenQeyMainWindow::onModeChanged(int index)
+{
+    m_modeStack->setCurrentIndex(index);
+    onCharacterTypeChanged();
+}
+
+void QenQeyMainWindow::onTemplateChanged()
+{
+    // While a pattern is being typed it is often incomplete; the error
+    // label says why instead of a message box on every keystroke
+    scheduleUpdate(PlanUpdate | RegenerateUpdate);
 }
 
 void QenQeyMainWindow::onCharacterTypeChanged()
 {
     // Auto-generate new password when character types change
-    if (!m_passwordLineEdit->text().isEmpty()) {
-        generatePassword();
-    }
+    scheduleUpdate(PlanUpdate | RegenerateUpdate);
 }
 
-void QenQeyMainWindow::updatePasswordStrength()
+void QenQeyMainWindow::historyLimitChanged(int value)
 {
-    QString password = m_passwordLineEdit->text();
-    int strength = calculatePasswordStrength(password);
-    updateStrengthIndicator(strength);
+    m_historyModel->setLimit(value);
 }
 
-int QenQeyMainWindow::calculatePasswordStrength(const QString &password)
+void QenQeyMainWindow::updatePasswordStrength()
 {
-    if (password.isEmpty()) {
-        return 0;
+    // Scored off the GUI thread; showStrength() receives the latest result
+    m_strengthEvaluator->evaluate(m_passwordLineEdit->text());
+
+    // Letters cost one table lookup each, so this stays on the GUI thread.
+    // An edited password the model could not write shows nothing.
+    double bits = std::numeric_limits<double>::infinity();
+    if (&currentSource() == &m_pronounceable && m_pronounceable.isValid()) {
+        bits = m_pronounceable.model()->surprisal(m_passwordLineEdit->text().toStdString());
     }
-    
-    int score = 0;
-    int length = password.length();
-    
-    // Length scoring
-    if (length >= 8) score += 20;
-    if (length >= 12) score += 15;
-    if (length >= 16) score += 10;
-    if (length >= 20) score += 5;
-    
-    // Character variety bonus
-    bool hasUpper = false, hasLower = false, hasDigit = false, hasSymbol = false;
-    
-    for (const QChar &c : password) {
-        if (c.isUpper()) hasUpper = true;
-        else if (c.isLower()) hasLower = true;
-        else if (c.isDigit()) hasDigit = true;
-        else hasSymbol = true;
+    if (std::isfinite(bits) && !m_passwordLineEdit->text().isEmpty()) {
+        m_passwordEntropyLabel->setText(QString("%1 бит").arg(bits, 0, 'f', 1));
+        m_passwordEntropyLabel->setToolTip(QString("Точная энтропия этого пароля; в среднем %1 бит")
+                                               .arg(m_pronounceable.entropyBits(), 0, 'f', 1));
+        m_passwordEntropyLabel->setVisible(true);
+    } else {
+        m_passwordEntropyLabel->setVisible(false);
     }
-    
-    int varietyCount = 0;
-    if (hasUpper) { score += 10; varietyCount++; }
-    if (hasLower) { score += 10; varietyCount++; }
-    if (hasDigit) { score += 10; varietyCount++; }
-    if (hasSymbol) { score += 15; varietyCount++; }
-    
-    // Bonus for using multiple character types
-    if (varietyCount >= 3) score += 10;
-    if (varietyCount == 4) score += 10;
-    
-    return qMin(score, 100);
+}
+
+void QenQeyMainWindow::showStrength(const StrengthEvaluator::Result &result)
+{
+    const qenqey::ScopedTimer timer(qenqey::Metrics::UiUpdate);
+    qenqey::StrengthEstimate estimate = result.estimate;
+    QString toolTip = qenqey::describeStrength(estimate);
+
+    if (result.breachChecked) {
+        // A leaked password is in every attacker's first wordlist
+        if (result.breached) {
+            estimate.score = 0;
+            toolTip += "\nПароль найден в базе утечек";
+        }
+        const int state = result.breached ? 1 : 0;
+        if (state != m_breachState) {
+            m_breachState = state;
+            QFont font = m_breachLabel->font();
+            font.setBold(result.breached);
+            m_breachLabel->setFont(font);
+            m_breachLabel->setPalette(m_breachPalettes[state]);
+            m_breachLabel->setText(result.breached ? "В утечках" : "Нет в утечках");
+        }
+        m_breachLabel->setVisible(true);
+    } else {
+        m_breachLabel->setVisible(false);
+    }
+
+    updateStrengthIndicator(estimate.score);
+    m_strengthBar->setToolTip(toolTip);
 }
 
 void QenQeyMainWindow::updateStrengthIndicator(int strength)
 {
     m_strengthBar->setValue(strength);
     
-    QString strengthText;
-    QString styleSheet;
-    
-    if (strength < 25) {
-        strengthText = "Очень слабый";
-        styleSheet = "QProgressBar::chunk { background-color: #d32f2f; }";
-    } else if (strength < 50) {
-        strengthText = "Слабый";
-        styleSheet = "QProgressBar::chunk { background-color: #f57c00; }";
-    } else if (strength < 75) {
-        strengthText = "Средний";
-        styleSheet = "QProgressBar::chunk { background-color: #fbc02d; }";
-    } else if (strength < 90) {
-        strengthText = "Хороший";
-        styleSheet = "QProgressBar::chunk { background-color: #689f38; }";
-    } else {
-        strengthText = "Отличный";
-        styleSheet = "QProgressBar::chunk { background-color: #388e3c; }";
+    int tier = 0;
+    while (tier + 1 < STRENGTH_TIER_COUNT && strength >= STRENGTH_TIERS[tier].below) {
+        ++tier;
     }
     
-    m_strengthLabel->setText(strengthText);
-    m_strengthBar->setStyleSheet(styleSheet);
+    // Most updates stay within a tier and only move the bar
+    if (tier != m_strengthTier) {
+        m_strengthTier = tier;
+        m_strengthLabel->setText(STRENGTH_TIERS[tier].label);
+        m_strengthBar->setPalette(m_strengthPalettes[tier]);
+    }
 }
 
 void QenQeyMainWindow::showAbout()
@@ -597,11 +1660,114 @@ void QenQeyMainWindow::showAbout()
                       "</ul>");
 }
 
+static QString formatNanoseconds(double ns)
+{
+    if (ns < 1e3) {
+        return QString("%1 нс").arg(ns, 0, 'f', 0);
+    }
+    if (ns < 1e6) {
+        return QString("%1 мкс").arg(ns / 1e3, 0, 'f', 1);
+    }
+    return QString("%1 мс").arg(ns / 1e6, 0, 'f', 1);
+}
+
+void QenQeyMainWindow::showStatistics()
+{
+    static const char *const COUNTER_LABELS[qenqey::Metrics::COUNTER_COUNT] = {
+        "Сгенерировано паролей",
+        "Случайных байт",
+        "Отброшенных выборок",
+    };
+    static const char *const TIMER_LABELS[qenqey::Metrics::TIMER_COUNT] = {
+        "Генерация",
+        "Оценка стойкости",
+        "Добавление в историю",
+        "Обновление интерфейса",
+    };
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("Статистика");
+    dialog.resize(640, 300);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QTableWidget *table = new QTableWidget(qenqey::Metrics::COUNTER_COUNT + qenqey::Metrics::TIMER_COUNT, 6);
+    table->setHorizontalHeaderLabels({"Показатель", "Количество", "Среднее", "p50", "p99", "Максимум"});
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->horizontalHeader()->setStretchLastSection(true);
+    layout->addWidget(table);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    auto setCell = [table](int row, int column, const QString &text) {
+        QTableWidgetItem *item = table->item(row, column);
+        if (!item) {
+            item = new QTableWidgetItem;
+            if (column > 0) {
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            table->setItem(row, column, item);
+        }
+        item->setText(text);
+    };
+
+    // Refreshed while open; a snapshot only sums the per-thread shards
+    auto refresh = [&] {
+        const qenqey::Metrics::Snapshot snapshot = qenqey::Metrics::snapshot();
+        int row = 0;
+        for (int i = 0; i < qenqey::Metrics::COUNTER_COUNT; ++i, ++row) {
+            setCell(row, 0, COUNTER_LABELS[i]);
+            setCell(row, 1, QLocale().toString(static_cast<qulonglong>(snapshot.counters[i])));
+        }
+        for (int i = 0; i < qenqey::Metrics::TIMER_COUNT; ++i, ++row) {
+            const qenqey::LatencyHistogram &h = snapshot.timers[i];
+            setCell(row, 0, TIMER_LABELS[i]);
+            setCell(row, 1, QLocale().toString(static_cast<qulonglong>(h.count)));
+            const bool any = h.count > 0;
+            setCell(row, 2, any ? formatNanoseconds(h.meanNs()) : QString("-"));
+            setCell(row, 3, any ? formatNanoseconds(h.percentileNs(0.5)) : QString("-"));
+            setCell(row, 4, any ? formatNanoseconds(h.percentileNs(0.99)) : QString("-"));
+            setCell(row, 5, any ? formatNanoseconds(static_cast<double>(h.maxNs)) : QString("-"));
+        }
+    };
+    refresh();
+
+    QTimer timer;
+    timer.setInterval(500);
+    connect(&timer, &QTimer::timeout, &dialog, refresh);
+    timer.start();
+    dialog.exec();
+}
+
 #include "main.moc"
 
 int main(int argc, char *argv[])
 {
+    // --startup-trace is consumed here so neither the CLI nor Qt sees it
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--startup-trace") == 0) {
+            StartupTrace::enable();
+            std::copy(argv + i + 1, argv + argc + 1, argv + i);
+            --argc;
+            break;
+        }
+    }
+
+    // Headless mode never touches QApplication, so bulk runs don't pay
+    // for GUI initialisation
+    if (qenqey::cli::isCliInvocation(argc, argv)) {
+        return qenqey::cli::run(argc, argv);
+    }
+    
+    // The window generates at human speed, so its counters are always on
+    qenqey::Metrics::enable();
+
     QApplication app(argc, argv);
+    StartupTrace::mark("QApplication");
     
     app.setApplicationName("QenQey");
     app.setApplicationVersion("1.0.0");
@@ -610,6 +1776,7 @@ int main(int argc, char *argv[])
     
     QenQeyMainWindow window;
     window.show();
+    StartupTrace::mark("show()");
     
     return app.exec();
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "startuptrace.h"
+
+#include <QElapsedTimer>
+
+#include <cstdio>
+
+bool StartupTrace::s_enabled = false;
+
+namespace {
+
+QElapsedTimer &clock()
+{
+    static QElapsedTimer timer;
+    return timer;
+}
+
+qint64 &previousMark()
+{
+    static qint64 nanoseconds = 0;
+    return nanoseconds;
+}
+
+} // namespace
+
+void StartupTrace::enable()
+{
+    s_enabled = true;
+    clock().start();
+    previousMark() = 0;
+}
+
+void StartupTrace::record(const char *phase)
+{
+    const qint64 now = clock().nsecsElapsed();
+    std::fprintf(stderr, "startup: %-28s %9.3f мс  (+%.3f мс)\n", phase, now / 1e6,
+                 (now - previousMark()) / 1e6);
+    previousMark() = now;
+}
@@ -0,0 +1,26 @@
+#ifndef QENQEY_STARTUPTRACE_H
+#define QENQEY_STARTUPTRACE_H
+
+// Timing of GUI startup phases, printed to stderr when the application
+// runs with --startup-trace. Times are measured from the start of main().
+// Disabled, mark() is a single branch.
+class StartupTrace
+{
+public:
+    static void enable();
+    static bool isEnabled() { return s_enabled; }
+
+    static void mark(const char *phase)
+    {
+        if (s_enabled) {
+            record(phase);
+        }
+    }
+
+private:
+    static void record(const char *phase);
+
+    static bool s_enabled;
+};
+
+#endif // QENQEY_STARTUPTRACE_H
@@ -0,0 +1,66 @@
+#include "strength.h"
+
+#include "core/breach.h"
+#include "core/securememory.h"
+
+#include <QList>
+
+namespace qenqey {
+
+StrengthEstimate estimatePasswordStrength(const QString &password)
+{
+    if (password.isEmpty()) {
+        return StrengthEstimate();
+    }
+
+    QList<uint> ucs4 = password.toUcs4();
+    const StrengthEstimate estimate =
+        estimateStrength(reinterpret_cast<const char32_t *>(ucs4.constData()), ucs4.size());
+    secureZero(ucs4.data(), ucs4.size() * sizeof(uint));
+    return estimate;
+}
+
+int calculatePasswordStrength(const QString &password)
+{
+    return estimatePasswordStrength(password).score;
+}
+
+bool isPasswordBreached(const QString &password)
+{
+    const BreachCorpus *corpus = BreachCorpus::shared();
+    if (!corpus || password.isEmpty()) {
+        return false;
+    }
+
+    QByteArray utf8 = password.toUtf8();
+    const bool breached = corpus->containsPassword(std::string_view(utf8.constData(), utf8.size()));
+    secureZero(utf8.data(), utf8.size());
+    return breached;
+}
+
+bool breachCheckAvailable()
+{
+    return BreachCorpus::shared() != nullptr;
+}
+
+QString describeStrength(const StrengthEstimate &estimate)
+{
+    QString text = QString("Энтропия: %1 бит").arg(estimate.bits, 0, 'f', 1);
+
+    QString pattern;
+    switch (estimate.weakest) {
+    case WeakestPattern::Dictionary: pattern = "словарное слово"; break;
+    case WeakestPattern::Spatial: pattern = "клавиатурная последовательность"; break;
+    case WeakestPattern::Repeat: pattern = "повторы"; break;
+    case WeakestPattern::Sequence: pattern = "последовательность символов"; break;
+    case WeakestPattern::Year: pattern = "год"; break;
+    case WeakestPattern::None: break;
+    }
+
+    if (!pattern.isEmpty()) {
+        text += QString("\nОбнаружено: %1").arg(pattern);
+    }
+    return text;
+}
+
+} // namespace qenqey
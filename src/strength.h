@@ -0,0 +1,26 @@
+#ifndef QENQEY_STRENGTH_H
+#define QENQEY_STRENGTH_H
+
+#include "core/estimator.h"
+
+#include <QString>
+
+namespace qenqey {
+
+// Entropy-based estimate (see core/estimator.h) for a QString
+StrengthEstimate estimatePasswordStrength(const QString &password);
+
+// Score from 0 to 100 for the strength bar
+int calculatePasswordStrength(const QString &password);
+
+// Whether the password is in the local breach corpus (core/breach.h).
+// Always false when no corpus is installed; see breachCheckAvailable().
+bool isPasswordBreached(const QString &password);
+bool breachCheckAvailable();
+
+// Human-readable description of the estimate, for tooltips
+QString describeStrength(const StrengthEstimate &estimate);
+
+} // namespace qenqey
+
+#endif // QENQEY_STRENGTH_H
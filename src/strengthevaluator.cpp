@@ -0,0 +1,71 @@
+#include "strengthevaluator.h"
+#include "strength.h"
+
+#include "core/metrics.h"
+
+StrengthEvaluator::StrengthEvaluator(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+{
+    // One worker: requests are strictly newest-wins, so parallelism would
+    // only spend CPU on results that get thrown away
+    m_pool.setMaxThreadCount(1);
+
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(DEBOUNCE_MS);
+    connect(&m_debounce, &QTimer::timeout, this, &StrengthEvaluator::start);
+}
+
+StrengthEvaluator::~StrengthEvaluator()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void StrengthEvaluator::evaluate(const QString &password)
+{
+    m_pending = password;
+    ++m_generation;
+    m_pool.clear();
+    m_debounce.start();
+}
+
+bool StrengthEvaluator::isCurrent(quint64 generation) const
+{
+    return m_generation.load(std::memory_order_relaxed) == generation;
+}
+
+void StrengthEvaluator::start()
+{
+    const quint64 generation = m_generation.load(std::memory_order_relaxed);
+    const QString password = m_pending;
+
+    m_pool.start([this, generation, password] {
+        if (!isCurrent(generation)) {
+            return;
+        }
+
+        Result result;
+        result.password = password;
+        const uint64_t started = qenqey::Metrics::start();
+        result.estimate = qenqey::estimatePasswordStrength(password);
+        if (!isCurrent(generation)) {
+            return;
+        }
+
+        if (!password.isEmpty() && qenqey::breachCheckAvailable()) {
+            result.breachChecked = true;
+            result.breached = qenqey::isPasswordBreached(password);
+        }
+        qenqey::Metrics::stop(qenqey::Metrics::StrengthScoring, started);
+
+        // Delivered on the GUI thread; checked again there because a newer
+        // request may have arrived while the event was queued
+        QMetaObject::invokeMethod(this, [this, generation, result] {
+            if (isCurrent(generation)) {
+                emit evaluated(result);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,52 @@
+#ifndef QENQEY_STRENGTHEVALUATOR_H
+#define QENQEY_STRENGTHEVALUATOR_H
+
+#include "core/estimator.h"
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <atomic>
+
+// Scores passwords on a worker thread so typing never waits for the
+// estimator or a breach lookup. Requests are debounced; each one bumps a
+// generation counter, and work for an older generation is dropped before
+// it starts, between stages, and before its result is delivered. Only the
+// result for the latest password is ever emitted.
+class StrengthEvaluator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result
+    {
+        QString password;
+        qenqey::StrengthEstimate estimate;
+        bool breachChecked = false;
+        bool breached = false;
+    };
+
+    static constexpr int DEBOUNCE_MS = 50;
+
+    explicit StrengthEvaluator(QObject *parent = nullptr);
+    ~StrengthEvaluator() override;
+
+    // Schedules password for scoring, superseding any pending request
+    void evaluate(const QString &password);
+
+signals:
+    void evaluated(const StrengthEvaluator::Result &result);
+
+private:
+    void start();
+    bool isCurrent(quint64 generation) const;
+
+    QThreadPool m_pool;
+    QTimer m_debounce;
+    QString m_pending;
+    std::atomic<quint64> m_generation;
+};
+
+#endif // QENQEY_STRENGTHEVALUATOR_H
@@ -0,0 +1,110 @@
+// Minimal client for the generator daemon (qenqey --daemon).
+//
+//   qenqey-client [--socket PATH] [REQUEST...]
+//
+// Each REQUEST is one protocol line, e.g. "GEN 10 len=24 classes=ulds".
+// Without requests, lines are read from stdin. All requests are sent
+// before any response is read, so they are pipelined; the responses are
+// copied to stdout as they arrive.
+
+#include "core/daemon.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace qenqey;
+
+namespace {
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string socketPath = DaemonServer::defaultSocketPath();
+    std::string requests;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--help") == 0) {
+            std::fprintf(stderr, "Usage: qenqey-client [--socket PATH] [REQUEST...]\n");
+            return 0;
+        } else {
+            requests += argv[i];
+            requests += '\n';
+        }
+    }
+
+    if (requests.empty()) {
+        char buffer[4096];
+        size_t size;
+        while ((size = std::fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+            requests.append(buffer, size);
+        }
+        if (!requests.empty() && requests.back() != '\n') {
+            requests += '\n';
+        }
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::fprintf(stderr, "qenqey-client: socket path too long\n");
+        return 2;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        std::fprintf(stderr, "qenqey-client: cannot connect to %s: %s\n", socketPath.c_str(),
+                     std::strerror(errno));
+        return 1;
+    }
+
+    // Half-close after the requests: the daemon answers them all and then
+    // closes, which ends the copy loop below
+    if (!writeAll(fd, requests.data(), requests.size()) || shutdown(fd, SHUT_WR) < 0) {
+        std::fprintf(stderr, "qenqey-client: send failed: %s\n", std::strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        if (std::fwrite(buffer, 1, static_cast<size_t>(received), stdout) != static_cast<size_t>(received)) {
+            close(fd);
+            return 1;
+        }
+    }
+    close(fd);
+    return std::fflush(stdout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// Builds the memory-mapped indexes QenQey loads at run time.
+//
+//   qenqey-index dict WORDLIST OUTPUT.qqd
+//       ranked dictionary trie for the strength estimator; WORDLIST has
+//       one word per line, most common first
+//
+//   qenqey-index words WORDLIST OUTPUT.qqw
+//       passphrase wordlist; one word per line, optionally prefixed with
+//       diceware numbers as in the EFF lists ("11111<TAB>abacus")
+//
+//   qenqey-index markov WORDLIST OUTPUT.qqm [ORDER]
+//       letter model for pronounceable passwords, trained on one word per
+//       line; ORDER is the number of previous letters a letter depends
+//       on (1-3, default 2)
+//
+//   qenqey-index breach HASHES.txt OUTPUT.bin
+//       breach corpus for the offline breached-password check; HASHES.txt
+//       is the "SHA1HEX:count" list sorted by hash, as downloaded from HIBP
+//
+//   qenqey-index bloom CORPUS.bin OUTPUT.bloom [BITS-PER-ENTRY]
+//       optional Bloom prefilter for a breach corpus (default 10 bits per
+//       entry, ~1% false positives); install it as CORPUS.bin.bloom
+
+#include "core/breach.h"
+#include "core/dictionary.h"
+#include "core/markov.h"
+#include "core/wordlist.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace qenqey;
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+                 "Usage: qenqey-index dict WORDLIST OUTPUT.qqd\n"
+                 "       qenqey-index words WORDLIST OUTPUT.qqw\n"
+                 "       qenqey-index markov WORDLIST OUTPUT.qqm [ORDER]\n"
+                 "       qenqey-index breach HASHES.txt OUTPUT.bin\n"
+                 "       qenqey-index bloom CORPUS.bin OUTPUT.bloom [BITS-PER-ENTRY]\n");
+}
+
+bool readLines(const char *path, std::vector<std::string> &lines)
+{
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "qenqey-index: cannot open %s\n", path);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        lines.push_back(line);
+    }
+    return true;
+}
+
+int buildDictionary(const char *input, const char *output)
+{
+    std::vector<std::string> words;
+    if (!readLines(input, words)) {
+        return 1;
+    }
+
+    std::string error;
+    if (!writeDictionaryIndex(words, output, &error)) {
+        std::fprintf(stderr, "qenqey-index: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int buildWordlist(const char *input, const char *output)
+{
+    std::vector<std::string> lines;
+    if (!readLines(input, lines)) {
+        return 1;
+    }
+
+    // Drop diceware roll numbers and surrounding whitespace
+    for (std::string &line : lines) {
+        size_t start = line.find_first_not_of("0123456789");
+        if (start == std::string::npos || start == 0 || (line[start] != '\t' && line[start] != ' ')) {
+            start = 0;
+        }
+        start = line.find_first_not_of(" \t", start);
+        const size_t end = line.find_last_not_of(" \t");
+        line = start == std::string::npos ? std::string() : line.substr(start, end - start + 1);
+    }
+
+    std::string error;
+    size_t skipped = 0;
+    if (!writeWordlistIndex(lines, output, &error, &skipped)) {
+        std::fprintf(stderr, "qenqey-index: %s\n", error.c_str());
+        return 1;
+    }
+    if (skipped > 0) {
+        std::fprintf(stderr, "qenqey-index: skipped %zu duplicate or unusable words\n", skipped);
+    }
+    return 0;
+}
+
+int buildMarkovModel(const char *input, const char *output, const char *orderText)
+{
+    int order = DEFAULT_MARKOV_ORDER;
+    if (orderText) {
+        char *end = nullptr;
+        const long value = std::strtol(orderText, &end, 10);
+        if (*orderText == '\0' || *end != '\0' || value < MIN_MARKOV_ORDER || value > MAX_MARKOV_ORDER) {
+            std::fprintf(stderr, "qenqey-index: order must be %d-%d\n", MIN_MARKOV_ORDER, MAX_MARKOV_ORDER);
+            return 2;
+        }
+        order = static_cast<int>(value);
+    }
+
+    std::vector<std::string> words;
+    if (!readLines(input, words)) {
+        return 1;
+    }
+
+    std::string error;
+    if (!writeMarkovModel(words, order, output, &error)) {
+        std::fprintf(stderr, "qenqey-index: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int buildBreachCorpus(const char *input, const char *output)
+{
+    std::string error;
+    if (!writeBreachCorpus(input, output, &error)) {
+        std::fprintf(stderr, "qenqey-index: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int buildBloomFilter(const char *input, const char *output, const char *bitsPerEntry)
+{
+    unsigned bits = 10;
+    if (bitsPerEntry) {
+        char *end = nullptr;
+        const unsigned long value = std::strtoul(bitsPerEntry, &end, 10);
+        if (*bitsPerEntry == '\0' || *end != '\0' || value < 1 || value > 64) {
+            std::fprintf(stderr, "qenqey-index: bits per entry must be 1-64\n");
+            return 2;
+        }
+        bits = static_cast<unsigned>(value);
+    }
+
+    std::string error;
+    if (!writeBreachBloomFilter(input, output, bits, &error)) {
+        std::fprintf(stderr, "qenqey-index: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc == 4 && std::strcmp(argv[1], "dict") == 0) {
+        return buildDictionary(argv[2], argv[3]);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "words") == 0) {
+        return buildWordlist(argv[2], argv[3]);
+    }
+    if ((argc == 4 || argc == 5) && std::strcmp(argv[1], "markov") == 0) {
+        return buildMarkovModel(argv[2], argv[3], argc == 5 ? argv[4] : nullptr);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "breach") == 0) {
+        return buildBreachCorpus(argv[2], argv[3]);
+    }
+    if ((argc == 4 || argc == 5) && std::strcmp(argv[1], "bloom") == 0) {
+        return buildBloomFilter(argv[2], argv[3], argc == 5 ? argv[4] : nullptr);
+    }
+
+    printUsage();
+    return 2;
+}
@@ -0,0 +1,427 @@
+// Statistical quality report for the character generator.
+//
+//   qenqey-quality [--chars N] [--threads N]
+//
+// Generates N characters (default 10^9) for each of a fixed set of
+// settings and checks that the output matches what the algorithm is meant
+// to produce. Required-class seeding makes symbols of small classes more
+// likely than a plain uniform draw over the union, so the expected
+// distributions are derived from the plan itself rather than assumed flat:
+//
+//   symbols      chi-square of all characters against the expected
+//                symbol distribution
+//   positions    the same test for every position (Bonferroni-corrected)
+//   homogeneity  contingency chi-square of position x symbol; needs no
+//                model and catches any position bias from the shuffle
+//   serial       lag-1 correlation of symbol indices inside passwords,
+//                against the exact value for a uniform shuffle
+//   boundary     correlation of the last character of one password with
+//                the first of the next, which must be zero
+//
+// Correlation tests compare mean index products with their exact
+// expectation; the standard error is measured from independent samples
+// (whole passwords, disjoint password pairs), so dependence between the
+// pairs inside a password cannot inflate the result.
+//
+// Prints a report and exits with 1 if any test fails at p < 1e-6.
+
+#include "core/charsetplan.h"
+#include "core/generator.h"
+#include "core/random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace qenqey;
+
+namespace {
+
+constexpr double ALPHA = 1e-6;
+
+// Passwords generated per batch before they are counted
+constexpr size_t BATCH = 4096;
+
+struct Config
+{
+    const char *name;
+    GeneratorSettings settings;
+};
+
+const Config CONFIGS[] = {
+    {"len=16 classes=l", {16, Lowercase, false}},
+    {"len=16 classes=ulds", {16, ALL_CLASSES, false}},
+    {"len=8 classes=ulds exclude_similar", {8, ALL_CLASSES, true}},
+    {"len=4 classes=ulds", {4, ALL_CLASSES, false}},
+    {"len=128 classes=uld", {128, Uppercase | Lowercase | Numbers, false}},
+};
+
+// Everything a thread accumulates; merged at the end
+struct Tally
+{
+    // counts[position * size + symbol]
+    std::vector<uint64_t> counts;
+    uint64_t passwords = 0;
+
+    // Per password: S = sum of adjacent index products; sums of S and S^2
+    uint64_t sumS = 0;
+    unsigned __int128 sumS2 = 0;
+
+    // Last index of password 2k times first index of password 2k + 1
+    uint64_t boundaryPairs = 0;
+    uint64_t boundarySum = 0;
+    unsigned __int128 boundarySum2 = 0;
+};
+
+// Regularised upper incomplete gamma function Q(a, x)
+double gammaQ(double a, double x)
+{
+    if (x <= 0.0) {
+        return 1.0;
+    }
+    const double logPrefix = -x + a * std::log(x) - std::lgamma(a);
+
+    if (x < a + 1.0) {
+        double term = 1.0 / a;
+        double sum = term;
+        for (int n = 1; n < 100000; ++n) {
+            term *= x / (a + n);
+            sum += term;
+            if (std::fabs(term) < std::fabs(sum) * 1e-15) {
+                break;
+            }
+        }
+        return 1.0 - sum * std::exp(logPrefix);
+    }
+
+    // Continued fraction, modified Lentz
+    constexpr double TINY = 1e-300;
+    double b = x + 1.0 - a;
+    double c = 1.0 / TINY;
+    double d = 1.0 / b;
+    double h = d;
+    for (int i = 1; i < 100000; ++i) {
+        const double an = -i * (i - a);
+        b += 2.0;
+        d = an * d + b;
+        d = std::fabs(d) < TINY ? TINY : d;
+        c = b + an / c;
+        c = std::fabs(c) < TINY ? TINY : c;
+        d = 1.0 / d;
+        const double delta = d * c;
+        h *= delta;
+        if (std::fabs(delta - 1.0) < 1e-15) {
+            break;
+        }
+    }
+    return std::exp(logPrefix) * h;
+}
+
+double chiSquarePValue(double statistic, double df)
+{
+    return gammaQ(df / 2.0, statistic / 2.0);
+}
+
+// Two-sided
+double normalPValue(double z)
+{
+    return std::erfc(std::fabs(z) / std::sqrt(2.0));
+}
+
+class Report
+{
+public:
+    void add(const std::string &test, const std::string &detail, double p, double alpha = ALPHA)
+    {
+        const bool pass = p >= alpha;
+        std::printf("  %-12s %-44s p=%-10.3g %s\n", test.c_str(), detail.c_str(), p, pass ? "ok" : "FAIL");
+        m_failures += pass ? 0 : 1;
+    }
+
+    int failures() const { return m_failures; }
+
+private:
+    int m_failures = 0;
+};
+
+void countBatch(const CharsetPlan &plan, const uint8_t *index, RandomStream &random, char *buffer,
+                size_t passwords, Tally &tally)
+{
+    const int length = plan.length();
+    const uint32_t size = plan.alphabet().size;
+    for (size_t i = 0; i < passwords; ++i) {
+        generatePassword(plan, random, buffer + i * length);
+    }
+
+    // One histogram per position, so consecutive increments land in
+    // different tables and never wait on each other
+    uint64_t *const counts = tally.counts.data();
+    for (size_t i = 0; i < passwords; ++i) {
+        const unsigned char *password = reinterpret_cast<const unsigned char *>(buffer + i * length);
+        uint32_t previous = index[password[0]];
+        ++counts[previous];
+        uint64_t products = 0;
+        for (int pos = 1; pos < length; ++pos) {
+            const uint32_t x = index[password[pos]];
+            ++counts[pos * size + x];
+            products += previous * x;
+            previous = x;
+        }
+        tally.sumS += products;
+        tally.sumS2 += static_cast<unsigned __int128>(products) * products;
+
+        if (i % 2 == 0 && i + 1 < passwords) {
+            const uint64_t product = previous * index[static_cast<unsigned char>(buffer[(i + 1) * length])];
+            tally.boundarySum += product;
+            tally.boundarySum2 += product * product;
+            ++tally.boundaryPairs;
+        }
+    }
+    tally.passwords += passwords;
+}
+
+uint32_t symbolIndex(const AlphabetTable &alphabet, char c)
+{
+    return static_cast<uint32_t>(std::find(alphabet.characters, alphabet.characters + alphabet.size, c)
+                                 - alphabet.characters);
+}
+
+// Probability of each symbol at any one position. After the shuffle a
+// position holds a uniformly chosen slot: one of the required-class
+// slots, or one of the length - required slots drawn from the union.
+std::vector<double> expectedDistribution(const CharsetPlan &plan)
+{
+    const AlphabetTable &alphabet = plan.alphabet();
+    const double length = plan.length();
+    const int required = std::min(plan.requiredCount(), plan.length());
+
+    std::vector<double> p(alphabet.size, (length - required) / length / alphabet.size);
+    for (int k = 0; k < required; ++k) {
+        const AlphabetTable &table = plan.required(k);
+        for (uint32_t j = 0; j < table.size; ++j) {
+            p[symbolIndex(alphabet, table.characters[j])] += 1.0 / length / table.size;
+        }
+    }
+    return p;
+}
+
+// Exact lag-1 correlation of symbol indices for a uniform shuffle of
+// independently drawn slots: two positions hold two distinct random slots
+double expectedSerialCorrelation(const CharsetPlan &plan, const std::vector<double> &p)
+{
+    const AlphabetTable &alphabet = plan.alphabet();
+    const int length = plan.length();
+    const int required = std::min(plan.requiredCount(), length);
+
+    auto slotMean = [&](const AlphabetTable &table) {
+        double sum = 0.0;
+        for (uint32_t j = 0; j < table.size; ++j) {
+            sum += symbolIndex(alphabet, table.characters[j]);
+        }
+        return sum / table.size;
+    };
+
+    std::vector<double> means;
+    for (int k = 0; k < required; ++k) {
+        means.push_back(slotMean(plan.required(k)));
+    }
+    const double freeMean = (alphabet.size - 1) / 2.0;
+    for (int k = required; k < length; ++k) {
+        means.push_back(freeMean);
+    }
+
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    for (double m : means) {
+        sum += m;
+        sumSquares += m * m;
+    }
+    const double exy = (sum * sum - sumSquares) / (static_cast<double>(length) * (length - 1));
+
+    double mean = 0.0;
+    double meanSquare = 0.0;
+    for (uint32_t x = 0; x < alphabet.size; ++x) {
+        mean += x * p[x];
+        meanSquare += static_cast<double>(x) * x * p[x];
+    }
+    return (exy - mean * mean) / (meanSquare - mean * mean);
+}
+
+int runConfig(const Config &config, uint64_t characters, unsigned threads)
+{
+    const CharsetPlan plan(config.settings);
+    const int length = plan.length();
+    const uint32_t size = plan.alphabet().size;
+
+    uint8_t index[256] = {};
+    for (uint32_t i = 0; i < size; ++i) {
+        index[static_cast<unsigned char>(plan.alphabet().characters[i])] = static_cast<uint8_t>(i);
+    }
+
+    const uint64_t passwords = std::max<uint64_t>(1, characters / length);
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Tally> tallies(threads);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            Tally &tally = tallies[t];
+            tally.counts.assign(static_cast<size_t>(length) * size, 0);
+            RandomStream &random = RandomStream::forThread();
+            std::vector<char> buffer(BATCH * length);
+
+            const uint64_t share = passwords / threads + (t < passwords % threads ? 1 : 0);
+            for (uint64_t done = 0; done < share;) {
+                const size_t n = static_cast<size_t>(std::min<uint64_t>(BATCH, share - done));
+                countBatch(plan, index, random, buffer.data(), n, tally);
+                done += n;
+            }
+        });
+    }
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    Tally total;
+    total.counts.assign(static_cast<size_t>(length) * size, 0);
+    for (const Tally &tally : tallies) {
+        for (size_t i = 0; i < total.counts.size(); ++i) {
+            total.counts[i] += tally.counts[i];
+        }
+        total.passwords += tally.passwords;
+        total.sumS += tally.sumS;
+        total.sumS2 += tally.sumS2;
+        total.boundaryPairs += tally.boundaryPairs;
+        total.boundarySum += tally.boundarySum;
+        total.boundarySum2 += tally.boundarySum2;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double n = static_cast<double>(total.passwords);
+    std::printf("%s: %.3g characters in %.1f s (%.0f M/s)\n", config.name, n * length, seconds,
+                n * length / seconds / 1e6);
+
+    Report report;
+    const std::vector<double> p = expectedDistribution(plan);
+
+    // All positions pooled
+    std::vector<uint64_t> symbolTotals(size, 0);
+    for (int pos = 0; pos < length; ++pos) {
+        for (uint32_t x = 0; x < size; ++x) {
+            symbolTotals[x] += total.counts[pos * size + x];
+        }
+    }
+    double chi = 0.0;
+    for (uint32_t x = 0; x < size; ++x) {
+        const double expected = n * length * p[x];
+        chi += (symbolTotals[x] - expected) * (symbolTotals[x] - expected) / expected;
+    }
+    char detail[96];
+    std::snprintf(detail, sizeof(detail), "chi2=%.1f df=%u", chi, size - 1);
+    report.add("symbols", detail, chiSquarePValue(chi, size - 1));
+
+    // Each position on its own; report the worst
+    double worstP = 1.0;
+    int worstPosition = 0;
+    for (int pos = 0; pos < length; ++pos) {
+        double positionChi = 0.0;
+        for (uint32_t x = 0; x < size; ++x) {
+            const double expected = n * p[x];
+            const double diff = total.counts[pos * size + x] - expected;
+            positionChi += diff * diff / expected;
+        }
+        const double positionP = chiSquarePValue(positionChi, size - 1);
+        if (positionP < worstP) {
+            worstP = positionP;
+            worstPosition = pos;
+        }
+    }
+    std::snprintf(detail, sizeof(detail), "worst is position %d of %d", worstPosition, length);
+    report.add("positions", detail, worstP, ALPHA / length);
+
+    // Position x symbol contingency table, against the pooled frequencies
+    double homogeneity = 0.0;
+    for (int pos = 0; pos < length; ++pos) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const double expected = static_cast<double>(symbolTotals[x]) / length;
+            if (expected > 0) {
+                const double diff = total.counts[pos * size + x] - expected;
+                homogeneity += diff * diff / expected;
+            }
+        }
+    }
+    const double homogeneityDf = static_cast<double>(length - 1) * (size - 1);
+    std::snprintf(detail, sizeof(detail), "chi2=%.1f df=%.0f", homogeneity, homogeneityDf);
+    report.add("homogeneity", detail, chiSquarePValue(homogeneity, homogeneityDf));
+
+    // Lag-1 correlation inside passwords against the exact value
+    double mean = 0.0;
+    double meanSquare = 0.0;
+    for (uint32_t x = 0; x < size; ++x) {
+        mean += x * p[x];
+        meanSquare += static_cast<double>(x) * x * p[x];
+    }
+    const double variance = meanSquare - mean * mean;
+
+    // z of a sample mean against its exact expectation, with the standard
+    // error taken from the samples themselves
+    auto meanZ = [](double sum, double sumSquares, double count, double expected) {
+        const double sampleMean = sum / count;
+        const double sampleVariance = (sumSquares / count - sampleMean * sampleMean) * count / (count - 1);
+        return (sampleMean - expected) / std::sqrt(sampleVariance / count);
+    };
+
+    if (length > 1 && n > 1) {
+        const double expected = expectedSerialCorrelation(plan, p);
+        const double expectedProduct = (expected * variance + mean * mean) * (length - 1);
+        const double observed = (total.sumS / n / (length - 1) - mean * mean) / variance;
+        const double z = meanZ(static_cast<double>(total.sumS), static_cast<double>(total.sumS2), n,
+                               expectedProduct);
+        std::snprintf(detail, sizeof(detail), "r=%.6f expected %.6f", observed, expected);
+        report.add("serial", detail, normalPValue(z));
+    }
+
+    if (total.boundaryPairs > 1) {
+        const double pairs = static_cast<double>(total.boundaryPairs);
+        const double observed = (total.boundarySum / pairs - mean * mean) / variance;
+        const double z = meanZ(static_cast<double>(total.boundarySum),
+                               static_cast<double>(total.boundarySum2), pairs, mean * mean);
+        std::snprintf(detail, sizeof(detail), "r=%.6f expected 0", observed);
+        report.add("boundary", detail, normalPValue(z));
+    }
+
+    return report.failures();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t characters = 1000000000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--chars") == 0 && i + 1 < argc) {
+            characters = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        } else {
+            std::fprintf(stderr, "Usage: qenqey-quality [--chars N] [--threads N]\n");
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    for (const Config &config : CONFIGS) {
+        failures += runConfig(config, characters, threads);
+    }
+
+    std::printf("%s: %d failed test(s)\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}